@@ -7,6 +7,15 @@ Model::Model(char const* path)
 }
 
 std::string directory; 
+
+// meshes referenced by the node and its children, a mesh used by two nodes counts twice: 
+static uint countAIMeshes(aiNode const& node)
+{
+	uint count = node.mNumMeshes; 
+	for (uint i = 0; i < node.mNumChildren; i++) count += countAIMeshes(*node.mChildren[i]); 
+	return count; 
+}
+
 void Model::Load(char const* path)
 {
 	static uint constexpr PROCESS_FLAGS =
@@ -19,6 +28,7 @@ void Model::Load(char const* path)
 		aiProcess_FlipUVs |
 		aiProcess_CalcTangentSpace;  
 
+	PROFILE_SCOPE("Model::Load");
 	printLoading(path);
 	Assimp::Importer importer;
 	aiScene const* scene = importer.ReadFile(path, PROCESS_FLAGS); 
@@ -30,7 +40,26 @@ void Model::Load(char const* path)
 	}
 	std::string p = path;  
 	directory = p.substr(0, p.find_last_of('/') + 1);   
-	TraverseAINode(*scene->mRootNode, *scene);  
+	mMats.reserve(countAIMeshes(*scene->mRootNode)); // the meshes point into it 
+	std::vector<std::string> albedoPaths; // per material, empty for those without a map 
+	TraverseAINode(*scene->mRootNode, *scene, albedoPaths);  
+
+	// every file is decoded once, on its own worker, the store is safe to fill from several at a time: 
+	std::vector<std::string> files; 
+	for (std::string const& file : albedoPaths) if (!file.empty()) files.push_back(file); 
+	std::sort(files.begin(), files.end()); 
+	files.erase(std::unique(files.begin(), files.end()), files.end()); 
+	mTextures.resize(files.size()); 
+	Jobs::ParallelFor(0, static_cast<int>(files.size()), 1, [&](int const i)
+	{
+		mTextures[i] = ResourceManager::LoadTexture(files[i]); 
+	});
+	for (size_t i = 0; i < albedoPaths.size(); i++)
+	{
+		if (albedoPaths[i].empty()) continue; 
+		size_t const file = std::lower_bound(files.begin(), files.end(), albedoPaths[i]) - files.begin(); 
+		mMats[i].textured.texture = mTextures[file].View(); 
+	}
 	printSuccess(path);
 }
 
@@ -75,49 +104,53 @@ void Model::ConvertAIMesh(aiMesh const& aiMesh, Mesh& mesh) const
 	}
 }
 
-void Model::ConvertAIMaterial(aiScene const& scene, aiMesh const& aiMesh, Mesh& mesh) 
+void Model::ConvertAIMaterial(aiScene const& scene, aiMesh const& aiMesh, Mesh& mesh, std::vector<std::string>& albedoPaths) 
 {
-	if (aiMesh.mMaterialIndex >= 0)
+	aiMaterial const& aiMat = *scene.mMaterials[aiMesh.mMaterialIndex]; 
+	std::string const albedo = AIMaterialTexturePath(aiMat, aiTextureType_DIFFUSE);
+	//std::string const normal = AIMaterialTexturePath(aiMat, aiTextureType_NORMALS); 
+	//Texture<float> roughness; 
+	//Texture<float> alpha;
+	// the texture is loaded with the others once the whole model is read, 
+	// without a diffuse map it stays the plain diffuse the meshes had before: 
+	albedoPaths.push_back(albedo); 
+	if (!albedo.empty())
 	{
-		aiMaterial& aiMat = *scene.mMaterials[aiMesh.mMaterialIndex]; 
-		AlbedoTexture albedo = LoadAIMaterialTexture(aiMat, aiTextureType_DIFFUSE);
-		//NormalTexture normal = LoadAIMaterialTexture(aiMat, aiTextureType_NORMALS); 
-		//Texture<float> roughness; 
-		//Texture<float> alpha;
 		mMats.emplace_back(MATERIAL_TYPES_TEXTURED);
-		mMats.back().textured.texture = packTexture(albedo);
 	}
 	else
 	{
-		mMats.emplace_back(MATERIAL_TYPES_GLOSSY);
+		mMats.emplace_back(MATERIAL_TYPES_DIFFUSE);
+	}
+	aiColor3D emissive; 
+	if (aiMat.Get(AI_MATKEY_COLOR_EMISSIVE, emissive) == AI_SUCCESS) 
+	{
+		mMats.back().emissivity = max(emissive.r, max(emissive.g, emissive.b)); 
 	}
 	mesh.mat = &mMats.back();  
 }
 
-Texture<float3> Model::LoadAIMaterialTexture(aiMaterial const& aiMat, aiTextureType const type) 
+std::string Model::AIMaterialTexturePath(aiMaterial const& aiMat, aiTextureType const type) const 
 {
 	if (aiMat.GetTextureCount(type) > 0)
 	{
 		aiString str; aiMat.GetTexture(type, 0, &str); 
-		Texture<float3> texture = loadTextureF((directory + str.C_Str()).c_str()); 
-		return texture;  
+		return directory + str.C_Str(); 
 	}
-	return Texture<float3>();
+	return std::string();
 }
 
-void Model::TraverseAINode(aiNode const& node, aiScene const& scene)
+void Model::TraverseAINode(aiNode const& node, aiScene const& scene, std::vector<std::string>& albedoPaths)
 {
 	for (int i = 0; i < node.mNumMeshes; i++) 
 	{
 		aiMesh const& aiMesh = *scene.mMeshes[node.mMeshes[i]];
 		mMeshes.emplace_back(); ConvertAIMesh(aiMesh, mMeshes.back());
-		//ConvertAIMaterial(scene, aiMesh, mMeshes.emplace_back());
-		mMats.emplace_back(MATERIAL_TYPES_DIFFUSE);
-		mMeshes.back().mat = &mMats.back(); 
+		ConvertAIMaterial(scene, aiMesh, mMeshes.back(), albedoPaths);
 	}
 	for (int i = 0; i < node.mNumChildren; i++)
 	{
-		TraverseAINode(*node.mChildren[i], scene);  
+		TraverseAINode(*node.mChildren[i], scene, albedoPaths);  
 	}
 }
 
@@ -148,7 +181,320 @@ bool BVHScene::Intersect(tinybvh::Ray& ray)
 {
 	mTlas.Intersect(ray); 
 	if (!didHit(ray)) return false; 
+	Resolve(ray); 
+	return true; 
+}
+
+bool BVHScene::IsOccluded(occlusionRay const& shadow) const
+{
+	bool occluded; 
+	IsOccluded(&shadow, 1, &occluded); 
+	return occluded; 
+}
+
+void BVHScene::IsOccluded(occlusionRay const* shadows, int const count, bool* occluded) const
+{
+	// traversal only reads these fields, the hit payload is left as it is instead of being cleared, 
+	// tinybvh has no packet query through a tlas, so the rays of the batch share one ray and go one after another: 
+	tinybvh::Ray ray; 
+	for (int i = 0; i < count; i++)
+	{
+		occlusionRay const& shadow = shadows[i]; 
+		ray.O		= shadow.mOrigin; 
+		ray.D		= shadow.mDirection; 
+		ray.rD		= tinybvh::tinybvh_rcp(shadow.mDirection); 
+		ray.mask	= shadow.mMask; 
+		ray.hit.t	= shadow.mMaxT; 
+		occluded[i]	= mTlas.IsOccluded(ray); 
+	}
+}
+
+static void intersectTri(float3 const& O, float3 const& D, Tri const& tri, uint32_t const instIdx, uint32_t const primIdx, tinybvh::Ray& ray)
+{
+	// moller-trumbore in the space of the instance, like the blas traversal, so t stays comparable: 
+	float3 const e1 = tri.points[1] - tri.points[0]; 
+	float3 const e2 = tri.points[2] - tri.points[0]; 
+	float3 const h	= cross(D, e2); 
+	float const a	= dot(e1, h); 
+	if (fabsf(a) < 1e-9f) return; 
+	float const f	= 1.0f / a; 
+	float3 const s	= O - tri.points[0]; 
+	float const u	= f * dot(s, h); 
+	if (u < 0.0f || u > 1.0f) return; 
+	float3 const q	= cross(s, e1); 
+	float const v	= f * dot(D, q); 
+	if (v < 0.0f || u + v > 1.0f) return; 
+	float const t	= f * dot(e2, q); 
+	if (t <= 0.0f || t >= ray.hit.t) return; 
+	ray.hit.t		= t; 
+	ray.hit.u		= u; 
+	ray.hit.v		= v; 
+	ray.hit.prim	= primIdx; 
+	ray.hit.inst	= instIdx; 
+}
+
+static float boxDistance(float3 const& O, float3 const& rD, float3 const& bmin, float3 const& bmax, float const tMax)
+{
+	float3 const t1		= (bmin - O) * rD; 
+	float3 const t2		= (bmax - O) * rD; 
+	float const tNear	= max(max(min(t1.x, t2.x), min(t1.y, t2.y)), min(t1.z, t2.z)); 
+	float const tFar	= min(min(max(t1.x, t2.x), max(t1.y, t2.y)), max(t1.z, t2.z)); 
+	return tNear <= tFar && tFar > 0.0f && tNear < tMax ? tNear : BVH_FAR; 
+}
+
+// the build and traversal callbacks of tinybvh take no user data: 
+static Scene const* analyticScene = nullptr; 
+
+static int analyticObject(int const shape)
+{
+	Scene const& s = *analyticScene; 
+	switch (shape)
+	{
+#ifdef FOURLIGHTS
+	case ANALYTIC_SHAPES_LIGHT:		return s.quad[0].objIdx; 
+#else
+	case ANALYTIC_SHAPES_LIGHT:		return s.quad.objIdx; 
+#endif
+	case ANALYTIC_SHAPES_SPHERE:	return s.sphere.objIdx; 
+	case ANALYTIC_SHAPES_CUBE:		return s.cube.objIdx; 
+	case ANALYTIC_SHAPES_FLOOR:		return s.plane[2].objIdx; 
+	case ANALYTIC_SHAPES_TORUS:		return s.torus.objIdx; 
+	default:						return -1; 
+	}
+}
+
+static void quadBounds(Quad const& quad, float3& bmin, float3& bmax)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		float3 const corner = TransformPosition(float3(i & 1 ? quad.size : -quad.size, 0.0f, i & 2 ? quad.size : -quad.size), quad.T); 
+		bmin = fminf(bmin, corner); 
+		bmax = fmaxf(bmax, corner); 
+	}
+}
+
+static void analyticBounds(int const shape, float3& bmin, float3& bmax)
+{
+	Scene const& s = *analyticScene; 
+	bmin = float3(BVH_FAR); 
+	bmax = float3(-BVH_FAR); 
+	switch (shape)
+	{
+	case ANALYTIC_SHAPES_LIGHT:
+#ifdef FOURLIGHTS
+		for (int i = 0; i < 4; i++) quadBounds(s.quad[i], bmin, bmax); 
+#else
+		quadBounds(s.quad, bmin, bmax); 
+#endif
+		break; 
+	case ANALYTIC_SHAPES_SPHERE:
+		bmin = s.sphere.pos - sqrtf(s.sphere.r2); 
+		bmax = s.sphere.pos + sqrtf(s.sphere.r2); 
+		break; 
+	case ANALYTIC_SHAPES_CUBE:
+		bmin = float3(s.cube.b[0]); 
+		bmax = float3(s.cube.b[1]); 
+		break; 
+	case ANALYTIC_SHAPES_FLOOR:
+	{
+		// the plane is infinite, its box only has to reach as far as the camera looks: 
+		Plane const& plane	= s.plane[2]; 
+		float3 const extent = (1.0f - fabs(plane.N)) * ANALYTIC_PLANE_EXTENT; 
+		bmin = plane.N * -plane.d - extent; 
+		bmax = plane.N * -plane.d + extent; 
+		break; 
+	}
+	case ANALYTIC_SHAPES_TORUS:
+	{
+		// the tube lies in the xy plane around (0, 0, 1.5), where its intersection code puts it: 
+		float const r = sqrtf(s.torus.r2); 
+		bmin = float3(-r, -r, 1.5f - s.torus.rt); 
+		bmax = float3(r, r, 1.5f + s.torus.rt); 
+		break; 
+	}
+	default: break; 
+	}
+	// flat shapes still need a box with some volume for the slab tests: 
+	bmin -= 1e-4f; 
+	bmax += 1e-4f; 
+}
+
+static float analyticDistance(int const shape, float3 const& O, float3 const& D, float const tMax)
+{
+	// nearest hit of the shape closer than tMax, BVH_FAR when there is none: 
+	Scene const& s = *analyticScene; 
+	Ray ray(O, D, tMax); 
+	switch (shape)
+	{
+	case ANALYTIC_SHAPES_LIGHT:
+#ifdef FOURLIGHTS
+		for (int i = 0; i < 4; i++) s.quad[i].Intersect(ray); 
+#else
+		s.quad.Intersect(ray); 
+#endif
+		break; 
+	case ANALYTIC_SHAPES_SPHERE:	s.sphere.Intersect(ray);	break; 
+	case ANALYTIC_SHAPES_CUBE:		s.cube.Intersect(ray);		break; 
+	case ANALYTIC_SHAPES_FLOOR:		s.plane[2].Intersect(ray);	break; 
+	case ANALYTIC_SHAPES_TORUS:		s.torus.Intersect(ray);		break; 
+	default: break; 
+	}
+	return ray.objIdx >= 0 ? ray.t : BVH_FAR; 
+}
+
+static void intersectShape(float3 const& O, float3 const& D, int const shape, uint32_t const instIdx, tinybvh::Ray& ray)
+{
+	float const t = analyticDistance(shape, O, D, ray.hit.t); 
+	if (t >= ray.hit.t) return; 
+	ray.hit.t		= t; 
+	ray.hit.u		= 0.0f; 
+	ray.hit.v		= 0.0f; 
+	ray.hit.prim	= 0; 
+	ray.hit.inst	= instIdx; 
+}
+
+template <int SHAPE>
+static void analyticAabb(unsigned const, float3& bmin, float3& bmax)
+{
+	analyticBounds(SHAPE, bmin, bmax); 
+}
+
+template <int SHAPE>
+static bool analyticIntersect(tinybvh::Ray& ray, unsigned const primIdx)
+{
+	// the tlas fills in the instance when this reports a hit: 
+	float const t = analyticDistance(SHAPE, ray.O, ray.D, ray.hit.t); 
+	if (t >= ray.hit.t) return false; 
+	ray.hit.t		= t; 
+	ray.hit.u		= 0.0f; 
+	ray.hit.v		= 0.0f; 
+	ray.hit.prim	= primIdx; 
+	return true; 
+}
+
+template <int SHAPE>
+static bool analyticIsOccluded(tinybvh::Ray const& ray, unsigned const)
+{
+	return analyticDistance(SHAPE, ray.O, ray.D, ray.hit.t) < ray.hit.t; 
+}
+
+template <int SHAPE>
+static tinybvh::BVHBase* buildAnalytic()
+{
+	// one primitive per blas, so every shape is an instance with its own material: 
+	tinybvh::BVH* bvh = new tinybvh::BVH(); 
+	bvh->Build(&analyticAabb<SHAPE>, 1); 
+	bvh->customIntersect	= &analyticIntersect<SHAPE>; 
+	bvh->customIsOccluded	= &analyticIsOccluded<SHAPE>; 
+	return bvh; 
+}
 
+void BVHScene::IntersectTriangle(tinybvh::Ray& ray, uint32_t const instIdx, uint32_t const primIdx) const
+{
+	tinybvh::BLASInstance const& inst = GetInstance(instIdx); 
+	float3 const O		= tinybvh::tinybvh_transform_point(ray.O, inst.invTransform); 
+	float3 const D		= tinybvh::tinybvh_transform_vector(ray.D, inst.invTransform); 
+	Mesh const& mesh	= GetMesh(inst.blasIdx); 
+	if (mesh.analytic >= 0) intersectShape(O, D, mesh.analytic, instIdx, ray); 
+	else intersectTri(O, D, mesh.tris[primIdx], instIdx, primIdx, ray); 
+}
+
+bool BVHScene::IntersectCounted(tinybvh::Ray& ray, traversalCost& cost)
+{
+	// scalar walk of the binary trees the wide layouts were collapsed from, the avx2 kernel does not count: 
+	tinybvh::BVH::BVHNode const* nodes = mTlas.bvhNode; 
+	float3 const rD = tinybvh::tinybvh_rcp(ray.D); 
+	uint32_t stack[64], stackPtr = 0, nodeIdx = 0; 
+	while (true)
+	{
+		tinybvh::BVH::BVHNode const& node = nodes[nodeIdx]; 
+		cost.mNodes++; 
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i < node.triCount; i++) IntersectBlasCounted(ray, mTlas.primIdx[node.leftFirst + i], cost); 
+		}
+		else
+		{
+			uint32_t nearIdx = node.leftFirst, farIdx = node.leftFirst + 1; 
+			float nearDist	= boxDistance(ray.O, rD, nodes[nearIdx].aabbMin, nodes[nearIdx].aabbMax, ray.hit.t); 
+			float farDist	= boxDistance(ray.O, rD, nodes[farIdx].aabbMin, nodes[farIdx].aabbMax, ray.hit.t); 
+			if (nearDist > farDist) { std::swap(nearIdx, farIdx); std::swap(nearDist, farDist); }
+			if (nearDist < BVH_FAR)
+			{
+				if (farDist < BVH_FAR) stack[stackPtr++] = farIdx; 
+				nodeIdx = nearIdx; 
+				continue; 
+			}
+		}
+		if (stackPtr == 0) break; 
+		nodeIdx = stack[--stackPtr]; 
+	}
+	if (!didHit(ray)) return false; 
+	Resolve(ray); 
+	return true; 
+}
+
+void BVHScene::IntersectBlasCounted(tinybvh::Ray& ray, uint32_t const instIdx, traversalCost& cost) const
+{
+	tinybvh::BLASInstance const& inst	= GetInstance(instIdx); 
+	if (!(inst.mask & ray.mask)) return; 
+	Mesh const& mesh					= GetMesh(inst.blasIdx); 
+	float3 const O	= tinybvh::tinybvh_transform_point(ray.O, inst.invTransform); 
+	float3 const D	= tinybvh::tinybvh_transform_vector(ray.D, inst.invTransform); 
+	cost.mInstances++; 
+	if (mesh.analytic >= 0)
+	{
+		// a shape is one leaf with one primitive: 
+		cost.mNodes++; 
+		cost.mTris++; 
+		intersectShape(O, D, mesh.analytic, instIdx, ray); 
+		return; 
+	}
+
+	tinybvh::BVH const& bvh = static_cast<tinybvh::BVH8_CPU const*>(mResources.blasses[inst.blasIdx])->bvh8.bvh; 
+	float3 const rD			= tinybvh::tinybvh_rcp(D); 
+
+	uint32_t stack[64], stackPtr = 0, nodeIdx = 0; 
+	while (true)
+	{
+		tinybvh::BVH::BVHNode const& node = bvh.bvhNode[nodeIdx]; 
+		cost.mNodes++; 
+		if (node.isLeaf())
+		{
+			cost.mTris += node.triCount; 
+			for (uint32_t i = 0; i < node.triCount; i++)
+			{
+				uint32_t const primIdx = bvh.primIdx[node.leftFirst + i]; 
+				intersectTri(O, D, mesh.tris[primIdx], instIdx, primIdx, ray); 
+			}
+		}
+		else
+		{
+			uint32_t nearIdx = node.leftFirst, farIdx = node.leftFirst + 1; 
+			float nearDist	= boxDistance(O, rD, bvh.bvhNode[nearIdx].aabbMin, bvh.bvhNode[nearIdx].aabbMax, ray.hit.t); 
+			float farDist	= boxDistance(O, rD, bvh.bvhNode[farIdx].aabbMin, bvh.bvhNode[farIdx].aabbMax, ray.hit.t); 
+			if (nearDist > farDist) { std::swap(nearIdx, farIdx); std::swap(nearDist, farDist); }
+			if (nearDist < BVH_FAR)
+			{
+				if (farDist < BVH_FAR) stack[stackPtr++] = farIdx; 
+				nodeIdx = nearIdx; 
+				continue; 
+			}
+		}
+		if (stackPtr == 0) break; 
+		nodeIdx = stack[--stackPtr]; 
+	}
+}
+
+void BVHScene::Resolve(tinybvh::Ray& ray)
+{
+	// shading attributes of the hit the traversal left in the ray: 
+	int const shape = GetMesh(GetBlasIdx(ray.hit.inst)).analytic; 
+	if (shape >= 0)
+	{
+		ResolveAnalytic(ray, shape); 
+		return; 
+	}
 	Tri const& tri	= GetTriangle(ray);
 	Material2& mat	= GetMaterial(ray.hit.inst);  
 
@@ -224,24 +570,86 @@ bool BVHScene::Intersect(tinybvh::Ray& ray)
 	// multiply by normal matrix 
 	ray.hit.mat = &mat; 
 	ray.hit.point = calcIntersectionPoint(ray);
-	return true;
+}
+
+void BVHScene::ResolveAnalytic(tinybvh::Ray& ray, int const shape)
+{
+	// the template scene answers in the space of the instance, like the triangles: 
+	tinybvh::BLASInstance const& inst	= GetInstance(ray.hit.inst); 
+	float3 const O						= tinybvh::tinybvh_transform_point(ray.O, inst.invTransform); 
+	float3 const D						= tinybvh::tinybvh_transform_vector(ray.D, inst.invTransform); 
+	float3 const local					= O + D * ray.hit.t; 
+	int const objIdx					= analyticObject(shape); 
+	ray.hit.normal	= normalize(tinybvh::tinybvh_transform_vector(analyticScene->GetNormal(objIdx, local, D), inst.transform)); 
+	ray.hit.albedo	= analyticScene->GetAlbedo(objIdx, local); 
+	ray.hit.mat		= &GetMaterial(ray.hit.inst); 
+	ray.hit.point	= calcIntersectionPoint(ray); 
 }
 
 void BVHScene::AddResource(char const* path)
 {
 	mResources.models.emplace_back(path);
 	std::vector<Mesh>& meshes = mResources.models.back().mMeshes;
+	std::vector<tinybvh::BVH8_CPU*> bvhs; 
 	for (Mesh& mesh : meshes)
 	{
 		mResources.meshes.push_back(&mesh); 
 		tinybvh::BVH8_CPU* bvh = new tinybvh::BVH8_CPU();   
-		bvh->Build(mesh.points.data(), mesh.tris.size());  
 		mResources.blasses.push_back(bvh);    
+		bvhs.push_back(bvh); 
 		mesh.blasIdx = mResources.blasses.size() - 1;
 	}
+
+	// the meshes do not share anything, so each one builds on its own worker: 
+	Jobs::ParallelFor(0, static_cast<int>(meshes.size()), 1, [&](int const i)
+	{
+		PROFILE_SCOPE("BLAS build");
+		bvhs[i]->Build(meshes[i].points.data(), meshes[i].tris.size());  
+	});
 	printf("[RESOURCE ADDED]\t%s\n", path);
 }
 
+void BVHScene::AddAnalytic(Scene const& scene)
+{
+	// the template scene joins as one more model, its meshes are shapes instead of triangles: 
+	PROFILE_SCOPE("Analytic BLAS build");
+	analyticScene = &scene; 
+	tinybvh::BVHBase* (*const builders[ANALYTIC_SHAPES_COUNT])() = 
+	{
+		&buildAnalytic<ANALYTIC_SHAPES_LIGHT>, 
+		&buildAnalytic<ANALYTIC_SHAPES_SPHERE>, 
+		&buildAnalytic<ANALYTIC_SHAPES_CUBE>, 
+		&buildAnalytic<ANALYTIC_SHAPES_FLOOR>, 
+		&buildAnalytic<ANALYTIC_SHAPES_TORUS>
+	}; 
+	Model& model = mResources.models.emplace_back(); 
+	model.mMeshes.resize(ANALYTIC_SHAPES_COUNT); 
+	model.mMats.reserve(ANALYTIC_SHAPES_COUNT); // the meshes point into it 
+	for (int shape = 0; shape < ANALYTIC_SHAPES_COUNT; shape++)
+	{
+		Material2& mat = model.mMats.emplace_back(INIT_DEFAULT_MATERIAL_TYPE); 
+		if (shape == ANALYTIC_SHAPES_LIGHT) mat.emissivity = ANALYTIC_LIGHT_EMISSIVITY; 
+		Mesh& mesh		= model.mMeshes[shape]; 
+		mesh.mat		= &mat; 
+		mesh.analytic	= shape; 
+		mResources.meshes.push_back(&mesh); 
+		mResources.blasses.push_back(builders[shape]()); 
+		mesh.blasIdx	= static_cast<uint32_t>(mResources.blasses.size()) - 1; 
+	}
+	AddModelInstance(static_cast<uint32_t>(mResources.models.size()) - 1); 
+	Rebuild(); 
+}
+
+void BVHScene::SetAnalyticVisible(bool const visible)
+{
+	// hidden shapes stay in the tlas, the traversal skips them by their mask: 
+	for (uint32_t instIdx = 0; instIdx < mInstances.size(); instIdx++)
+	{
+		if (IsAnalytic(instIdx)) mInstances[instIdx].mask = visible ? RAY_MASK_INTERSECT_ALL : 0; 
+	}
+	mVersion++; 
+}
+
 void BVHScene::AddModelInstance(uint32_t const modelIdx) 
 {
 	std::vector<Mesh> const& meshes = mResources.models[modelIdx].mMeshes; 
@@ -263,15 +671,63 @@ void BVHScene::SetInstanceMaterial(uint32_t const instIdx, uint32_t const matTyp
 	if (mMatCopies[instIdx].type != matType)
 	{
 		new (&mMatCopies[instIdx]) Material2(matType);
+		UpdateEmissives(); 
 	}
 }
 
 void BVHScene::ResetInstanceMaterial(uint32_t const instIdx)
 {
 	mMatCopies[instIdx] = *GetMesh(GetBlasIdx(instIdx)).mat;
+	UpdateEmissives(); 
 }
 
 void BVHScene::Rebuild()
 {
+	PROFILE_SCOPE("TLAS build");
 	mTlas.Build(mInstances.data(), mInstances.size(), mResources.blasses.data(), mResources.blasses.size());   
+	UpdateEmissives(); 
+}
+
+void BVHScene::UpdateEmissives()
+{
+	PROFILE_SCOPE("Emissives build");
+	mEmissives.Build(*this); 
+	mVersion++; 
+}
+
+void BVHScene::GatherMemory(memoryReport& report) const
+{
+	// every mesh belongs to one model, instances only point at their blas: 
+	std::vector<uint32_t> blasModels(mResources.blasses.size(), 0); 
+	for (uint32_t modelIdx = 0; modelIdx < mResources.models.size(); modelIdx++)
+	{
+		Model const& model = mResources.models[modelIdx]; 
+		sceneMemory bytes; 
+		for (Mesh const& mesh : model.mMeshes)
+		{
+			bytes += MeshMemory(mesh); 
+			blasModels[mesh.blasIdx] = modelIdx; 
+		}
+		for (TextureHandle const& texture : model.mTextures) bytes.mTextures += texture.Bytes(); 
+		report.mTags[MEMORY_TAGS_TRIANGLES]	+= bytes.mTris; 
+		report.mTags[MEMORY_TAGS_POINTS]	+= bytes.mPoints; 
+		report.mTags[MEMORY_TAGS_BLAS]		+= bytes.mBlas; 
+		report.mModels.push_back(bytes); 
+	}
+	for (tinybvh::BLASInstance const& inst : mInstances) report.mInstances.push_back({ blasModels[inst.blasIdx], inst.blasIdx, MeshMemory(GetMesh(inst.blasIdx)) }); 
+
+	report.mTags[MEMORY_TAGS_TLAS]		+= bvhBytes(mTlas) + vectorBytes(mInstances) + vectorBytes(mMatCopies); 
+	report.mTags[MEMORY_TAGS_LIGHTS]	+= vectorBytes(mEmissives.mTris) + vectorBytes(mEmissives.mProbs) + vectorBytes(mEmissives.mAliases) + 
+		vectorBytes(mEmissives.mInstFirst) + vectorBytes(mEmissives.mTriLookup); 
+}
+
+sceneMemory BVHScene::MeshMemory(Mesh const& mesh) const
+{
+	// analytic shapes have a binary bvh over one box, meshes the wide cpu layout: 
+	tinybvh::BVHBase const* blas = mResources.blasses[mesh.blasIdx]; 
+	sceneMemory bytes; 
+	bytes.mTris		= vectorBytes(mesh.tris); 
+	bytes.mPoints	= vectorBytes(mesh.points); 
+	bytes.mBlas		= mesh.analytic >= 0 ? bvhBytes(*static_cast<tinybvh::BVH const*>(blas)) : blasBytes(*static_cast<tinybvh::BVH8_CPU const*>(blas)); 
+	return bytes; 
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <../lib/tiny_bvh.h>
 
 #include "materials.h" 
+#include "emissives.h" 
 
 struct alignas(32) Tri
 {
@@ -17,12 +18,53 @@ struct alignas(32) Tri
 	// 24 bytes of unused padding
 };
 
+// shapes of the analytic template scene, each one a custom blas in the tlas
+enum analyticShapes : uint8_t
+{
+	ANALYTIC_SHAPES_LIGHT,
+	ANALYTIC_SHAPES_SPHERE,
+	ANALYTIC_SHAPES_CUBE,
+	ANALYTIC_SHAPES_FLOOR,
+	ANALYTIC_SHAPES_TORUS,
+	ANALYTIC_SHAPES_COUNT
+};
+
+float constexpr ANALYTIC_PLANE_EXTENT		= 100.0f;	// half size of the box the infinite floor is bounded by
+float constexpr ANALYTIC_LIGHT_EMISSIVITY	= 8.0f;
+
+// work one ray did in the scene, counted by the instrumented traversal
+struct traversalCost
+{
+	uint32_t	mNodes		= 0;	// tlas and blas nodes visited
+	uint32_t	mTris		= 0;	// ray-triangle tests
+	uint32_t	mInstances	= 0;	// blasses entered
+};
+
+// shadow ray with only what an occlusion query reads, a quarter of a tinybvh::Ray and its hit payload
+struct occlusionRay
+{
+	float3		mOrigin;
+	float		mMaxT		= BVH_FAR;
+	float3		mDirection;
+	uint32_t	mMask		= RAY_MASK_INTERSECT_ALL;
+
+	occlusionRay() = default;
+	occlusionRay(float3 const origin, float3 const direction, float const maxT = BVH_FAR, uint32_t const mask = RAY_MASK_INTERSECT_ALL) :
+		mOrigin(origin),
+		mMaxT(maxT),
+		mDirection(tinybvh::tinybvh_normalize(direction)),
+		mMask(mask & RAY_MASK_INTERSECT_ALL)
+	{}
+};
+static_assert(sizeof(occlusionRay) == 32, "occlusionRay should stay half a cache line");
+
 struct Mesh
 {
 	std::vector<Tri>	tris;	// per-triangle attributes
 	std::vector<float4> points; // for BVH traversal purely  
 	Material2*			mat;   
 	uint32_t			blasIdx; 
+	int					analytic = -1;	// analyticShapes of a custom blas, without triangles, -1 for a triangle mesh 
 };
 
 class Model
@@ -30,16 +72,18 @@ class Model
 public:
 	std::vector<Mesh>		mMeshes;
 	std::vector<Material2>	mMats;  
+	std::vector<TextureHandle> mTextures;	// the materials only hold views, these keep the texels alive 
 
 public:
+					Model() = default; 
 					Model(char const* path);  
 
 private:
 	void			Load(char const* path);  
 	void			ConvertAIMesh(aiMesh const& aiMesh, Mesh& mesh) const;  
-	void			ConvertAIMaterial(aiScene const& scene, aiMesh const& aiMesh, Mesh& mesh); 
-	Texture<float3>	LoadAIMaterialTexture(aiMaterial const& aiMat, aiTextureType const type);  
-	void			TraverseAINode(aiNode const& node, aiScene const& scene);
+	void			ConvertAIMaterial(aiScene const& scene, aiMesh const& aiMesh, Mesh& mesh, std::vector<std::string>& albedoPaths); 
+	std::string		AIMaterialTexturePath(aiMaterial const& aiMat, aiTextureType const type) const;	// empty without a map 
+	void			TraverseAINode(aiNode const& node, aiScene const& scene, std::vector<std::string>& albedoPaths);
 };
 
 struct BVHSceneResources
@@ -56,16 +100,25 @@ public:
 	BVHSceneResources					mResources;
 	std::vector<tinybvh::BLASInstance>	mInstances;  
 	std::vector<Material2>				mMatCopies; // per instance materials   
+	EmissiveRegistry					mEmissives; // world-space emissive triangles for next-event estimation 
+	uint32_t							mVersion = 0; // bumped on every geometry or material change, caches compare against it 
 
 public:
 			BVHScene();
 	bool	Intersect(tinybvh::Ray& ray); 
+	void	Resolve(tinybvh::Ray& ray); 
+	void	IntersectTriangle(tinybvh::Ray& ray, uint32_t const instIdx, uint32_t const primIdx) const; 
+	bool	IntersectCounted(tinybvh::Ray& ray, traversalCost& cost); 
 	void	AddResource(char const* path); 
 	void	AddModelInstance(uint32_t const modelIdx); 
 	void	AddInstance(uint32_t const blasIdx);
+	void	AddAnalytic(Scene const& scene); 
+	void	SetAnalyticVisible(bool const visible); 
 	void	SetInstanceMaterial(uint32_t const instIdx, uint32_t const matType);  
 	void	ResetInstanceMaterial(uint32_t const instIdx); 
 	void	Rebuild(); 
+	void	UpdateEmissives(); 
+	void	GatherMemory(memoryReport& report) const; 
 
 	[[nodiscard]] inline tinybvh::BLASInstance&			GetInstance(uint32_t const instIdx)			{ return mInstances[instIdx]; }
 	[[nodiscard]] inline tinybvh::BLASInstance const&	GetInstance(uint32_t const instIdx) const	{ return mInstances[instIdx]; }
@@ -76,6 +129,13 @@ public:
 	[[nodiscard]] inline uint32_t						GetBlasIdx(uint32_t const instIdx) const	{ return GetInstance(instIdx).blasIdx; } 
 	[[nodiscard]] inline Tri&							GetTriangle(tinybvh::Ray& ray)				{ return GetMesh(GetBlasIdx(ray.hit.inst)).tris[ray.hit.prim]; } 
 	[[nodiscard]] inline Tri const&						GetTriangle(tinybvh::Ray& ray) const		{ return GetMesh(GetBlasIdx(ray.hit.inst)).tris[ray.hit.prim]; } 
-	[[nodiscard]] __forceinline bool					IsOccluded(tinybvh::Ray const& ray) const	{ return mTlas.IsOccluded(ray); }
+	[[nodiscard]] bool									IsOccluded(occlusionRay const& shadow) const; 
+	void												IsOccluded(occlusionRay const* shadows, int const count, bool* occluded) const; // a flag per ray 
+	[[nodiscard]] inline bool							IsAnalytic(uint32_t const instIdx) const	{ return GetMesh(GetBlasIdx(instIdx)).analytic >= 0; }
+
+private:
+	void	ResolveAnalytic(tinybvh::Ray& ray, int const shape); 
+	[[nodiscard]] sceneMemory MeshMemory(Mesh const& mesh) const; 
+	void	IntersectBlasCounted(tinybvh::Ray& ray, uint32_t const instIdx, traversalCost& cost) const; 
 };
 
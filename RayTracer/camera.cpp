@@ -127,6 +127,113 @@ tinybvh::Ray Camera::GenPrimaryRayFocusedTinyBVH(float2 const pixel, blueSeed co
 	return { point, normalize(target - point) }; 
 }
 
+static __m256 sin8(__m256 const x)
+{
+	// taylor series like cos8, float precision on [-pi / 4, pi / 4]:
+	__m256 const x2 = _mm256_mul_ps(x, x);
+	__m256 p = _mm256_set1_ps(-1.0f / 5040.0f);
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.0f / 120.0f));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-1.0f / 6.0f));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.0f));
+	return _mm256_mul_ps(p, x);
+}
+
+static void concentricDisk8(__m256 const ux, __m256 const uy, __m256& dx, __m256& dy)
+{
+	// the mapping of concentricDisk, the angle of the other axis is a quarter turn minus the same ratio:
+	__m256 const one		= _mm256_set1_ps(1.0f);
+	__m256 const two		= _mm256_set1_ps(2.0f);
+	__m256 const ox			= _mm256_fmsub_ps(ux, two, one);
+	__m256 const oy			= _mm256_fmsub_ps(uy, two, one);
+	__m256 const xMajor		= _mm256_cmp_ps(abs8(ox), abs8(oy), _CMP_GT_OQ);
+	__m256 const r			= _mm256_blendv_ps(oy, ox, xMajor);
+	__m256 const other		= _mm256_blendv_ps(ox, oy, xMajor);
+
+	// r is only zero in the centre, which maps to itself whatever the angle:
+	__m256 const safe	= _mm256_blendv_ps(r, one, _mm256_cmp_ps(r, _mm256_setzero_ps(), _CMP_EQ_OQ));
+	__m256 const phi	= _mm256_mul_ps(_mm256_set1_ps(PI * 0.25f), _mm256_div_ps(other, safe));
+	__m256 const s		= sin8(phi);
+	__m256 const c		= cos8(phi);
+	dx = _mm256_mul_ps(_mm256_blendv_ps(s, c, xMajor), r);
+	dy = _mm256_mul_ps(_mm256_blendv_ps(c, s, xMajor), r);
+}
+
+void Camera::GenPrimaryRays(int const x, int const y, int const count, tinybvh::Ray* rays, float2 const* offsets, float2 const* lens) const
+{
+	// count rays along row y from pixel x, eight lanes at a time; offsets are added to the pixels like the 
+	// pixel of GenPrimaryRay, lens holds the samples the focused variants draw for randomUnitOnDisk:
+	__m256 topLeft[3], viewU[3], viewV[3], position[3], diskU[3], diskV[3];
+	for (int c = 0; c < 3; c++)
+	{
+		topLeft[c]	= _mm256_set1_ps(mTopLeft[c]);
+		viewU[c]	= _mm256_set1_ps(mViewportU[c] * (1.0f / SCRWIDTH));
+		viewV[c]	= _mm256_set1_ps(mViewportV[c] * (1.0f / SCRHEIGHT));
+		position[c] = _mm256_set1_ps(mPosition[c]);
+		diskU[c]	= _mm256_set1_ps(mDefocusDiskU[c]);
+		diskV[c]	= _mm256_set1_ps(mDefocusDiskV[c]);
+	}
+	__m256 const half		= _mm256_set1_ps(0.5f);
+	__m256 const far8		= _mm256_set1_ps(BVH_FAR);
+	__m256 const tiny		= _mm256_set1_ps(1e-12f);
+	__m256 const row		= _mm256_set1_ps(static_cast<float>(y) + 0.5f);
+
+	// the viewport is stepped in pixels, one add per block instead of a multiply per lane:
+	__m256 column = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x) + 0.5f), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+	for (int i = 0; i < count; i += 8, column = _mm256_add_ps(column, _mm256_set1_ps(8.0f)))
+	{
+		int const lanes = min(8, count - i);
+		alignas(32) float offsetX[8] = {}, offsetY[8] = {}, lensX[8], lensY[8];
+		if (offsets) for (int j = 0; j < lanes; j++) offsetX[j] = offsets[i + j].x, offsetY[j] = offsets[i + j].y;
+		__m256 const u = _mm256_add_ps(column, _mm256_load_ps(offsetX));
+		__m256 const v = _mm256_add_ps(row, _mm256_load_ps(offsetY));
+
+		__m256 origin[3], dir[3];
+		if (lens)
+		{
+			for (int j = 0; j < 8; j++) lensX[j] = lens[i + min(j, lanes - 1)].x, lensY[j] = lens[i + min(j, lanes - 1)].y;
+			__m256 dx, dy;
+			concentricDisk8(_mm256_load_ps(lensX), _mm256_load_ps(lensY), dx, dy);
+			for (int c = 0; c < 3; c++) origin[c] = _mm256_fmadd_ps(dx, diskU[c], _mm256_fmadd_ps(dy, diskV[c], position[c]));
+		}
+		else for (int c = 0; c < 3; c++) origin[c] = position[c];
+		for (int c = 0; c < 3; c++)
+		{
+			__m256 const target = _mm256_fmadd_ps(u, viewU[c], _mm256_fmadd_ps(v, viewV[c], topLeft[c]));
+			dir[c] = _mm256_sub_ps(target, origin[c]);
+		}
+
+		// rsqrt with one newton step is close enough to normalize:
+		__m256 const len2	= _mm256_fmadd_ps(dir[0], dir[0], _mm256_fmadd_ps(dir[1], dir[1], _mm256_mul_ps(dir[2], dir[2])));
+		__m256 const rsq	= _mm256_rsqrt_ps(len2);
+		__m256 const rl		= _mm256_mul_ps(_mm256_mul_ps(half, rsq), _mm256_fnmadd_ps(_mm256_mul_ps(len2, rsq), rsq, _mm256_set1_ps(3.0f)));
+
+		alignas(32) float out[9][8];
+		for (int c = 0; c < 3; c++)
+		{
+			// reciprocals as tinybvh_safercp, near-zero components point at the far plane:
+			__m256 const d			= _mm256_mul_ps(dir[c], rl);
+			__m256 const sign		= _mm256_blendv_ps(_mm256_sub_ps(_mm256_setzero_ps(), far8), far8, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+			__m256 const nearZero	= _mm256_cmp_ps(abs8(d), tiny, _CMP_LE_OQ);
+			_mm256_store_ps(out[c], origin[c]);
+			_mm256_store_ps(out[3 + c], d);
+			_mm256_store_ps(out[6 + c], _mm256_blendv_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), d), sign, nearZero));
+		}
+
+		// written field by field, the constructor would clear the whole ray first:
+		for (int j = 0; j < lanes; j++)
+		{
+			tinybvh::Ray& ray	= rays[i + j];
+			ray.O				= float3(out[0][j], out[1][j], out[2][j]);
+			ray.D				= float3(out[3][j], out[4][j], out[5][j]);
+			ray.rD				= float3(out[6][j], out[7][j], out[8][j]);
+			ray.mask			= RAY_MASK_INTERSECT_ALL;
+			ray.instIdx			= 0;
+			ray.hit				= {};
+			ray.hit.t			= BVH_FAR;
+		}
+	}
+}
+
 void Camera::UpdateBasisVectors()
 {
 	mAhead	= normalize(mTarget - mPosition);
@@ -0,0 +1,119 @@
+#include "precomp.h"
+#include "emissives.h"
+
+#include "bvh_scene.h"
+
+void EmissiveRegistry::Build(BVHScene const& scene)
+{
+	mTris.clear();
+	mTriLookup.clear();
+	mInstFirst.assign(scene.mInstances.size(), UINT32_MAX);
+	mTotalPower = 0.0f;
+	for (uint32_t instIdx = 0; instIdx < scene.mInstances.size(); instIdx++)
+	{
+		// analytic shapes have no triangles to sample, only bsdf sampling finds them:
+		Material2 const& mat = scene.GetMaterial(instIdx);
+		if (mat.emissivity <= 0.0f || scene.IsAnalytic(instIdx)) continue;
+
+		tinybvh::BLASInstance const& inst	= scene.GetInstance(instIdx);
+		Mesh const& mesh					= scene.GetMesh(inst.blasIdx);
+		mInstFirst[instIdx] = static_cast<uint32_t>(mTriLookup.size());
+		mTriLookup.resize(mTriLookup.size() + mesh.tris.size(), UINT32_MAX);
+		for (uint32_t primIdx = 0; primIdx < mesh.tris.size(); primIdx++)
+		{
+			Tri const& tri	= mesh.tris[primIdx];
+			float3 const p0 = tinybvh::tinybvh_transform_point(tri.points[0], inst.transform);
+			float3 const p1 = tinybvh::tinybvh_transform_point(tri.points[1], inst.transform);
+			float3 const p2 = tinybvh::tinybvh_transform_point(tri.points[2], inst.transform);
+
+			EmissiveTri e;
+			e.v0		= p0;
+			e.e1		= p1 - p0;
+			e.e2		= p2 - p0;
+			float3 const n = cross(e.e1, e.e2);
+			e.area		= length(n) * 0.5f;
+			if (e.area <= 0.0f) continue; // degenerate
+			e.normal	= n / (e.area * 2.0f);
+			e.power		= e.area * mat.emissivity;
+			e.instIdx	= instIdx;
+			e.primIdx	= primIdx;
+			mTotalPower += e.power;
+			mTriLookup[mInstFirst[instIdx] + primIdx] = static_cast<uint32_t>(mTris.size());
+			mTris.push_back(e);
+		}
+	}
+	BuildAliasTable();
+}
+
+void EmissiveRegistry::BuildAliasTable()
+{
+	// vose's alias method, o(1) power-proportional triangle selection:
+	uint32_t const n = static_cast<uint32_t>(mTris.size());
+	mProbs.resize(n);
+	mAliases.resize(n);
+	if (n == 0) return;
+
+	std::vector<uint32_t> small, large;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		mProbs[i]	= mTris[i].power * n / mTotalPower;
+		mAliases[i] = i;
+		(mProbs[i] < 1.0f ? small : large).push_back(i);
+	}
+	while (!small.empty() && !large.empty())
+	{
+		uint32_t const s = small.back(); small.pop_back();
+		uint32_t const l = large.back(); large.pop_back();
+		mAliases[s] = l;
+		mProbs[l]	= (mProbs[l] + mProbs[s]) - 1.0f;
+		(mProbs[l] < 1.0f ? small : large).push_back(l);
+	}
+	// leftovers are 1.0 up to rounding:
+	for (uint32_t i : small) mProbs[i] = 1.0f;
+	for (uint32_t i : large) mProbs[i] = 1.0f;
+}
+
+bool EmissiveRegistry::Sample(BVHScene const& scene, float const r0, float const r1, float const r2, emissiveSample& sample) const
+{
+	if (mTris.empty()) return false;
+
+	// pick a triangle:
+	float const scaled	= r0 * mTris.size();
+	uint32_t slot		= min(static_cast<uint32_t>(scaled), static_cast<uint32_t>(mTris.size() - 1));
+	uint32_t const idx	= (scaled - slot) < mProbs[slot] ? slot : mAliases[slot];
+	EmissiveTri const& e = mTris[idx];
+
+	// uniform point on the triangle, barycentrics match the ones of tinybvh hits:
+	float const su	= sqrtf(r1);
+	float const u	= 1.0f - su;
+	float const v	= r2 * su;
+	sample.point	= e.v0 + u * e.e1 + v * e.e2;
+	sample.normal	= e.normal;
+	sample.pdf		= (e.power / mTotalPower) / e.area;
+
+	Material2 const& mat = scene.GetMaterial(e.instIdx);
+	if (mat.type == MATERIAL_TYPES_TEXTURED)
+	{
+		Tri const& tri			= scene.GetMesh(scene.GetBlasIdx(e.instIdx)).tris[e.primIdx];
+		float2 const tcInterp	= berp(u, v, 1.0f - u - v, tri.texCoords[1], tri.texCoords[2], tri.texCoords[0]);
+		sample.radiance			= mat.textured.texture.Sample(tcInterp).albedo * mat.emissivity;
+	}
+	else
+	{
+		sample.radiance = WHITE * mat.emissivity;
+	}
+	return true;
+}
+
+float EmissiveRegistry::Pdf(uint32_t const instIdx, uint32_t const primIdx, float3 const& direction, float const dist) const
+{
+	// solid angle pdf of Sample() producing the point hit along direction:
+	if (instIdx >= mInstFirst.size() || mInstFirst[instIdx] == UINT32_MAX) return 0.0f;
+	uint32_t const triIdx = mTriLookup[mInstFirst[instIdx] + primIdx];
+	if (triIdx == UINT32_MAX) return 0.0f;
+
+	EmissiveTri const& e	= mTris[triIdx];
+	float const cosLight	= fabsf(dot(e.normal, direction));
+	if (cosLight <= 0.0f) return 0.0f;
+	return (e.power / mTotalPower) / e.area * dist * dist / cosLight;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+class BVHScene;
+
+// world-space copy of an emissive triangle
+struct EmissiveTri
+{
+	float3		v0;
+	float		area;
+	float3		e1;
+	float		power;
+	float3		e2;
+	uint32_t	instIdx;
+	float3		normal;
+	uint32_t	primIdx;
+};
+
+struct emissiveSample
+{
+	float3	point;
+	float3	normal;
+	color	radiance;
+	float	pdf;		// with respect to area
+};
+
+class EmissiveRegistry
+{
+public:
+	std::vector<EmissiveTri>	mTris;
+	std::vector<float>			mProbs;		// alias table, acceptance probability per slot
+	std::vector<uint32_t>		mAliases;	// alias table, fallback triangle per slot
+	std::vector<uint32_t>		mInstFirst;	// per instance, first entry in mTriLookup or UINT32_MAX
+	std::vector<uint32_t>		mTriLookup;	// per primitive of an emissive instance, index into mTris or UINT32_MAX
+	float						mTotalPower = 0.0f;
+
+public:
+	void						Build(BVHScene const& scene);
+	[[nodiscard]] bool			Sample(BVHScene const& scene, float const r0, float const r1, float const r2, emissiveSample& sample) const;
+	[[nodiscard]] float			Pdf(uint32_t const instIdx, uint32_t const primIdx, float3 const& direction, float const dist) const;
+	[[nodiscard]] inline bool	IsEmpty() const { return mTris.empty(); }
+
+private:
+	void						BuildAliasTable();
+};
@@ -38,10 +38,12 @@ void fileNotFound(char const* path)
 
 Texture<float3> loadTextureF(char const* path)  
 {
+	PROFILE_SCOPE("HDR load");
 	printLoading(path); 
 	if (!FileExists(path)) fileNotFound(path);  
 	int width, height, channels;
-	float* data = stbi_loadf(path, &width, &height, &channels, 0);
+	// always three channels, the copy below assumes rgb whatever the file holds:
+	float* data = stbi_loadf(path, &width, &height, &channels, 3);
 	Texture<float3> texture = Texture<float3>(width, height);
 	texture.mWidth = width; texture.mHeight = height;
 	memcpy(texture.mData, data, sizeof(float) * width * height * 3); 
@@ -0,0 +1,122 @@
+#include "precomp.h"
+#include "frame_arena.h"
+
+#include <memory>
+#include <mutex>
+
+// threads register their arena once, allocating after that takes no lock:
+static std::mutex								registry;
+static std::vector<std::unique_ptr<FrameArena>>	arenas;
+static thread_local FrameArena*					localArena = nullptr;
+static frameArenaStats							lastFrame;
+
+static size_t roundUp(size_t const bytes)
+{
+	return (bytes + FRAME_ARENA_ALIGNMENT - 1) & ~(FRAME_ARENA_ALIGNMENT - 1);
+}
+
+FrameArena::~FrameArena()
+{
+	for (frameArenaBlock const& block : mBlocks) FREE64(block.mData);
+}
+
+void* FrameArena::Alloc(size_t const bytes, size_t const align)
+{
+	assert(align <= FRAME_ARENA_ALIGNMENT && (align & (align - 1)) == 0);
+	mAllocs++;
+	for (;;)
+	{
+		if (mBlock < mBlocks.size())
+		{
+			frameArenaBlock const& block	= mBlocks[mBlock];
+			size_t const start				= (mOffset + align - 1) & ~(align - 1);
+			if (start + bytes <= block.mSize)
+			{
+				mUsed	+= start + bytes - mOffset;
+				mOffset	= start + bytes;
+				mPeak	= max(mPeak, mUsed);
+				return block.mData + start;
+			}
+			// the tail of a block that is too short stays unused until the scope closes:
+			if (mBlock + 1 < mBlocks.size())
+			{
+				mBlock++;
+				mOffset = 0;
+				continue;
+			}
+		}
+		Grow(bytes + align);
+	}
+}
+
+void FrameArena::Release(marker const& mark)
+{
+	mBlock	= mark.mBlock;
+	mOffset	= mark.mOffset;
+	mUsed	= mark.mUsed;
+}
+
+FrameArena& FrameArena::Local()
+{
+	if (!localArena)
+	{
+		std::lock_guard<std::mutex> lock(registry);
+		arenas.push_back(std::make_unique<FrameArena>());
+		localArena = arenas.back().get();
+	}
+	return *localArena;
+}
+
+void FrameArena::NewFrame()
+{
+	std::lock_guard<std::mutex> lock(registry);
+	lastFrame = {};
+	for (std::unique_ptr<FrameArena> const& arena : arenas)
+	{
+		for (frameArenaBlock const& block : arena->mBlocks) lastFrame.mCapacity += block.mSize;
+		lastFrame.mPeak			+= arena->mPeak;
+		lastFrame.mHeapAllocs	+= arena->mHeapAllocs;
+		lastFrame.mAllocs		+= arena->mAllocs;
+		lastFrame.mArenas++;
+		arena->Reset();
+	}
+	// job records come from the heap too until their pools have grown to the frame:
+	lastFrame.mHeapAllocs += Jobs::HeapAllocs();
+}
+
+frameArenaStats FrameArena::Stats()
+{
+	std::lock_guard<std::mutex> lock(registry);
+	return lastFrame;
+}
+
+void FrameArena::Reset()
+{
+	mHeapAllocs	= 0;
+	mAllocs		= 0;
+	mPeak		= 0;
+	mUsed		= 0;
+	mBlock		= 0;
+	mOffset		= 0;
+	if (mBlocks.size() <= 1) return;
+
+	// a frame that spilled into more blocks gets them as one, so the next frame fits without the heap:
+	size_t size = 0;
+	for (frameArenaBlock const& block : mBlocks)
+	{
+		size += block.mSize;
+		FREE64(block.mData);
+	}
+	mBlocks.clear();
+	mBlocks.push_back({ static_cast<uint8_t*>(MALLOC64(size)), size });
+	mHeapAllocs++;
+}
+
+void FrameArena::Grow(size_t const bytes)
+{
+	size_t const size = roundUp(max(bytes, mBlocks.empty() ? INIT_FRAME_ARENA_SIZE : mBlocks.back().mSize * 2));
+	mBlocks.push_back({ static_cast<uint8_t*>(MALLOC64(size)), size });
+	mBlock	= mBlocks.size() - 1;
+	mOffset	= 0;
+	mHeapAllocs++;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+size_t constexpr	FRAME_ARENA_ALIGNMENT	= 64;
+size_t constexpr	INIT_FRAME_ARENA_SIZE	= size_t(1) << 20;	// per thread, grows to the peak of a frame
+
+// statistics of the previous frame, summed over the threads
+struct frameArenaStats
+{
+	size_t		mCapacity		= 0;	// bytes held by all arenas
+	size_t		mPeak			= 0;	// sum of the peaks of every arena
+	uint32_t	mHeapAllocs		= 0;	// blocks and job records taken from the heap, zero once the frames are steady
+	uint32_t	mAllocs			= 0;	// requests served from the arenas
+	int			mArenas			= 0;
+};
+
+struct frameArenaBlock
+{
+	uint8_t*	mData;
+	size_t		mSize;
+};
+
+// bump allocator of one thread, everything handed out lives until the scope it came from closes
+// or the frame ends, nothing is freed on its own and no destructors run
+class FrameArena
+{
+public:
+	// position to return to, see FrameScope
+	struct marker
+	{
+		size_t	mBlock;
+		size_t	mOffset;
+		size_t	mUsed;
+	};
+
+public:
+	FrameArena() = default;
+	~FrameArena();
+	FrameArena(FrameArena const&)				= delete;
+	FrameArena& operator=(FrameArena const&)	= delete;
+
+	[[nodiscard]] void*		Alloc(size_t const bytes, size_t const align = 16);
+	template <typename T> [[nodiscard]] T* Alloc(size_t const count) { return static_cast<T*>(Alloc(count * sizeof(T), alignof(T))); }
+	[[nodiscard]] marker	Mark() const { return { mBlock, mOffset, mUsed }; }
+	void					Release(marker const& mark);
+
+	// arena of the calling thread, created on first use
+	[[nodiscard]] static FrameArena&		Local();
+	// rewinds every arena, only between frames when no job runs
+	static void								NewFrame();
+	[[nodiscard]] static frameArenaStats	Stats();
+
+private:
+	void					Reset();
+	void					Grow(size_t const bytes);
+
+	std::vector<frameArenaBlock>	mBlocks;
+	size_t							mBlock		= 0;	// block that is bumped right now
+	size_t							mOffset		= 0;
+	size_t							mUsed		= 0;	// bytes handed out this frame, padding included
+	size_t							mPeak		= 0;
+	uint32_t						mHeapAllocs	= 0;
+	uint32_t						mAllocs		= 0;
+};
+
+// hands back everything allocated on this thread since its construction,
+// so a loop over tiles needs no more memory than one tile
+class FrameScope
+{
+public:
+	FrameScope() : mArena(FrameArena::Local()), mMark(mArena.Mark()) {}
+	~FrameScope() { mArena.Release(mMark); }
+
+	FrameScope(FrameScope const&)				= delete;
+	FrameScope& operator=(FrameScope const&)	= delete;
+
+private:
+	FrameArena&			mArena;
+	FrameArena::marker	mMark;
+};
+
+// growable array in the arena of the calling thread, growing leaves the old storage behind until the scope closes,
+// only for types without destructors and never grown inside a scope opened after it
+template <typename T>
+class FrameVector
+{
+	static_assert(std::is_trivially_destructible_v<T>, "frame memory never runs destructors");
+
+public:
+	FrameVector() : mArena(&FrameArena::Local()) {}
+	explicit FrameVector(size_t const capacity) : FrameVector() { reserve(capacity); }
+
+	FrameVector(FrameVector const&)				= delete;
+	FrameVector& operator=(FrameVector const&)	= delete;
+
+	[[nodiscard]] inline T*			data()							{ return mData; }
+	[[nodiscard]] inline T const*	data() const					{ return mData; }
+	[[nodiscard]] inline T*			begin()							{ return mData; }
+	[[nodiscard]] inline T*			end()							{ return mData + mSize; }
+	[[nodiscard]] inline T const*	begin() const					{ return mData; }
+	[[nodiscard]] inline T const*	end() const						{ return mData + mSize; }
+	[[nodiscard]] inline size_t		size() const					{ return mSize; }
+	[[nodiscard]] inline bool		empty() const					{ return mSize == 0; }
+	[[nodiscard]] inline T&			operator[](size_t const i)		{ return mData[i]; }
+	[[nodiscard]] inline T const&	operator[](size_t const i) const { return mData[i]; }
+	inline void						clear()							{ mSize = 0; }
+	inline void						push_back(T const& value)
+	{
+		if (mSize == mCapacity) reserve(max(mCapacity * 2, size_t(16)));
+		new (mData + mSize++) T(value);
+	}
+	inline void						resize(size_t const size)
+	{
+		reserve(size);
+		for (size_t i = mSize; i < size; i++) new (mData + i) T();
+		mSize = size;
+	}
+	void							reserve(size_t const capacity)
+	{
+		if (capacity <= mCapacity) return;
+		T* const data = mArena->Alloc<T>(capacity);
+		std::uninitialized_copy(mData, mData + mSize, data);
+		mData		= data;
+		mCapacity	= capacity;
+	}
+
+private:
+	FrameArena*	mArena;
+	T*			mData		= nullptr;
+	size_t		mSize		= 0;
+	size_t		mCapacity	= 0;
+};
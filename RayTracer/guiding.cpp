@@ -0,0 +1,264 @@
+#include "precomp.h"
+#include "guiding.h"
+
+#include "light_tree.h"
+
+static int longestAxis(float3 const& extent)
+{
+	int axis = 0;
+	if (extent.y > extent.x) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+	return axis;
+}
+
+static uint32_t refineNode(std::vector<GuideQuadNode> const& sampling, uint32_t const samplingIdx, bool const hasSampling,
+						   float const share, float const total, int const depth, std::vector<GuideQuadNode>& building)
+{
+	// rebuilding from the root prunes quadrants that fell below the threshold:
+	uint32_t const nodeIdx = static_cast<uint32_t>(building.size());
+	building.emplace_back();
+	for (int q = 0; q < 4; q++)
+	{
+		float const sum = hasSampling ? sampling[samplingIdx].mSum[q] : share * 0.25f;
+		if (depth >= GUIDE_MAX_DTREE_DEPTH || sum <= GUIDE_DTREE_THRESHOLD * total) continue;
+
+		bool const hasChild		= hasSampling && sampling[samplingIdx].mChildren[q] != 0;
+		uint32_t const childIdx = refineNode(sampling, hasChild ? sampling[samplingIdx].mChildren[q] : 0, hasChild, sum, total, depth + 1, building);
+		building[nodeIdx].mChildren[q] = childIdx;
+	}
+	return nodeIdx;
+}
+
+void PathGuide::Reset(float3 const& aabbMin, float3 const& aabbMax)
+{
+	mSpatialNodes.assign(1, {});
+	mSpatialNodes[0].mMin	= aabbMin;
+	mSpatialNodes[0].mMax	= aabbMax;
+	mSpatialNodes[0].mDTree = 0;
+
+	mDTrees.assign(1, {});
+	mDTrees[0].mSampling.assign(1, {});
+	mDTrees[0].mBuilding.assign(1, {});
+
+	mIteration			= 0;
+	mIterationFrames	= 0;
+	AllocateRecords();
+}
+
+void PathGuide::EndFrame()
+{
+	PROFILE_SCOPE("Guide end frame");
+	// iteration k trains for 2^k frames, so every iteration sees as many samples as all earlier ones together:
+	if (!IsTraining()) return;
+	if (++mIterationFrames < (1 << mIteration)) return;
+	EndIteration();
+	mIteration++;
+	mIterationFrames = 0;
+}
+
+int PathGuide::Lookup(float3 const& point) const
+{
+	int nodeIdx = 0;
+	while (mSpatialNodes[nodeIdx].mChild >= 0)
+	{
+		GuideSpatialNode const& node	= mSpatialNodes[nodeIdx];
+		int const axis					= longestAxis(node.mMax - node.mMin);
+		float const split				= (node.mMin[axis] + node.mMax[axis]) * 0.5f;
+		nodeIdx = point[axis] < split ? node.mChild : node.mChild + 1;
+	}
+	return mSpatialNodes[nodeIdx].mDTree;
+}
+
+bool PathGuide::Sample(int const dTree, float r0, float r1, float3& direction, float& pdf) const
+{
+	GuideDTree const& tree = mDTrees[dTree];
+	if (tree.mTotal <= 0.0f) return false;
+
+	float2 origin	= float2(0.0f, 0.0f);
+	float size		= 1.0f;
+	pdf				= 1.0f;
+	uint32_t nodeIdx = 0;
+	while (true)
+	{
+		GuideQuadNode const& node	= tree.mSampling[nodeIdx];
+		float const* s				= node.mSum;
+		float const total			= s[0] + s[1] + s[2] + s[3];
+		int x = 0, y = 0;
+		if (total > 0.0f)
+		{
+			// pick the column, then the row within it, rescaling r so it can be reused further down:
+			float const pLeft = (s[0] + s[2]) / total;
+			if (r0 < pLeft) r0 = r0 / pLeft;
+			else { r0 = (r0 - pLeft) / (1.0f - pLeft); x = 1; }
+			float const column	= s[x] + s[x + 2];
+			float const pTop	= column > 0.0f ? s[x] / column : 0.5f;
+			if (r1 < pTop) r1 = r1 / pTop;
+			else { r1 = (r1 - pTop) / (1.0f - pTop); y = 1; }
+			pdf *= 4.0f * s[x + y * 2] / total;
+		}
+		else
+		{
+			x = r0 < 0.5f ? 0 : 1; r0 = r0 * 2.0f - x;
+			y = r1 < 0.5f ? 0 : 1; r1 = r1 * 2.0f - y;
+		}
+		r0 = min(r0, 0.99999994f);
+		r1 = min(r1, 0.99999994f);
+
+		size *= 0.5f;
+		origin += float2(static_cast<float>(x), static_cast<float>(y)) * size;
+		uint32_t const child = node.mChildren[x + y * 2];
+		if (child == 0) break;
+		nodeIdx = child;
+	}
+	direction	= squareToDirection(origin + float2(r0, r1) * size);
+	pdf			*= 0.25f * INVPI; // square to sphere
+	return pdf > 0.0f;
+}
+
+float PathGuide::Pdf(int const dTree, float3 const& direction) const
+{
+	GuideDTree const& tree = mDTrees[dTree];
+	if (tree.mTotal <= 0.0f) return 0.0f;
+
+	float2 p		= directionToSquare(direction);
+	float pdf		= 0.25f * INVPI;
+	uint32_t nodeIdx = 0;
+	while (true)
+	{
+		GuideQuadNode const& node	= tree.mSampling[nodeIdx];
+		float const total			= node.mSum[0] + node.mSum[1] + node.mSum[2] + node.mSum[3];
+		int const x = p.x < 0.5f ? 0 : 1;
+		int const y = p.y < 0.5f ? 0 : 1;
+		if (total > 0.0f) pdf *= 4.0f * node.mSum[x + y * 2] / total;
+		p = p * 2.0f - float2(static_cast<float>(x), static_cast<float>(y));
+
+		uint32_t const child = node.mChildren[x + y * 2];
+		if (child == 0) return pdf;
+		nodeIdx = child;
+	}
+}
+
+void PathGuide::Record(float3 const& point, float3 const& direction, float const radiance)
+{
+	int const dTree = Lookup(point);
+	mSampleCounts[dTree].fetch_add(1, std::memory_order_relaxed);
+	if (radiance <= 0.0f) return;
+
+	GuideDTree const& tree	= mDTrees[dTree];
+	float2 p				= directionToSquare(direction);
+	uint32_t nodeIdx		= 0;
+	while (true)
+	{
+		int const x = p.x < 0.5f ? 0 : 1;
+		int const y = p.y < 0.5f ? 0 : 1;
+		p = p * 2.0f - float2(static_cast<float>(x), static_cast<float>(y));
+
+		uint32_t const child = tree.mBuilding[nodeIdx].mChildren[x + y * 2];
+		if (child == 0)
+		{
+			atomicAdd(mRecords[tree.mRecordOffset + nodeIdx * 4 + x + y * 2], radiance);
+			return;
+		}
+		nodeIdx = child;
+	}
+}
+
+void PathGuide::RecordPath(guideVertex const* vertices, int const count, color const& light)
+{
+	for (int i = 0; i < count; i++)
+	{
+		// radiance that arrived along the sampled direction, without the throughput up to the vertex:
+		guideVertex const& v	= vertices[i];
+		color const arrived		= light - v.mLight;
+		color incident			= BLACK;
+		for (int c = 0; c < 3; c++) if (v.mThroughput[c] > 0.0f) incident[c] = arrived[c] / v.mThroughput[c];
+		Record(v.mPoint, v.mDirection, max(0.0f, luminance(incident)) / v.mPdf);
+	}
+}
+
+void PathGuide::EndIteration()
+{
+	// the recorded sums become the sampling distributions, interior quadrants hold the sum of their children:
+	for (GuideDTree& tree : mDTrees)
+	{
+		for (int nodeIdx = static_cast<int>(tree.mBuilding.size()) - 1; nodeIdx >= 0; nodeIdx--)
+		{
+			GuideQuadNode& node = tree.mBuilding[nodeIdx];
+			for (int q = 0; q < 4; q++)
+			{
+				uint32_t const child = node.mChildren[q];
+				if (child == 0) node.mSum[q] = mRecords[tree.mRecordOffset + nodeIdx * 4 + q].load(std::memory_order_relaxed);
+				else node.mSum[q] = tree.mBuilding[child].mSum[0] + tree.mBuilding[child].mSum[1] + tree.mBuilding[child].mSum[2] + tree.mBuilding[child].mSum[3];
+			}
+		}
+		tree.mSampling	= tree.mBuilding;
+		GuideQuadNode const& root = tree.mSampling[0];
+		tree.mTotal		= root.mSum[0] + root.mSum[1] + root.mSum[2] + root.mSum[3];
+	}
+
+	// split crowded spatial leaves, children inherit half the samples and a copy of the distribution:
+	float const threshold = GUIDE_SPATIAL_THRESHOLD * sqrtf(static_cast<float>(1 << mIteration));
+	std::vector<float> counts(mSpatialNodes.size());
+	for (size_t i = 0; i < mSpatialNodes.size(); i++)
+	{
+		int const dTree = mSpatialNodes[i].mDTree;
+		counts[i] = dTree >= 0 ? static_cast<float>(mSampleCounts[dTree].load(std::memory_order_relaxed)) : 0.0f;
+	}
+	for (size_t i = 0; i < mSpatialNodes.size(); i++)
+	{
+		if (mSpatialNodes[i].mChild >= 0 || counts[i] <= threshold) continue;
+
+		GuideSpatialNode const parent	= mSpatialNodes[i];
+		int const axis					= longestAxis(parent.mMax - parent.mMin);
+		float const split				= (parent.mMin[axis] + parent.mMax[axis]) * 0.5f;
+		GuideSpatialNode left = parent, right = parent;
+		left.mMax[axis]		= split;
+		right.mMin[axis]	= split;
+		right.mDTree		= static_cast<int>(mDTrees.size());
+		mDTrees.push_back(mDTrees[parent.mDTree]);
+
+		mSpatialNodes[i].mChild = static_cast<int>(mSpatialNodes.size());
+		mSpatialNodes[i].mDTree = -1;
+		mSpatialNodes.push_back(left);
+		mSpatialNodes.push_back(right);
+		counts.push_back(counts[i] * 0.5f);
+		counts.push_back(counts[i] * 0.5f);
+	}
+
+	// refine the directional structure the next iteration records into:
+	for (GuideDTree& tree : mDTrees)
+	{
+		tree.mBuilding.clear();
+		refineNode(tree.mSampling, 0, true, tree.mTotal, tree.mTotal, 0, tree.mBuilding);
+	}
+	AllocateRecords();
+}
+
+void PathGuide::AllocateRecords()
+{
+	uint32_t total = 0;
+	for (GuideDTree& tree : mDTrees)
+	{
+		tree.mRecordOffset = total;
+		total += static_cast<uint32_t>(tree.mBuilding.size()) * 4;
+	}
+	mRecords		= std::vector<std::atomic<float>>(total);
+	mSampleCounts	= std::vector<std::atomic<uint32_t>>(mDTrees.size());
+	for (std::atomic<float>& record : mRecords) record.store(0.0f, std::memory_order_relaxed);
+	for (std::atomic<uint32_t>& count : mSampleCounts) count.store(0, std::memory_order_relaxed);
+}
+
+float2 directionToSquare(float3 const& direction)
+{
+	// cylindrical mapping, equal-area so the pdf scales by a constant 1 / (4 pi):
+	float const phi = atan2f(direction.y, direction.x);
+	return float2(clamp((direction.z + 1.0f) * 0.5f, 0.0f, 0.99999994f), clamp((phi < 0.0f ? phi + TWOPI : phi) * INV2PI, 0.0f, 0.99999994f));
+}
+
+float3 squareToDirection(float2 const& p)
+{
+	float const cosTheta	= 2.0f * p.x - 1.0f;
+	float const sinTheta	= sqrtf(max(0.0f, 1.0f - cosTheta * cosTheta));
+	float const phi			= TWOPI * p.y;
+	return float3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+}
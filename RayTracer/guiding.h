@@ -0,0 +1,74 @@
+#pragma once
+
+int constexpr	GUIDE_MAX_VERTICES				= 10;		// matches the max bounces slider
+int constexpr	GUIDE_MAX_DTREE_DEPTH			= 20;
+float constexpr GUIDE_DTREE_THRESHOLD			= 0.01f;	// energy fraction above which a quadrant subdivides
+int constexpr	GUIDE_SPATIAL_THRESHOLD			= 12000;		// samples before a spatial leaf splits, grows with sqrt(2^iteration)
+int constexpr	INIT_GUIDE_TRAINING_ITERATIONS	= 9;		// iteration k lasts 2^k frames
+float constexpr INIT_GUIDE_BSDF_FRACTION		= 0.5f;		// one-sample mis probability of sampling the bsdf
+
+// scatter vertex of a path, kept until the path ends so its incident radiance is known
+struct guideVertex
+{
+	float3	mPoint;
+	float	mPdf;			// mixture pdf the direction was sampled with
+	float3	mDirection;
+	color	mLight;			// path radiance right after this vertex
+	color	mThroughput;	// path throughput right after this vertex
+};
+
+// directional quadtree node over the cylindrical mapping of the sphere
+struct GuideQuadNode
+{
+	float		mSum[4]		= { 0.0f, 0.0f, 0.0f, 0.0f };
+	uint32_t	mChildren[4]	= { 0, 0, 0, 0 };	// zero for leaf quadrants, the root is never a child
+};
+
+struct GuideDTree
+{
+	std::vector<GuideQuadNode>	mSampling;			// distribution learned in the previous iteration
+	std::vector<GuideQuadNode>	mBuilding;			// structure recorded into now, its sums live in PathGuide::mRecords
+	float						mTotal			= 0.0f;
+	uint32_t					mRecordOffset	= 0;
+};
+
+struct GuideSpatialNode
+{
+	float3	mMin;
+	int		mChild	= -1;	// second child is mChild + 1, split halfway along the longest axis
+	float3	mMax;
+	int		mDTree	= -1;	// leaves only
+};
+
+// spatial kd-tree with directional quadtrees of incident radiance, after muller et al.
+class PathGuide
+{
+public:
+	std::vector<GuideSpatialNode>		mSpatialNodes;
+	std::vector<GuideDTree>				mDTrees;
+	std::vector<std::atomic<float>>		mRecords;		// four sums per building node, added to lock-free while rendering
+	std::vector<std::atomic<uint32_t>>	mSampleCounts;	// per dtree
+	int									mIteration			= 0;
+	int									mIterationFrames	= 0;
+	int									mTrainingIterations	= INIT_GUIDE_TRAINING_ITERATIONS;
+	float								mBsdfFraction		= INIT_GUIDE_BSDF_FRACTION;
+
+public:
+	void						Reset(float3 const& aabbMin, float3 const& aabbMax);
+	void						EndFrame();
+	[[nodiscard]] int			Lookup(float3 const& point) const;
+	[[nodiscard]] bool			Sample(int const dTree, float r0, float r1, float3& direction, float& pdf) const;
+	[[nodiscard]] float			Pdf(int const dTree, float3 const& direction) const;
+	void						Record(float3 const& point, float3 const& direction, float const radiance);
+	void						RecordPath(guideVertex const* vertices, int const count, color const& light);
+
+	[[nodiscard]] inline bool	IsTraining() const						{ return mIteration < mTrainingIterations; }
+	[[nodiscard]] inline bool	HasDistribution(int const dTree) const	{ return mDTrees[dTree].mTotal > 0.0f; }
+
+private:
+	void						EndIteration();
+	void						AllocateRecords();
+};
+
+[[nodiscard]] float2	directionToSquare(float3 const& direction);
+[[nodiscard]] float3	squareToDirection(float2 const& p);
@@ -0,0 +1,379 @@
+#include "precomp.h"
+#include "jobs.h"
+
+#include <memory>
+#include <thread>
+#ifdef _WIN32
+#pragma comment(lib, "Synchronization.lib")
+#else
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// the captures of a split fit the inline buffer of std::function, so only the record itself needs a home:
+struct job
+{
+	std::function<void()>	mWork;
+	JobCounter*				mCounter;
+	job*					mNext;		// in a free list
+};
+
+// records are recycled through a free list per thread, a thread that frees more than it takes,
+// like a thief finishing the jobs of the submitting thread, passes them on in batches through the shared one
+struct jobPool
+{
+	job*	mFree	= nullptr;
+	int		mCount	= 0;
+
+	~jobPool()
+	{
+		while (job* const j = mFree)
+		{
+			mFree = j->mNext;
+			delete j;
+		}
+	}
+};
+
+static std::unique_ptr<JobDeque[]>	deques;
+static std::vector<std::thread>		workers;
+static std::mutex					injectedLock;
+static std::vector<job*>			injected;				// submitted from threads outside the scheduler
+static std::atomic<int>				injectedCount	= 0;
+static std::mutex					backgroundLock;
+static std::vector<job*>			background;				// the newest first, those are still wanted most
+static std::atomic<int>				backgroundCount	= 0;
+static std::atomic<uint32_t>		epoch			= 0;	// moves on every submit, sleeping workers wait for it to change
+static std::atomic<int>				sleeping		= 0;
+static std::atomic<bool>			running			= false;
+static int							threadCount		= 1;
+static thread_local int				threadIdx		= -1;
+static std::mutex					sharedLock;
+static jobPool						shared;
+static thread_local jobPool			local;
+static std::atomic<uint32_t>		heapAllocs		= 0;
+
+static job* allocJob()
+{
+	if (!local.mFree)
+	{
+		std::lock_guard<std::mutex> lock(sharedLock);
+		for (int i = 0; i < JOBS_POOL_BATCH && shared.mFree; i++)
+		{
+			job* const j	= shared.mFree;
+			shared.mFree	= j->mNext;
+			j->mNext		= local.mFree;
+			local.mFree		= j;
+			shared.mCount--;
+			local.mCount++;
+		}
+	}
+	if (job* const j = local.mFree)
+	{
+		local.mFree = j->mNext;
+		local.mCount--;
+		return j;
+	}
+	heapAllocs.fetch_add(1, std::memory_order_relaxed);
+	return new job;
+}
+
+static void freeJob(job* const j)
+{
+	// the work goes now, its captures may hold resources:
+	j->mWork	= nullptr;
+	j->mNext	= local.mFree;
+	local.mFree	= j;
+	if (++local.mCount < 2 * JOBS_POOL_BATCH) return;
+
+	std::lock_guard<std::mutex> lock(sharedLock);
+	for (int i = 0; i < JOBS_POOL_BATCH; i++)
+	{
+		job* const next	= local.mFree;
+		local.mFree		= next->mNext;
+		next->mNext		= shared.mFree;
+		shared.mFree	= next;
+		local.mCount--;
+		shared.mCount++;
+	}
+}
+
+static void waitOnAddress(std::atomic<uint32_t>& value, uint32_t expected)
+{
+	// returns right away when the value has already moved on, so a submit between the check and the wait is not lost:
+#ifdef _WIN32
+	WaitOnAddress(&value, &expected, sizeof(uint32_t), INFINITE);
+#else
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#endif
+}
+
+static void wakeAddress(std::atomic<uint32_t>& value, bool const all)
+{
+#ifdef _WIN32
+	if (all) WakeByAddressAll(&value); else WakeByAddressSingle(&value);
+#else
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0);
+#endif
+}
+
+static void pinThread(std::thread& thread, int const core)
+{
+#ifdef _WIN32
+	SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+bool JobDeque::Push(job* const j)
+{
+	int64_t const b = mBottom.load(std::memory_order_relaxed);
+	int64_t const t = mTop.load(std::memory_order_acquire);
+	if (b - t >= JOBS_DEQUE_SIZE) return false;
+	// release stores instead of the fence of the paper, the same on x86 and visible to race checkers:
+	mJobs[b & (JOBS_DEQUE_SIZE - 1)].store(j, std::memory_order_release);
+	mBottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+job* JobDeque::Pop()
+{
+	int64_t const b = mBottom.load(std::memory_order_relaxed) - 1;
+	mBottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = mTop.load(std::memory_order_relaxed);
+	if (t > b)
+	{
+		mBottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	job* j = mJobs[b & (JOBS_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// the last job, a thief may be taking it at the same time:
+		if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) j = nullptr;
+		mBottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return j;
+}
+
+job* JobDeque::Steal()
+{
+	int64_t t = mTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t const b = mBottom.load(std::memory_order_acquire);
+	if (t >= b) return nullptr;
+	job* const j = mJobs[t & (JOBS_DEQUE_SIZE - 1)].load(std::memory_order_acquire);
+	if (!mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+	return j;
+}
+
+void Jobs::Init(int const threads, bool const pin)
+{
+	PROFILE_SCOPE("Jobs::Init");
+	int const hardware	= max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	threadCount			= min(threads > 0 ? threads : hardware, JOBS_MAX_THREADS);
+	deques				= std::make_unique<JobDeque[]>(threadCount);
+	threadIdx			= 0;
+	running.store(true, std::memory_order_release);
+
+	// the calling thread is thread 0 and works whenever it waits, so one worker fewer than threads:
+	for (int i = 1; i < threadCount; i++)
+	{
+		workers.emplace_back(&Jobs::WorkerLoop, i);
+		if (pin) pinThread(workers.back(), i);
+	}
+}
+
+void Jobs::Shutdown()
+{
+	running.store(false, std::memory_order_release);
+	epoch.fetch_add(1, std::memory_order_seq_cst);
+	wakeAddress(epoch, true);
+	for (std::thread& worker : workers) worker.join();
+	workers.clear();
+}
+
+static job* makeJob(std::function<void()> work, JobCounter* const counter)
+{
+	job* const j	= allocJob();
+	j->mWork		= std::move(work);
+	j->mCounter		= counter;
+	if (counter) counter->mPending.fetch_add(1, std::memory_order_relaxed);
+	return j;
+}
+
+void Jobs::Submit(std::function<void()> work, JobCounter* const counter, JobCounter* const after)
+{
+	job* const j = makeJob(std::move(work), counter);
+	if (after)
+	{
+		// parked on the group it depends on, the thread that finishes that group schedules it:
+		std::lock_guard<std::mutex> lock(after->mLock);
+		if (!after->Done())
+		{
+			after->mContinuations.push_back(j);
+			return;
+		}
+	}
+	Schedule(j);
+}
+
+void Jobs::SubmitBackground(std::function<void()> work, JobCounter* const counter)
+{
+	// never on the deque of the submitting worker, that would run it inside the frame as soon as its own jobs are done:
+	job* const j = makeJob(std::move(work), counter);
+	{
+		std::lock_guard<std::mutex> lock(backgroundLock);
+		background.push_back(j);
+		backgroundCount.fetch_add(1, std::memory_order_release);
+	}
+	epoch.fetch_add(1, std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_seq_cst) > 0) wakeAddress(epoch, false);
+}
+
+void Jobs::Wait(JobCounter& counter)
+{
+	// the own deque comes first, so nested groups finish before stolen work is started,
+	// background work is left to the workers unless there are none:
+	int const self				= threadIdx;
+	bool const takeBackground	= workers.empty();
+	for (int idle = 0; !counter.Done();)
+	{
+		if (job* const j = Find(self, takeBackground))
+		{
+			Run(j);
+			idle = 0;
+		}
+		else if (++idle < JOBS_SPIN_ROUNDS) _mm_pause();
+		else std::this_thread::yield();
+	}
+
+	// the thread that finished the group may still be releasing its continuations:
+	std::lock_guard<std::mutex> lock(counter.mLock);
+}
+
+int Jobs::ThreadCount()
+{
+	return threadCount;
+}
+
+int Jobs::ThreadIdx()
+{
+	return threadIdx;
+}
+
+uint32_t Jobs::HeapAllocs()
+{
+	return heapAllocs.exchange(0, std::memory_order_relaxed);
+}
+
+void Jobs::Run(job* const j)
+{
+	j->mWork();
+	JobCounter* const counter = j->mCounter;
+	freeJob(j);
+	if (!counter) return;
+
+	// counted down under the lock, so a waiter that sees zero can not free the counter while it is in use here:
+	std::vector<job*> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->mLock);
+		if (counter->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) released.swap(counter->mContinuations);
+	}
+	for (job* const next : released) Schedule(next);
+}
+
+job* Jobs::Find(int const self, bool const takeBackground)
+{
+	if (self >= 0) if (job* const j = deques[self].Pop()) return j;
+	if (injectedCount.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(injectedLock);
+		if (!injected.empty())
+		{
+			job* const j = injected.back();
+			injected.pop_back();
+			injectedCount.fetch_sub(1, std::memory_order_relaxed);
+			return j;
+		}
+	}
+
+	// every thief starts at another victim, so they do not all queue up on the same deque:
+	static thread_local uint32_t seed = 0x9e3779b9u * static_cast<uint32_t>(self + 2);
+	seed ^= seed << 13, seed ^= seed >> 17, seed ^= seed << 5;
+	for (int i = 0, start = static_cast<int>(seed % threadCount); i < threadCount; i++)
+	{
+		int const victim = (start + i) % threadCount;
+		if (victim == self) continue;
+		if (job* const j = deques[victim].Steal()) return j;
+	}
+
+	if (takeBackground && backgroundCount.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(backgroundLock);
+		if (!background.empty())
+		{
+			job* const j = background.back();
+			background.pop_back();
+			backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+			return j;
+		}
+	}
+	return nullptr;
+}
+
+void Jobs::WorkerLoop(int const self)
+{
+	threadIdx = self;
+	for (int idle = 0; running.load(std::memory_order_acquire);)
+	{
+		if (job* const j = Find(self, true))
+		{
+			Run(j);
+			idle = 0;
+			continue;
+		}
+		if (++idle < JOBS_SPIN_ROUNDS)
+		{
+			_mm_pause();
+			continue;
+		}
+
+		// look once more after announcing the sleep, a submit in between moves the epoch and the wait falls through:
+		uint32_t const seen = epoch.load(std::memory_order_seq_cst);
+		sleeping.fetch_add(1, std::memory_order_seq_cst);
+		job* const j = Find(self, true);
+		if (!j && running.load(std::memory_order_acquire)) waitOnAddress(epoch, seen);
+		sleeping.fetch_sub(1, std::memory_order_seq_cst);
+		if (j) Run(j);
+		idle = 0;
+	}
+}
+
+void Jobs::Schedule(job* const j)
+{
+	bool queued = true;
+	if (threadIdx >= 0) queued = deques[threadIdx].Push(j);
+	else
+	{
+		std::lock_guard<std::mutex> lock(injectedLock);
+		injected.push_back(j);
+		injectedCount.fetch_add(1, std::memory_order_release);
+	}
+
+	// a full deque runs the job right here, which only makes the split coarser:
+	if (!queued)
+	{
+		Run(j);
+		return;
+	}
+	epoch.fetch_add(1, std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_seq_cst) > 0) wakeAddress(epoch, false);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+int constexpr	JOBS_DEQUE_SIZE			= 1 << 12;	// jobs per thread, a thread with a full deque runs new jobs itself
+int constexpr	JOBS_MAX_THREADS		= 64;
+int constexpr	JOBS_SPIN_ROUNDS		= 64;		// failed steals before a worker goes to sleep
+int constexpr	JOBS_POOL_BATCH			= 256;		// job records a thread hands to or takes from the shared pool at once
+bool constexpr	INIT_JOBS_PIN_THREADS	= false;	// one worker per logical core, in order
+
+struct job;
+
+// unfinished jobs of a group, jobs submitted after it start once it drops to zero
+class JobCounter
+{
+public:
+	std::atomic<int>	mPending = 0;
+
+public:
+	[[nodiscard]] inline bool Done() const { return mPending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class Jobs;
+	std::mutex			mLock;
+	std::vector<job*>	mContinuations;
+};
+
+// chase-lev deque after le et al. 2013, the owner pushes and pops at the bottom, thieves take from the top
+class JobDeque
+{
+public:
+	[[nodiscard]] bool	Push(job* const j);
+	[[nodiscard]] job*	Pop();
+	[[nodiscard]] job*	Steal();
+
+private:
+	alignas(64) std::atomic<int64_t>	mTop	= 0;
+	alignas(64) std::atomic<int64_t>	mBottom = 0;
+	std::atomic<job*>					mJobs[JOBS_DEQUE_SIZE];
+};
+
+// persistent workers behind one scheduler for the frame, the loaders and the builds,
+// so work that overlaps never asks for more threads than there are cores
+class Jobs
+{
+public:
+	static void						Init(int const threads = 0, bool const pin = INIT_JOBS_PIN_THREADS);	// 0 takes every logical core
+	static void						Shutdown();
+	static void						Submit(std::function<void()> work, JobCounter* const counter = nullptr, JobCounter* const after = nullptr);
+	// only taken by a worker that finds nothing else, for loads that should not hold up the frame that asks for them
+	static void						SubmitBackground(std::function<void()> work, JobCounter* const counter = nullptr);
+	static void						Wait(JobCounter& counter);	// the waiting thread runs jobs meanwhile
+	[[nodiscard]] static int		ThreadCount();
+	[[nodiscard]] static int		ThreadIdx();				// 0 on the thread that called Init
+	[[nodiscard]] static uint32_t	HeapAllocs();				// job records taken from the heap since the last call
+
+	// body(i) for every i in [begin, end), split down to grain iterations per job
+	template <typename F> static void ParallelFor(int const begin, int const end, int const grain, F const& body);
+	// body(x0, y0, x1, y1) for every tile of the size x size range, tiles in row order
+	template <typename F> static void ParallelFor2D(int2 const size, int2 const tile, F const& body);
+
+private:
+	template <typename F> static void Split(int const begin, int end, int const grain, F const& body, JobCounter& counter);
+	static void						Schedule(job* const j);
+	static void						Run(job* const j);
+	[[nodiscard]] static job*		Find(int const self, bool const takeBackground);
+	static void						WorkerLoop(int const self);
+};
+
+template <typename F>
+void Jobs::ParallelFor(int const begin, int const end, int const grain, F const& body)
+{
+	if (end <= begin) return;
+	JobCounter counter;
+	Split(begin, end, max(grain, 1), body, counter);
+	Wait(counter);
+}
+
+template <typename F>
+void Jobs::ParallelFor2D(int2 const size, int2 const tile, F const& body)
+{
+	int const tilesX = (size.x + tile.x - 1) / tile.x;
+	int const tilesY = (size.y + tile.y - 1) / tile.y;
+	ParallelFor(0, tilesX * tilesY, 1, [&](int const t)
+	{
+		int const x0 = (t % tilesX) * tile.x;
+		int const y0 = (t / tilesX) * tile.y;
+		body(x0, y0, min(x0 + tile.x, size.x), min(y0 + tile.y, size.y));
+	});
+}
+
+template <typename F>
+void Jobs::Split(int const begin, int end, int const grain, F const& body, JobCounter& counter)
+{
+	// the upper halves go to the deque for thieves, the lower half is split further right here:
+	while (end - begin > grain)
+	{
+		int const mid = begin + (end - begin) / 2;
+		Submit([mid, end, grain, &body, &counter]() { Split(mid, end, grain, body, counter); }, &counter);
+		end = mid;
+	}
+	for (int i = begin; i < end; i++) body(i);
+}
@@ -0,0 +1,335 @@
+#include "precomp.h"
+#include "light_buffer.h"
+
+#include "renderer.h"
+#include "bvh_scene.h"
+
+typedef void(*lightKernelFunc)(LightBuffer const& buffer, float3 const point, float3 const normal, FrameVector<lightCandidate>& candidates);
+
+static void gatherScalar(LightBuffer const& buffer, float3 const point, float3 const normal, FrameVector<lightCandidate>& candidates)
+{
+	float const* px = buffer.Field(LIGHT_BUFFER_FIELDS_POS_X);
+	float const* py = buffer.Field(LIGHT_BUFFER_FIELDS_POS_Y);
+	float const* pz = buffer.Field(LIGHT_BUFFER_FIELDS_POS_Z);
+	float const* r	= buffer.Field(LIGHT_BUFFER_FIELDS_R);
+	float const* g	= buffer.Field(LIGHT_BUFFER_FIELDS_G);
+	float const* b	= buffer.Field(LIGHT_BUFFER_FIELDS_B);
+	float const* dx = buffer.Field(LIGHT_BUFFER_FIELDS_DIR_X);
+	float const* dy = buffer.Field(LIGHT_BUFFER_FIELDS_DIR_Y);
+	float const* dz = buffer.Field(LIGHT_BUFFER_FIELDS_DIR_Z);
+	float const* co = buffer.Field(LIGHT_BUFFER_FIELDS_COS_OUTER);
+	float const* ie = buffer.Field(LIGHT_BUFFER_FIELDS_INV_EPSILON);
+	for (uint32_t i = 0; i < buffer.mCount; i++)
+	{
+		float3 const position	= float3(px[i], py[i], pz[i]);
+		float3 dir				= point - position;
+		float const dist2		= dot(dir, dir);
+		float const invDist		= 1.0f / sqrtf(dist2);
+		dir *= invDist;
+
+		float const cosa	= max(0.0f, -dot(normal, dir));
+		float const theta	= dir.x * dx[i] + dir.y * dy[i] + dir.z * dz[i];
+		float const fallOff = clamp((theta - co[i]) * ie[i], 0.0f, 1.0f);
+		float const scale	= cosa * fallOff * invDist * invDist;
+		if (scale > 0.0f) candidates.push_back({ position, color(r[i], g[i], b[i]) * scale });
+	}
+}
+
+static void gatherSSE(LightBuffer const& buffer, float3 const point, float3 const normal, FrameVector<lightCandidate>& candidates)
+{
+	__m128 const px4	= _mm_set1_ps(point.x);
+	__m128 const py4	= _mm_set1_ps(point.y);
+	__m128 const pz4	= _mm_set1_ps(point.z);
+	__m128 const nx4	= _mm_set1_ps(normal.x);
+	__m128 const ny4	= _mm_set1_ps(normal.y);
+	__m128 const nz4	= _mm_set1_ps(normal.z);
+	__m128 const zero4	= _mm_setzero_ps();
+	__m128 const one4	= _mm_set1_ps(1.0f);
+	for (uint32_t i = 0; i < buffer.mPadded; i += 4)
+	{
+		// dir = normalize(point - position):
+		__m128 dx4 = _mm_sub_ps(px4, _mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_POS_X) + i));
+		__m128 dy4 = _mm_sub_ps(py4, _mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_POS_Y) + i));
+		__m128 dz4 = _mm_sub_ps(pz4, _mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_POS_Z) + i));
+		__m128 const invDist4 = _mm_div_ps(one4, length(dx4, dy4, dz4));
+		dx4 = _mm_mul_ps(dx4, invDist4);
+		dy4 = _mm_mul_ps(dy4, invDist4);
+		dz4 = _mm_mul_ps(dz4, invDist4);
+
+		// cosa * fallOff / dist^2:
+		__m128 const cosa4		= _mm_max_ps(zero4, negate(dot(nx4, ny4, nz4, dx4, dy4, dz4)));
+		__m128 const theta4		= dot(dx4, dy4, dz4,
+			_mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_DIR_X) + i),
+			_mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_DIR_Y) + i),
+			_mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_DIR_Z) + i));
+		__m128 const fallOff4	= _mm_min_ps(one4, _mm_max_ps(zero4, _mm_mul_ps(
+			_mm_sub_ps(theta4, _mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_COS_OUTER) + i)),
+			_mm_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_INV_EPSILON) + i))));
+		__m128 const scale4		= _mm_mul_ps(_mm_mul_ps(cosa4, fallOff4), _mm_mul_ps(invDist4, invDist4));
+
+		int const mask = _mm_movemask_ps(_mm_cmpgt_ps(scale4, zero4));
+		if (!mask) continue;
+		alignas(16) float scale[4];
+		_mm_store_ps(scale, scale4);
+		for (int lane = 0; lane < 4; lane++) if (mask & (1 << lane))
+		{
+			uint32_t const idx = i + lane;
+			float3 const position	= float3(buffer.Field(LIGHT_BUFFER_FIELDS_POS_X)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_POS_Y)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_POS_Z)[idx]);
+			color const c			= color(buffer.Field(LIGHT_BUFFER_FIELDS_R)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_G)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_B)[idx]);
+			candidates.push_back({ position, c * scale[lane] });
+		}
+	}
+}
+
+static void gatherAVX2(LightBuffer const& buffer, float3 const point, float3 const normal, FrameVector<lightCandidate>& candidates)
+{
+	__m256 const px8	= _mm256_set1_ps(point.x);
+	__m256 const py8	= _mm256_set1_ps(point.y);
+	__m256 const pz8	= _mm256_set1_ps(point.z);
+	__m256 const nx8	= _mm256_set1_ps(normal.x);
+	__m256 const ny8	= _mm256_set1_ps(normal.y);
+	__m256 const nz8	= _mm256_set1_ps(normal.z);
+	__m256 const zero8	= _mm256_setzero_ps();
+	__m256 const one8	= _mm256_set1_ps(1.0f);
+	for (uint32_t i = 0; i < buffer.mPadded; i += 8)
+	{
+		// dir = normalize(point - position):
+		__m256 dx8 = _mm256_sub_ps(px8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_POS_X) + i));
+		__m256 dy8 = _mm256_sub_ps(py8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_POS_Y) + i));
+		__m256 dz8 = _mm256_sub_ps(pz8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_POS_Z) + i));
+		__m256 const dist28		= _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx8, dx8), _mm256_mul_ps(dy8, dy8)), _mm256_mul_ps(dz8, dz8));
+		__m256 const invDist8	= _mm256_div_ps(one8, _mm256_sqrt_ps(dist28));
+		dx8 = _mm256_mul_ps(dx8, invDist8);
+		dy8 = _mm256_mul_ps(dy8, invDist8);
+		dz8 = _mm256_mul_ps(dz8, invDist8);
+
+		// cosa * fallOff / dist^2:
+		__m256 const nDotD8		= _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx8, dx8), _mm256_mul_ps(ny8, dy8)), _mm256_mul_ps(nz8, dz8));
+		__m256 const cosa8		= _mm256_max_ps(zero8, _mm256_sub_ps(zero8, nDotD8));
+		__m256 const theta8		= _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(dx8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_DIR_X) + i)),
+			_mm256_mul_ps(dy8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_DIR_Y) + i))),
+			_mm256_mul_ps(dz8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_DIR_Z) + i)));
+		__m256 const fallOff8	= _mm256_min_ps(one8, _mm256_max_ps(zero8, _mm256_mul_ps(
+			_mm256_sub_ps(theta8, _mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_COS_OUTER) + i)),
+			_mm256_load_ps(buffer.Field(LIGHT_BUFFER_FIELDS_INV_EPSILON) + i))));
+		__m256 const scale8		= _mm256_mul_ps(_mm256_mul_ps(cosa8, fallOff8), _mm256_mul_ps(invDist8, invDist8));
+
+		int const mask = _mm256_movemask_ps(_mm256_cmp_ps(scale8, zero8, _CMP_GT_OQ));
+		if (!mask) continue;
+		alignas(32) float scale[8];
+		_mm256_store_ps(scale, scale8);
+		for (int lane = 0; lane < 8; lane++) if (mask & (1 << lane))
+		{
+			uint32_t const idx = i + lane;
+			float3 const position	= float3(buffer.Field(LIGHT_BUFFER_FIELDS_POS_X)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_POS_Y)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_POS_Z)[idx]);
+			color const c			= color(buffer.Field(LIGHT_BUFFER_FIELDS_R)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_G)[idx], buffer.Field(LIGHT_BUFFER_FIELDS_B)[idx]);
+			candidates.push_back({ position, c * scale[lane] });
+		}
+	}
+}
+
+static lightKernelFunc lightKernelDispatchTable[LIGHT_KERNELS_COUNT] =
+{
+	gatherScalar,
+	gatherSSE,
+	gatherAVX2
+};
+
+LightBuffer::LightBuffer()
+{
+	mKernel = bestLightKernel();
+}
+
+LightBuffer::~LightBuffer()
+{
+	FREE64(mData);
+}
+
+void LightBuffer::Build(std::vector<PointLight> const& pointLights, std::vector<Spotlight> const& spotlights,
+						TexturedSpotlight const* texturedSpotlight, bool const pointLightsEnabled, bool const spotlightsEnabled)
+{
+	uint32_t const pointCount	= pointLightsEnabled ? static_cast<uint32_t>(pointLights.size()) : 0;
+	uint32_t const spotCount	= spotlightsEnabled ? static_cast<uint32_t>(spotlights.size()) : 0;
+	mCount = pointCount + spotCount;
+	uint32_t const padded = (mCount + LIGHT_BUFFER_LANES - 1) / LIGHT_BUFFER_LANES * LIGHT_BUFFER_LANES;
+	if (padded != mPadded)
+	{
+		FREE64(mData);
+		mPadded = padded;
+		mData	= mPadded ? static_cast<float*>(MALLOC64(mPadded * LIGHT_BUFFER_FIELDS_COUNT * sizeof(float))) : nullptr;
+	}
+
+	uint32_t i = 0;
+	for (uint32_t j = 0; j < pointCount; j++)
+	{
+		PointLight const& l = pointLights[j];
+		color const c = l.mColor * l.mStrength;
+		Field(LIGHT_BUFFER_FIELDS_POS_X)[i]			= l.mPosition.x;
+		Field(LIGHT_BUFFER_FIELDS_POS_Y)[i]			= l.mPosition.y;
+		Field(LIGHT_BUFFER_FIELDS_POS_Z)[i]			= l.mPosition.z;
+		Field(LIGHT_BUFFER_FIELDS_R)[i]				= c.r;
+		Field(LIGHT_BUFFER_FIELDS_G)[i]				= c.g;
+		Field(LIGHT_BUFFER_FIELDS_B)[i]				= c.b;
+		Field(LIGHT_BUFFER_FIELDS_DIR_X)[i]			= 0.0f;
+		Field(LIGHT_BUFFER_FIELDS_DIR_Y)[i]			= 0.0f;
+		Field(LIGHT_BUFFER_FIELDS_DIR_Z)[i]			= 0.0f;
+		Field(LIGHT_BUFFER_FIELDS_COS_OUTER)[i]		= -2.0f;
+		Field(LIGHT_BUFFER_FIELDS_INV_EPSILON)[i]	= 1.0f;
+		i++;
+	}
+	for (uint32_t j = 0; j < spotCount; j++)
+	{
+		Spotlight const& l = spotlights[j];
+		color const c = l.mColor * l.mStrength;
+		Field(LIGHT_BUFFER_FIELDS_POS_X)[i]			= l.mPosition.x;
+		Field(LIGHT_BUFFER_FIELDS_POS_Y)[i]			= l.mPosition.y;
+		Field(LIGHT_BUFFER_FIELDS_POS_Z)[i]			= l.mPosition.z;
+		Field(LIGHT_BUFFER_FIELDS_R)[i]				= c.r;
+		Field(LIGHT_BUFFER_FIELDS_G)[i]				= c.g;
+		Field(LIGHT_BUFFER_FIELDS_B)[i]				= c.b;
+		Field(LIGHT_BUFFER_FIELDS_DIR_X)[i]			= l.mDirection.x;
+		Field(LIGHT_BUFFER_FIELDS_DIR_Y)[i]			= l.mDirection.y;
+		Field(LIGHT_BUFFER_FIELDS_DIR_Z)[i]			= l.mDirection.z;
+		Field(LIGHT_BUFFER_FIELDS_COS_OUTER)[i]		= l.GetOuterScalar();
+		Field(LIGHT_BUFFER_FIELDS_INV_EPSILON)[i]	= 1.0f / l.GetEpsilon();
+		i++;
+	}
+	// padding lanes sit far away and are black, they never become candidates:
+	for (; i < mPadded; i++)
+	{
+		Field(LIGHT_BUFFER_FIELDS_POS_X)[i] = Field(LIGHT_BUFFER_FIELDS_POS_Y)[i] = Field(LIGHT_BUFFER_FIELDS_POS_Z)[i] = LARGE_FLOAT;
+		for (int field = LIGHT_BUFFER_FIELDS_R; field < LIGHT_BUFFER_FIELDS_COUNT; field++) Field(field)[i] = 0.0f;
+	}
+
+	mTexturedSpotlights.clear();
+	if (texturedSpotlight) mTexturedSpotlights.push_back(texturedSpotlight);
+}
+
+void LightBuffer::Gather(float3 const point, float3 const normal, FrameVector<lightCandidate>& candidates) const
+{
+	candidates.clear();
+	if (mPadded) lightKernelDispatchTable[mKernel](*this, point, normal, candidates);
+	for (TexturedSpotlight const* l : mTexturedSpotlights)
+	{
+		color const c = l->Unshadowed(point, normal);
+		if (c.x > 0.0f || c.y > 0.0f || c.z > 0.0f) candidates.push_back({ l->mPosition, c });
+	}
+}
+
+color LightBuffer::Evaluate(Intersection const& hit) const
+{
+	FrameScope const scope;
+	FrameVector<lightCandidate> candidates;
+	Gather(hit.point, hit.normal, candidates);
+
+	// all shading is done, the shadow rays are set up first and traced eight at a time:
+	FrameVector<Ray> shadows(candidates.size());
+	for (lightCandidate const& c : candidates)
+	{
+		float3 dir = c.mPosition - hit.point;
+		float const dist = length(dir);
+		dir /= dist;
+		shadows.push_back(Ray(hit.point + dir * Renderer::sEps, dir, dist - 2.0f * Renderer::sEps));
+	}
+	color result = BLACK;
+	for (size_t first = 0; first < shadows.size(); first += PACKET_WIDTH)
+	{
+		int const count	= static_cast<int>(min(shadows.size() - first, static_cast<size_t>(PACKET_WIDTH)));
+		int const mask	= hit.scene->IsOccluded8(Ray8(&shadows[first], count));
+		for (int i = 0; i < count; i++) if (!((mask >> i) & 1)) result += candidates[first + i].mContribution;
+	}
+	return result;
+}
+
+color LightBuffer::Evaluate(BVHScene const& scene, tinybvh::Ray const& ray) const
+{
+	FrameScope const scope;
+	FrameVector<lightCandidate> candidates;
+	Gather(ray.hit.point, ray.hit.normal, candidates);
+
+	// all shading is done, the shadow rays are set up first and traced as one batch:
+	FrameVector<occlusionRay> shadows(candidates.size());
+	FrameVector<bool> occluded(candidates.size());
+	for (lightCandidate const& c : candidates)
+	{
+		float3 dir = c.mPosition - ray.hit.point;
+		float const dist = length(dir);
+		dir /= dist;
+		shadows.push_back({ ray.hit.point + dir * Renderer::sEps, dir, dist - 2.0f * Renderer::sEps });
+	}
+	occluded.resize(shadows.size());
+	scene.IsOccluded(shadows.data(), static_cast<int>(shadows.size()), occluded.data());
+	color result = BLACK;
+	for (size_t i = 0; i < shadows.size(); i++) if (!occluded[i]) result += candidates[i].mContribution;
+	return result;
+}
+
+void LightBuffer::SetKernel(int const kernel)
+{
+	mKernel = isLightKernelSupported(kernel) ? kernel : bestLightKernel();
+}
+
+int bestLightKernel()
+{
+	if (CPUCaps::HW_AVX2)	return LIGHT_KERNELS_AVX2;
+	if (CPUCaps::HW_SSE41)	return LIGHT_KERNELS_SSE;
+	return LIGHT_KERNELS_SCALAR;
+}
+
+bool isLightKernelSupported(int const kernel)
+{
+	switch (kernel)
+	{
+	case LIGHT_KERNELS_SCALAR:	return true;
+	case LIGHT_KERNELS_SSE:		return CPUCaps::HW_SSE41;
+	case LIGHT_KERNELS_AVX2:	return CPUCaps::HW_AVX2;
+	default:					return false;
+	}
+}
+
+void benchmarkLightKernels()
+{
+	static int constexpr LIGHT_COUNTS[]	= { 4, 64, 1024 };
+	static int constexpr POINT_COUNT	= 1 << 16;
+	static char const* KERNEL_NAMES[]	= { "scalar", "sse", "avx2" };
+
+	// random shading points facing up, lights scattered above them:
+	std::vector<float3> points(POINT_COUNT);
+	for (float3& p : points) p = float3(RandomFloat() * 10.0f - 5.0f, 0.0f, RandomFloat() * 10.0f - 5.0f);
+	float3 const normal = float3(0.0f, 1.0f, 0.0f);
+
+	printf("[LIGHT KERNELS]\t%d shading points, unshadowed\n", POINT_COUNT);
+	for (int const count : LIGHT_COUNTS)
+	{
+		std::vector<PointLight> pointLights(count / 2);
+		std::vector<Spotlight>	spotlights(count - count / 2);
+		for (PointLight& l : pointLights) l.mPosition = float3(RandomFloat() * 10.0f - 5.0f, 1.0f + RandomFloat() * 4.0f, RandomFloat() * 10.0f - 5.0f);
+		for (Spotlight& l : spotlights)
+		{
+			l.mPosition = float3(RandomFloat() * 10.0f - 5.0f, 1.0f + RandomFloat() * 4.0f, RandomFloat() * 10.0f - 5.0f);
+			l.mLookAt	= float3(l.mPosition.x, 0.0f, l.mPosition.z);
+			l.DirectionFromLookAt();
+		}
+		LightBuffer buffer;
+		buffer.Build(pointLights, spotlights, nullptr, true, true);
+
+		FrameScope const scope;
+		FrameVector<lightCandidate> candidates;
+		printf("\t%4d lights:", count);
+		for (int kernel = 0; kernel < LIGHT_KERNELS_COUNT; kernel++)
+		{
+			if (!isLightKernelSupported(kernel)) continue;
+			buffer.mKernel = kernel;
+			color sum = BLACK;
+			Timer timer;
+			for (float3 const& p : points)
+			{
+				buffer.Gather(p, normal, candidates);
+				for (lightCandidate const& c : candidates) sum += c.mContribution;
+			}
+			printf("  %s %.2fms (%.1f)", KERNEL_NAMES[kernel], timer.elapsed() * 1000.0f, sum.x + sum.y + sum.z);
+		}
+		printf("\n");
+	}
+}
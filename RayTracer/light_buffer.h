@@ -0,0 +1,69 @@
+#pragma once
+
+#include "lights.h"
+
+struct Intersection;
+class BVHScene;
+
+int constexpr LIGHT_BUFFER_LANES = 8; // widest batch, sse processes two halves
+
+enum lightKernels : uint8_t
+{
+	LIGHT_KERNELS_SCALAR,
+	LIGHT_KERNELS_SSE,
+	LIGHT_KERNELS_AVX2,
+	LIGHT_KERNELS_COUNT
+};
+
+enum lightBufferFields : uint8_t
+{
+	LIGHT_BUFFER_FIELDS_POS_X,
+	LIGHT_BUFFER_FIELDS_POS_Y,
+	LIGHT_BUFFER_FIELDS_POS_Z,
+	LIGHT_BUFFER_FIELDS_R,			// color * strength
+	LIGHT_BUFFER_FIELDS_G,
+	LIGHT_BUFFER_FIELDS_B,
+	LIGHT_BUFFER_FIELDS_DIR_X,		// spot axis, zero for point lights
+	LIGHT_BUFFER_FIELDS_DIR_Y,
+	LIGHT_BUFFER_FIELDS_DIR_Z,
+	LIGHT_BUFFER_FIELDS_COS_OUTER,	// -2 for point lights so the falloff saturates
+	LIGHT_BUFFER_FIELDS_INV_EPSILON,
+	LIGHT_BUFFER_FIELDS_COUNT
+};
+
+// light that passed the unshadowed evaluation and still needs a shadow ray
+struct lightCandidate
+{
+	float3	mPosition;
+	color	mContribution;
+};
+
+// point lights and spotlights in SoA layout, padded to whole batches of eight
+class LightBuffer
+{
+public:
+	float*									mData		= nullptr;
+	uint32_t								mCount		= 0;
+	uint32_t								mPadded		= 0;
+	std::vector<TexturedSpotlight const*>	mTexturedSpotlights;	// evaluated per light, texture lookups do not vectorize
+	int										mKernel		= LIGHT_KERNELS_SCALAR;
+
+public:
+									LightBuffer();
+									LightBuffer(LightBuffer const&) = delete;
+									~LightBuffer();
+	LightBuffer&					operator=(LightBuffer const&) = delete;
+	void							Build(std::vector<PointLight> const& pointLights, std::vector<Spotlight> const& spotlights,
+										  TexturedSpotlight const* texturedSpotlight, bool const pointLightsEnabled, bool const spotlightsEnabled);
+	void							Gather(float3 const point, float3 const normal, FrameVector<lightCandidate>& candidates) const;
+	[[nodiscard]] color				Evaluate(Intersection const& hit) const;
+	[[nodiscard]] color				Evaluate(BVHScene const& scene, tinybvh::Ray const& ray) const;
+	void							SetKernel(int const kernel);
+
+	[[nodiscard]] inline float*			Field(int const field)			{ return mData + field * mPadded; }
+	[[nodiscard]] inline float const*	Field(int const field) const	{ return mData + field * mPadded; }
+};
+
+[[nodiscard]] int	bestLightKernel();
+[[nodiscard]] bool	isLightKernelSupported(int const kernel);
+void				benchmarkLightKernels();
@@ -0,0 +1,244 @@
+#include "precomp.h"
+#include "light_tree.h"
+
+#include "renderer.h"
+#include "bvh_scene.h"
+
+static LightTreeNode pointLightBounds(PointLight const& light)
+{
+	LightTreeNode node;
+	node.mAabbMin	= light.mPosition;
+	node.mAabbMax	= light.mPosition;
+	node.mPower		= light.mStrength * luminance(light.mColor);
+	node.mAxis		= float3(0.0f, 1.0f, 0.0f);
+	node.mThetaO	= PI;			// emits in all directions
+	node.mThetaE	= PI * 0.5f;
+	node.mLeft		= -1;
+	node.mLightIdx	= -1;
+	return node;
+}
+
+static LightTreeNode spotlightBounds(Spotlight const& light)
+{
+	LightTreeNode node;
+	node.mAabbMin	= light.mPosition;
+	node.mAabbMax	= light.mPosition;
+	node.mPower		= light.mStrength * luminance(light.mColor);
+	node.mAxis		= light.mDirection;
+	node.mThetaO	= 0.0f;
+	node.mThetaE	= acosf(clamp(light.GetOuterScalar(), -1.0f, 1.0f));
+	node.mLeft		= -1;
+	node.mLightIdx	= -1;
+	return node;
+}
+
+void LightTree::Build(std::vector<PointLight> const& pointLights, std::vector<Spotlight> const& spotlights,
+					  bool const pointLightsEnabled, bool const spotlightsEnabled)
+{
+	mPointLights	= &pointLights;
+	mSpotlights		= &spotlights;
+	mNodes.clear();
+	mLights.clear();
+
+	// gather a leaf for every light that can contribute:
+	std::vector<LightTreeNode> leaves;
+	if (pointLightsEnabled) for (uint32_t i = 0; i < pointLights.size(); i++)
+	{
+		LightTreeNode leaf = pointLightBounds(pointLights[i]);
+		if (leaf.mPower <= 0.0f) continue;
+		leaf.mLightIdx = static_cast<int>(mLights.size());
+		mLights.push_back({ i, LIGHT_TYPES_POINT });
+		leaves.push_back(leaf);
+	}
+	if (spotlightsEnabled) for (uint32_t i = 0; i < spotlights.size(); i++)
+	{
+		LightTreeNode leaf = spotlightBounds(spotlights[i]);
+		if (leaf.mPower <= 0.0f) continue;
+		leaf.mLightIdx = static_cast<int>(mLights.size());
+		mLights.push_back({ i, LIGHT_TYPES_SPOT });
+		leaves.push_back(leaf);
+	}
+	if (leaves.empty()) return;
+
+	mNodes.reserve(leaves.size() * 2 - 1);
+	mNodes.emplace_back();
+	Subdivide(leaves, 0, 0, static_cast<int>(leaves.size()));
+}
+
+void LightTree::Subdivide(std::vector<LightTreeNode>& leaves, int const nodeIdx, int const first, int const count)
+{
+	if (count == 1)
+	{
+		mNodes[nodeIdx] = leaves[first];
+		return;
+	}
+
+	// median split along the largest centroid extent keeps the depth at log2(n):
+	float3 cMin = LARGE_FLOAT, cMax = -LARGE_FLOAT;
+	for (int i = first; i < first + count; i++)
+	{
+		float3 const c = (leaves[i].mAabbMin + leaves[i].mAabbMax) * 0.5f;
+		cMin = fminf(cMin, c);
+		cMax = fmaxf(cMax, c);
+	}
+	float3 const extent = cMax - cMin;
+	int axis = 0;
+	if (extent.y > extent.x) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	int const half = count / 2;
+	std::nth_element(leaves.begin() + first, leaves.begin() + first + half, leaves.begin() + first + count,
+		[axis](LightTreeNode const& a, LightTreeNode const& b)
+		{
+			return a.mAabbMin[axis] + a.mAabbMax[axis] < b.mAabbMin[axis] + b.mAabbMax[axis];
+		});
+
+	int const left = static_cast<int>(mNodes.size());
+	mNodes.emplace_back();
+	mNodes.emplace_back();
+	Subdivide(leaves, left, first, half);
+	Subdivide(leaves, left + 1, first + half, count - half);
+
+	mNodes[nodeIdx]				= mergeBounds(mNodes[left], mNodes[left + 1]);
+	mNodes[nodeIdx].mLeft		= left;
+	mNodes[nodeIdx].mLightIdx	= -1;
+}
+
+bool LightTree::Sample(float3 const point, float3 const normal, float const r, lightRef& light, float& pdf) const
+{
+	int const lightIdx = SampleIdx(point, normal, r, pdf);
+	if (lightIdx < 0) return false;
+	light = mLights[lightIdx];
+	return true;
+}
+
+int LightTree::SampleIdx(float3 const point, float3 const normal, float r, float& pdf) const
+{
+	if (mNodes.empty()) return -1;
+
+	pdf = 1.0f;
+	int nodeIdx = 0;
+	while (mNodes[nodeIdx].mLightIdx < 0)
+	{
+		int const left		= mNodes[nodeIdx].mLeft;
+		float const iLeft	= importance(mNodes[left], point, normal);
+		float const iRight	= importance(mNodes[left + 1], point, normal);
+		float const total	= iLeft + iRight;
+		if (total <= 0.0f) return -1;
+
+		// pick a child and rescale r so it can be reused further down:
+		float const pLeft = iLeft / total;
+		if (r < pLeft)
+		{
+			r		= r / pLeft;
+			pdf		*= pLeft;
+			nodeIdx	= left;
+		}
+		else
+		{
+			r		= (r - pLeft) / (1.0f - pLeft);
+			pdf		*= 1.0f - pLeft;
+			nodeIdx	= left + 1;
+		}
+		r = min(r, 0.99999994f);
+	}
+	return pdf > 0.0f ? mNodes[nodeIdx].mLightIdx : -1;
+}
+
+color LightTree::Unshadowed(int const lightIdx, float3 const point, float3 const normal) const
+{
+	lightRef const light = mLights[lightIdx];
+	return light.mType == LIGHT_TYPES_POINT ?
+		(*mPointLights)[light.mIdx].Unshadowed(point, normal) : (*mSpotlights)[light.mIdx].Unshadowed(point, normal);
+}
+
+float3 LightTree::Position(int const lightIdx) const
+{
+	lightRef const light = mLights[lightIdx];
+	return light.mType == LIGHT_TYPES_POINT ? (*mPointLights)[light.mIdx].mPosition : (*mSpotlights)[light.mIdx].mPosition;
+}
+
+color LightTree::EvaluateStochastic(Intersection const& hit) const
+{
+	lightRef	light;
+	float		pdf;
+	if (!Sample(hit.point, hit.normal, Sampler::Get1D(), light, pdf)) return BLACK;
+	color const intensity = light.mType == LIGHT_TYPES_POINT ?
+		(*mPointLights)[light.mIdx].Intensity(hit) : (*mSpotlights)[light.mIdx].Intensity(hit);
+	return intensity / pdf;
+}
+
+color LightTree::EvaluateStochastic(BVHScene const& scene, tinybvh::Ray const& ray) const
+{
+	lightRef	light;
+	float		pdf;
+	if (!Sample(ray.hit.point, ray.hit.normal, Sampler::Get1D(), light, pdf)) return BLACK;
+	color const intensity = light.mType == LIGHT_TYPES_POINT ?
+		(*mPointLights)[light.mIdx].Intensity(scene, ray) : (*mSpotlights)[light.mIdx].Intensity(scene, ray);
+	return intensity / pdf;
+}
+
+float luminance(color const& c)
+{
+	return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+}
+
+float importance(LightTreeNode const& node, float3 const point, float3 const normal)
+{
+	float3 const centroid	= (node.mAabbMin + node.mAabbMax) * 0.5f;
+	float3 const toLight	= centroid - point;
+	float const radius		= length(node.mAabbMax - node.mAabbMin) * 0.5f;
+	float const dist2		= dot(toLight, toLight);
+	float const dist		= sqrtf(dist2);
+	if (dist < 1e-6f) return node.mPower / max(radius * radius, 1e-6f);
+	float3 const wi			= toLight / dist;
+
+	// angle subtended by the bounding sphere of the node:
+	float const thetaU = dist <= radius ? PI : asinf(radius / dist);
+
+	// emitter side, how far the point lies outside the orientation cone:
+	float const theta	= acosf(clamp(dot(node.mAxis, -wi), -1.0f, 1.0f));
+	float const thetaP	= max(0.0f, theta - node.mThetaO - thetaU);
+	if (thetaP >= node.mThetaE) return 0.0f;
+
+	// receiver side, bounded cosine with the surface normal:
+	float const thetaI	= acosf(clamp(dot(normal, wi), -1.0f, 1.0f));
+	float const thetaIP	= max(0.0f, thetaI - thetaU);
+	if (thetaIP >= PI * 0.5f) return 0.0f;
+
+	return node.mPower * cosf(thetaP) * cosf(thetaIP) / max(dist2, radius * radius);
+}
+
+LightTreeNode mergeBounds(LightTreeNode const& a, LightTreeNode const& b)
+{
+	LightTreeNode node;
+	node.mAabbMin	= fminf(a.mAabbMin, b.mAabbMin);
+	node.mAabbMax	= fmaxf(a.mAabbMax, b.mAabbMax);
+	node.mPower		= a.mPower + b.mPower;
+	node.mThetaE	= max(a.mThetaE, b.mThetaE);
+	node.mLeft		= -1;
+	node.mLightIdx	= -1;
+
+	// bounding cone of two cones, after kulla & conty:
+	LightTreeNode const& wide	= a.mThetaO >= b.mThetaO ? a : b;
+	LightTreeNode const& narrow = a.mThetaO >= b.mThetaO ? b : a;
+	float const cosD	= clamp(dot(wide.mAxis, narrow.mAxis), -1.0f, 1.0f);
+	float const thetaD	= acosf(cosD);
+	node.mAxis		= wide.mAxis;
+	node.mThetaO	= wide.mThetaO;
+	if (min(thetaD + narrow.mThetaO, PI) <= wide.mThetaO) return node;
+
+	float const thetaO = (wide.mThetaO + thetaD + narrow.mThetaO) * 0.5f;
+	float3 const ortho = narrow.mAxis - wide.mAxis * cosD;
+	if (thetaO >= PI || dot(ortho, ortho) < 1e-12f)
+	{
+		node.mThetaO = PI;
+		return node;
+	}
+
+	// rotate the wide axis towards the narrow one:
+	float const thetaR	= thetaO - wide.mThetaO;
+	node.mAxis			= normalize(wide.mAxis * cosf(thetaR) + normalize(ortho) * sinf(thetaR));
+	node.mThetaO		= thetaO;
+	return node;
+}
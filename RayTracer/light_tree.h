@@ -0,0 +1,52 @@
+#pragma once
+
+#include "lights.h"
+
+struct Intersection;
+class BVHScene;
+
+struct lightRef
+{
+	uint32_t	mIdx;
+	uint8_t		mType;	// LIGHT_TYPES_POINT or LIGHT_TYPES_SPOT
+};
+
+// bounds of a subtree: aabb, orientation cone and total power
+struct LightTreeNode
+{
+	float3		mAabbMin;
+	float		mPower;
+	float3		mAabbMax;
+	float		mThetaO;	// spread of the emitter axes around mAxis
+	float3		mAxis;
+	float		mThetaE;	// emission falloff angle around each emitter axis
+	int			mLeft;		// right child is mLeft + 1
+	int			mLightIdx;	// -1 for interior nodes
+};
+
+class LightTree
+{
+public:
+	std::vector<LightTreeNode>		mNodes;
+	std::vector<lightRef>			mLights;
+	std::vector<PointLight> const*	mPointLights	= nullptr;
+	std::vector<Spotlight> const*	mSpotlights		= nullptr;
+
+public:
+	void					Build(std::vector<PointLight> const& pointLights, std::vector<Spotlight> const& spotlights,
+								  bool const pointLightsEnabled, bool const spotlightsEnabled);
+	[[nodiscard]] bool		Sample(float3 const point, float3 const normal, float const r, lightRef& light, float& pdf) const;
+	[[nodiscard]] int		SampleIdx(float3 const point, float3 const normal, float r, float& pdf) const;	// index into mLights, -1 on failure
+	[[nodiscard]] color		Unshadowed(int const lightIdx, float3 const point, float3 const normal) const;
+	[[nodiscard]] float3	Position(int const lightIdx) const;
+	[[nodiscard]] color		EvaluateStochastic(Intersection const& hit) const;
+	[[nodiscard]] color		EvaluateStochastic(BVHScene const& scene, tinybvh::Ray const& ray) const;
+	[[nodiscard]] inline bool	IsEmpty() const { return mLights.empty(); }
+
+private:
+	void					Subdivide(std::vector<LightTreeNode>& leaves, int const nodeIdx, int const first, int const count);
+};
+
+[[nodiscard]] float			luminance(color const& c);
+[[nodiscard]] float			importance(LightTreeNode const& node, float3 const point, float3 const normal);
+[[nodiscard]] LightTreeNode mergeBounds(LightTreeNode const& a, LightTreeNode const& b);
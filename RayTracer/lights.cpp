@@ -19,10 +19,7 @@ float3 PointLight::Intensity(Intersection const& hit) const
 	Ray shadow = Ray(hit.point - dir * Renderer::sEps, -dir, dist - Renderer::sEps);
 	if (hit.scene->IsOccluded(shadow)) return BLACK;
 
-	float const cosa		= max(0.0f, dot(hit.normal, -dir)); 
-	float const attenuation = 1.0f / (dist * dist);
-
-	return cosa * attenuation * mColor * mStrength;
+	return Unshadowed(hit.point, hit.normal); 
 }
 
 color PointLight::Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const 
@@ -31,10 +28,19 @@ color PointLight::Intensity(BVHScene const& scene, tinybvh::Ray const& ray) cons
 	float const dist = length(dir); 
 	dir = normalize(dir); 
 
-	tinybvh::Ray shadow = tinybvh::Ray(ray.hit.point - dir * Renderer::sEps, -dir, dist - Renderer::sEps);  
+	occlusionRay const shadow = { ray.hit.point - dir * Renderer::sEps, -dir, dist - Renderer::sEps };  
 	if (scene.IsOccluded(shadow)) return BLACK;
 
-	float const cosa = max(0.0f, dot(ray.hit.normal, -dir));
+	return Unshadowed(ray.hit.point, ray.hit.normal); 
+}
+
+color PointLight::Unshadowed(float3 const point, float3 const normal) const
+{
+	float3 dir			= point - mPosition; 
+	float const dist	= length(dir);
+	dir					= normalize(dir);
+
+	float const cosa		= max(0.0f, dot(normal, -dir)); 
 	float const attenuation = 1.0f / (dist * dist);
 	return cosa * attenuation * mColor * mStrength;
 }
@@ -60,6 +66,12 @@ color DirectionalLight::Intensity(BVHScene const& scene, tinybvh::Ray const& ray
 	return cosa * mColor * mStrength;
 }
 
+color DirectionalLight::Unshadowed(float3 const normal) const
+{
+	float const cosa = max(0.0f, dot(normal, -mDirection));
+	return cosa * mColor * mStrength;
+}
+
 Spotlight::Spotlight() : 
 	mPosition(0.0f, 1.0f, 0.0f),
 	mLookAt(0.0f),
@@ -81,12 +93,7 @@ float3 Spotlight::Intensity(Intersection const& hit) const
 
 	if (hit.scene->IsOccluded({ hit.point + -dir * Renderer::sEps, -dir, dist })) return BLACK; 
 
-	float const theta = dot(dir, -mDirection);
-	float const intensity = clamp((theta - mOuterScalar) / mEpsilon, 0.0f, 1.0f);
-
-	float const cosa = max(0.0f, dot(hit.normal, dir));
-	float const attenuation = 1.0f / (dist * dist);
-	return attenuation * cosa * intensity * mColor * mStrength;
+	return Unshadowed(hit.point, hit.normal); 
 }
 
 color Spotlight::Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const
@@ -97,9 +104,18 @@ color Spotlight::Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const
 
 	if (scene.IsOccluded({ ray.hit.point + -dir * Renderer::sEps, -dir, dist })) return BLACK;
 
+	return Unshadowed(ray.hit.point, ray.hit.normal); 
+}
+
+color Spotlight::Unshadowed(float3 const point, float3 const normal) const
+{
+	float3 dir = mPosition - point;  
+	float const dist = length(dir); 
+	dir = normalize(dir);
+
 	float const theta		= dot(dir, -mDirection);
 	float const intensity	= clamp((theta - mOuterScalar) / mEpsilon, 0.0f, 1.0f);
-	float const cosa		= max(0.0f, dot(ray.hit.normal, dir)); 
+	float const cosa		= max(0.0f, dot(normal, dir)); 
 	float const attenuation = 1.0f / (dist * dist);
 	return attenuation * cosa * intensity * mColor * mStrength;
 }
@@ -118,17 +134,7 @@ color TexturedSpotlight::Intensity(Intersection const& hit) const
 	Ray shadow = Ray(hit.point - dir * Renderer::sEps, -dir, dist - Renderer::sEps);
 	if (hit.scene->IsOccluded(shadow)) return BLACK;  
 
-	float const cosa		= max(0.0f, dot(hit.normal, -dir));
-	float const attenuation = 1.0f / (dist * dist);
-
-	float const dLeft	= distanceToFrustum(mFrustum.mPlanes[0], hit.point); 
-	float const dRight	= distanceToFrustum(mFrustum.mPlanes[1], hit.point); 
-	float const dTop	= distanceToFrustum(mFrustum.mPlanes[2], hit.point); 
-	float const dBottom = distanceToFrustum(mFrustum.mPlanes[3], hit.point); 
-	float const x		= dLeft / (dLeft + dRight);   
-	float const y		= dTop / (dTop + dBottom);   
-	return x >= 0.0f && x <= 1.0f && y >= 0.0f && y <= 1.0f ? 
-		mTexture.Sample(float2(x, y)) * cosa * attenuation * mStrength : BLACK;     
+	return Unshadowed(hit.point, hit.normal); 
 }
 
 color TexturedSpotlight::Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const 
@@ -139,17 +145,26 @@ color TexturedSpotlight::Intensity(BVHScene const& scene, tinybvh::Ray const& ra
 	
 	if (scene.IsOccluded({ ray.hit.point - dir * Renderer::sEps, -dir, dist - Renderer::sEps })) return BLACK;
 
-	float const cosa = max(0.0f, dot(ray.hit.normal, -dir)); 
+	return Unshadowed(ray.hit.point, ray.hit.normal); 
+}
+
+color TexturedSpotlight::Unshadowed(float3 const point, float3 const normal) const
+{
+	float3 dir = point - mPosition;
+	float const dist = length(dir);
+	dir = normalize(dir);
+
+	float const cosa		= max(0.0f, dot(normal, -dir));
 	float const attenuation = 1.0f / (dist * dist);
 
-	float const dLeft	= distanceToFrustum(mFrustum.mPlanes[0], ray.hit.point);
-	float const dRight	= distanceToFrustum(mFrustum.mPlanes[1], ray.hit.point);
-	float const dTop	= distanceToFrustum(mFrustum.mPlanes[2], ray.hit.point); 
-	float const dBottom = distanceToFrustum(mFrustum.mPlanes[3], ray.hit.point); 
-	float const x = dLeft / (dLeft + dRight);
-	float const y = dTop / (dTop + dBottom); 
-	return x >= 0.0f && x <= 1.0f && y >= 0.0f && y <= 1.0f ?
-		mTexture.Sample(float2(x, y)) * cosa * attenuation * mStrength : BLACK;
+	float const dLeft	= distanceToFrustum(mFrustum.mPlanes[0], point); 
+	float const dRight	= distanceToFrustum(mFrustum.mPlanes[1], point); 
+	float const dTop	= distanceToFrustum(mFrustum.mPlanes[2], point); 
+	float const dBottom = distanceToFrustum(mFrustum.mPlanes[3], point); 
+	float const x		= dLeft / (dLeft + dRight);   
+	float const y		= dTop / (dTop + dBottom);   
+	return x >= 0.0f && x <= 1.0f && y >= 0.0f && y <= 1.0f ? 
+		mTexture.Sample(float2(x, y)) * cosa * attenuation * mStrength : BLACK;     
 }
 
 TexturedSpotlight::TexturedSpotlight() : 
@@ -21,6 +21,7 @@ public:
 							PointLight();
 	[[nodiscard]] float3	Intensity(Intersection const& hit) const;
 	[[nodiscard]] color		Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const;
+	[[nodiscard]] color		Unshadowed(float3 const point, float3 const normal) const;
 };
 
 class DirectionalLight
@@ -34,6 +35,7 @@ public:
 							DirectionalLight();
 	[[nodiscard]] float3	Intensity(Intersection const& hit) const;
 	[[nodiscard]] color		Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const;
+	[[nodiscard]] color		Unshadowed(float3 const normal) const;
 };
 
 class Spotlight 
@@ -54,7 +56,10 @@ public:
 							Spotlight(); 
 	[[nodiscard]] float3	Intensity(Intersection const& hit) const;
 	[[nodiscard]] color		Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const;
+	[[nodiscard]] color		Unshadowed(float3 const point, float3 const normal) const;
 	void					DirectionFromLookAt();
+	[[nodiscard]] inline float	GetOuterScalar() const	{ return mOuterScalar; }
+	[[nodiscard]] inline float	GetEpsilon() const		{ return mEpsilon; }
 };
 
 class TexturedSpotlight 
@@ -85,5 +90,6 @@ public:
 						TexturedSpotlight(); 
 	[[nodiscard]] color	Intensity(Intersection const& hit) const; 
 	[[nodiscard]] color	Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const;
+	[[nodiscard]] color	Unshadowed(float3 const point, float3 const normal) const; 
 	void				Update();
 };
@@ -42,7 +42,7 @@ static bool scatterDielectric(Material const& mat, Intersection const& hit, Ray&
 	float const cosTheta = std::fmin(dot(-hit.in, hit.normal), 1.0f); 
 	float const sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
 
-	if (ior * sinTheta > 1.0f || schlickApprox(cosTheta, ior) > RandomFloat())
+	if (ior * sinTheta > 1.0f || schlickApprox(cosTheta, ior) > Sampler::Get1D())
  	{
 		out = Ray(hit.point + hit.normal * Renderer::sEps, reflect(hit.in, hit.normal));
 		out.inside = hit.inside; 
@@ -62,7 +62,7 @@ static bool scatterGlossy(Material const& mat, Intersection const& hit, Ray& out
 
 	float3 const diffuse	= cosineWeightedDiffuseReflection(hit.normal); 
 	float3 const specular	= reflect(hit.in, hit.normal); 
-	bool const isSpecular	= schlickApprox(std::fmin(dot(-hit.in, hit.normal), 1.0f), 2.0f) > RandomFloat();
+	bool const isSpecular	= schlickApprox(std::fmin(dot(-hit.in, hit.normal), 1.0f), 2.0f) > Sampler::Get1D();
 	float3 const reflected	= lerp(diffuse, specular, mat.mGlossy.smoothness * static_cast<float>(isSpecular));    
 	out			= Ray(hit.point + reflected * Renderer::sEps, reflected); 
 	attenuation = isSpecular ? WHITE : mat.mGlossy.albedo; 
@@ -193,7 +193,7 @@ static bool bvhScatterDielectric(Material const& mat, tinybvh::Ray const& in, ti
 	float const cosTheta = std::fmin(dot(-in.D, normal), 1.0f); 
 	float const sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
 
-	if (ior * sinTheta > 1.0f || schlickApprox(cosTheta, ior) > RandomFloat())
+	if (ior * sinTheta > 1.0f || schlickApprox(cosTheta, ior) > Sampler::Get1D())
 	{
 		out = tinybvh::Ray(in.hit.point + normal * Renderer::sEps, reflect(in.D, normal));
 	}
@@ -211,7 +211,7 @@ static bool bvhScatterGlossy(Material const& mat, tinybvh::Ray const& in, tinybv
 
 	float3 const diffuse = cosineWeightedDiffuseReflection(in.hit.normal);
 	float3 const specular = reflect(in.D, in.hit.normal); 
-	bool const isSpecular = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f) > RandomFloat(); 
+	bool const isSpecular = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f) > Sampler::Get1D(); 
 	float3 const reflected = lerp(diffuse, specular, mat.mGlossy.smoothness * static_cast<float>(isSpecular)); 
 	out = tinybvh::Ray(in.hit.point + reflected * Renderer::sEps, reflected);  
 	attenuation = isSpecular ? WHITE : mat.mGlossy.albedo;
@@ -225,7 +225,7 @@ static bool bvhScatterTextured(Material const& mat, tinybvh::Ray const& in, tiny
 
 	float3 const diffuse = cosineWeightedDiffuseReflection(in.hit.normal);
 	float3 const specular = reflect(in.D, in.hit.normal);
-	bool const isSpecular = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f) > RandomFloat();
+	bool const isSpecular = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f) > Sampler::Get1D();
 	float3 const reflected = lerp(diffuse, specular, mat.mGlossy.smoothness * static_cast<float>(isSpecular));
 	out = tinybvh::Ray(in.hit.point + reflected * Renderer::sEps, reflected);
 	attenuation = isSpecular ? WHITE : mat.mGlossy.albedo;
@@ -242,31 +242,32 @@ static bvhMaterialFunc bvhMatDispatchTable[MATERIAL_TYPES_COUNT] =
 	bvhScatterTextured 
 };
 
-typedef bool(*bvhMaterial2Func)(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation);  
+typedef bool(*bvhMaterial2Func)(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf);  
 
-static bool bvhScatterNone2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation)
+static bool bvhScatterNone2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf)
 {
 	return false;
 }
 
-static bool bvhScatterDiffuse2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation)
+static bool bvhScatterDiffuse2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf)
 {
 	float3 const reflected = cosineWeightedDiffuseReflection(in.hit.normal); 
 	float3 const brdf = in.hit.albedo / PI;   
-	float const  pdf = dot(in.hit.normal, reflected) / PI;
+	pdf = dot(in.hit.normal, reflected) / PI;
 	out = tinybvh::Ray(in.hit.point + reflected * Renderer::sEps, reflected); 
 	attenuation = brdf * (dot(in.hit.normal, reflected) / pdf); 
 	return true;
 }
 
-static bool bvhScatterMetallic2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation)
+static bool bvhScatterMetallic2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf)
 {
 	float3 const reflected = reflect(in.D, in.hit.normal);
 	out = tinybvh::Ray(in.hit.point + reflected * Renderer::sEps, reflected);
+	pdf = 0.0f; 
 	return true;
 }
 
-static bool bvhScatterDielectric2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation)
+static bool bvhScatterDielectric2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf)
 {
 	float ior = 1.0f / mat.dielectric.ior;
 	float3 normal = in.hit.normal;
@@ -281,7 +282,7 @@ static bool bvhScatterDielectric2(Material2 const& mat, tinybvh::Ray const& in,
 	float const cosTheta = std::fmin(dot(-in.D, normal), 1.0f);
 	float const sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
 
-	if (ior * sinTheta > 1.0f || schlickApprox(cosTheta, ior) > RandomFloat())
+	if (ior * sinTheta > 1.0f || schlickApprox(cosTheta, ior) > Sampler::Get1D())
 	{
 		out = tinybvh::Ray(in.hit.point + normal * Renderer::sEps, reflect(in.D, normal));
 	}
@@ -289,34 +290,39 @@ static bool bvhScatterDielectric2(Material2 const& mat, tinybvh::Ray const& in,
 	{
 		out = tinybvh::Ray(in.hit.point - normal * Renderer::sEps, refract(normal, in.D, cosTheta, ior));
 	}
+	pdf = 0.0f; 
 	return true;
 }
 
-static bool bvhScatterGlossy2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation)
+static bool bvhScatterGlossy2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf)
 {
 	// inspiration:	https://www.youtube.com/watch?v=Qz0KTGYJtUk
 	// timestamp:	27:14
 
 	float3 const diffuse = cosineWeightedDiffuseReflection(in.hit.normal);
 	float3 const specular = reflect(in.D, in.hit.normal);
-	bool const isSpecular = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f) > RandomFloat();
+	float const fresnel = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f); 
+	bool const isSpecular = fresnel > Sampler::Get1D();
 	float3 const reflected = lerp(diffuse, specular, mat.glossy.glossiness * static_cast<float>(isSpecular));
 	out = tinybvh::Ray(in.hit.point + reflected * Renderer::sEps, reflected); 
 	attenuation = isSpecular ? WHITE : mat.glossy.albedo; 
+	pdf = isSpecular ? 0.0f : (1.0f - fresnel) * dot(in.hit.normal, reflected) / PI; 
 	return true;
 }
 
-static bool bvhScatterTextured2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation) 
+static bool bvhScatterTextured2(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf) 
 {
 	// inspiration:	https://www.youtube.com/watch?v=Qz0KTGYJtUk
 	// timestamp:	27:14
 
 	float3 const diffuse = cosineWeightedDiffuseReflection(in.hit.normal);
 	float3 const specular = reflect(in.D, in.hit.normal);
-	bool const isSpecular = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f) > RandomFloat();
+	float const fresnel = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f); 
+	bool const isSpecular = fresnel > Sampler::Get1D();
 	float3 const reflected = lerp(diffuse, specular, 0.8f * static_cast<float>(isSpecular));  
 	out = tinybvh::Ray(in.hit.point + reflected * Renderer::sEps, reflected);
 	attenuation = isSpecular ? WHITE : in.hit.albedo; 
+	pdf = isSpecular ? 0.0f : (1.0f - fresnel) * dot(in.hit.normal, reflected) / PI; 
 	return true;
 }
 
@@ -330,6 +336,94 @@ static bvhMaterial2Func bvhMat2DispatchTable[MATERIAL_TYPES_COUNT] =
 	bvhScatterTextured2
 };
 
+typedef void(*bvhMaterial2BatchFunc)(tinybvh::Ray const* const* in, scatterRecord* records, int const count); 
+
+template <bvhMaterial2Func Scatter>
+static void bvhScatterBatch2(tinybvh::Ray const* const* in, scatterRecord* records, int const count)
+{
+	// one loop per material type, the scatter function is called directly and can be inlined: 
+	for (int i = 0; i < count; i++)
+	{
+		scatterRecord& record	= records[i]; 
+		Sampler::Resume(record.sampler); 
+		record.attenuation		= in[i]->hit.albedo; 
+		record.scattered		= Scatter(*in[i]->hit.mat, *in[i], record.out, record.attenuation, record.pdf); 
+		record.sampler			= Sampler::Suspend(); 
+	}
+}
+
+static bvhMaterial2BatchFunc bvhMat2BatchDispatchTable[MATERIAL_TYPES_COUNT] =
+{
+	bvhScatterBatch2<bvhScatterNone2>,
+	bvhScatterBatch2<bvhScatterDiffuse2>,
+	bvhScatterBatch2<bvhScatterMetallic2>,
+	bvhScatterBatch2<bvhScatterDielectric2>,
+	bvhScatterBatch2<bvhScatterGlossy2>,
+	bvhScatterBatch2<bvhScatterTextured2>
+};
+
+typedef float(*bvhPdf2Func)(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction); 
+
+static float bvhPdfDelta2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return 0.0f; 
+}
+
+static float bvhPdfDiffuse2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return max(0.0f, dot(in.hit.normal, direction)) / PI; 
+}
+
+static float bvhPdfGlossy2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	// the specular lobe lerps towards the mirror direction and has no closed-form pdf, it counts as a delta lobe: 
+	float const fresnel = schlickApprox(std::fmin(dot(-in.D, in.hit.normal), 1.0f), 2.0f); 
+	return (1.0f - fresnel) * max(0.0f, dot(in.hit.normal, direction)) / PI; 
+}
+
+typedef color(*bvhEval2Func)(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction); 
+
+static color bvhEvalDelta2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return BLACK; 
+}
+
+static color bvhEvalDiffuse2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	// divided by the pdf this gives the attenuation of bvhScatterDiffuse2: 
+	return in.hit.albedo * max(0.0f, dot(in.hit.normal, direction)) / PI; 
+}
+
+static color bvhEvalGlossy2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return mat.glossy.albedo * bvhPdfGlossy2(mat, in, direction); 
+}
+
+static color bvhEvalTextured2(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return in.hit.albedo * bvhPdfGlossy2(mat, in, direction); 
+}
+
+static bvhEval2Func bvhEval2DispatchTable[MATERIAL_TYPES_COUNT] =
+{
+	bvhEvalDelta2, 
+	bvhEvalDiffuse2, 
+	bvhEvalDelta2, 
+	bvhEvalDelta2, 
+	bvhEvalGlossy2, 
+	bvhEvalTextured2 
+};
+
+static bvhPdf2Func bvhPdf2DispatchTable[MATERIAL_TYPES_COUNT] =
+{
+	bvhPdfDelta2, 
+	bvhPdfDiffuse2, 
+	bvhPdfDelta2, 
+	bvhPdfDelta2, 
+	bvhPdfGlossy2, 
+	bvhPdfGlossy2 
+};
+
 Diffuse::Diffuse() : 
 	albedo(WHITE) 
 {}
@@ -391,6 +485,15 @@ Material::Material(int const type)
 Material::~Material()
 {}
 
+Material& Material::operator=(Material const& other)
+{
+	// same as the copy, the texture of a textured material is the only member that holds anything:
+	if (this == &other) return *this; 
+	if (mType == MATERIAL_TYPES_TEXTURED) mTextured.~TexturedMaterial(); 
+	new (this) Material(other); 
+	return *this; 
+}
+
 bool Material::Scatter(Intersection const& hit, Ray& out, color& attenuation) const 
 {
 	return matDispatchTable[mType](*this, hit, out, attenuation); 
@@ -408,7 +511,39 @@ bool Material::Scatter(tinybvh::Ray const& in, tinybvh::Ray& out, color& attenua
 
 bool scatter(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation) 
 {
-	return bvhMat2DispatchTable[mat.type](mat, in, out, attenuation);  
+	float pdf; 
+	return bvhMat2DispatchTable[mat.type](mat, in, out, attenuation, pdf);  
+}
+
+bool scatter(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf)
+{
+	return bvhMat2DispatchTable[mat.type](mat, in, out, attenuation, pdf); 
+}
+
+float scatterPdf(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return bvhPdf2DispatchTable[mat.type](mat, in, direction); 
+}
+
+color scatterEval(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction)
+{
+	return bvhEval2DispatchTable[mat.type](mat, in, direction); 
+}
+
+void scatterBatch(int const type, tinybvh::Ray const* const* in, scatterRecord* records, int const count)
+{
+	bvhMat2BatchDispatchTable[type](in, records, count); 
+}
+
+uint64_t materialKey(Material2 const& mat)
+{
+	uint64_t const texture = mat.type == MATERIAL_TYPES_TEXTURED ? reinterpret_cast<uintptr_t>(mat.textured.texture.mData) : 0; 
+	return (static_cast<uint64_t>(mat.type) << 56) | (texture & 0x00FFFFFFFFFFFFFFull); 
+}
+
+bool isSpecular(Material2 const& mat)
+{
+	return mat.type == MATERIAL_TYPES_METALLIC || mat.type == MATERIAL_TYPES_DIELECTRIC; 
 }
 
 color Material::GetAlbedo() const
@@ -456,7 +591,7 @@ Material2::Material2(Material2 const& other)
 	}
 
 	this->type = other.type;
-	emissivity = 0.0f;
+	emissivity = other.emissivity;
 }
 Material2::Material2(int const type)
 {
@@ -471,6 +606,23 @@ Material2::Material2(int const type)
 	this->type = type;
 	emissivity = 0.0f;
 }
+Material2& Material2::operator=(Material2 const& other)
+{
+	// the texture of a textured material is not trivially copied, so the active member is rebuilt:
+	if (this == &other) return *this; 
+	this->~Material2(); 
+	switch (other.type)
+	{
+	case MATERIAL_TYPES_GLOSSY:		new (&glossy)		Glossy(other.glossy);			break;
+	case MATERIAL_TYPES_DIELECTRIC: new (&dielectric)	Dielectric(other.dielectric);	break;
+	case MATERIAL_TYPES_TEXTURED:	new (&textured)		Textured(other.textured);		break;
+	default: memcpy(static_cast<void*>(this), &other, sizeof(Material2)); break;
+	}
+
+	this->type = other.type;
+	emissivity = other.emissivity;
+	return *this; 
+}
 Material2::~Material2() 
 {
 	switch (type)
@@ -488,6 +640,4 @@ Textured::Textured() :
 
 Textured::Textured(Textured const& other) : 
 	texture(other.texture)
-{
-	texture.mData = other.texture.mData;
-}
+{}
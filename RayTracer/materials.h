@@ -73,6 +73,7 @@ public:
 						Material(Material const& other);
 						Material(int const type);  
 						~Material();
+	Material&			operator=(Material const& other); 
 	bool				Scatter(Intersection const& hit, Ray& out, color& attenuation) const;  
 	bool				Scatter(Intersection const& hit, blueSeed const seed, Ray& out, color& attenuation) const;
 	bool				Scatter(tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation) const;   
@@ -104,7 +105,24 @@ struct alignas(32) Material2
 	Material2();
 	Material2(Material2 const& other);
 	Material2(int const type);
+	Material2& operator=(Material2 const& other); 
 	~Material2();
 };
 
-bool scatter(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation);
\ No newline at end of file
+// result of scattering one hit of a batch
+struct scatterRecord
+{
+	tinybvh::Ray	out;
+	color			attenuation;
+	float			pdf;
+	bool			scattered;
+	samplerState	sampler;	// of the path the hit belongs to 
+};
+
+bool				scatter(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation);
+bool				scatter(Material2 const& mat, tinybvh::Ray const& in, tinybvh::Ray& out, color& attenuation, float& pdf);	// pdf is zero for delta lobes
+[[nodiscard]] float	scatterPdf(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction);	// solid angle pdf of scatter() sampling direction
+[[nodiscard]] color	scatterEval(Material2 const& mat, tinybvh::Ray const& in, float3 const& direction);	// bsdf times cosine of the non-delta lobes
+void				scatterBatch(int const type, tinybvh::Ray const* const* in, scatterRecord* records, int const count);	// all hits share one material type
+[[nodiscard]] bool	isSpecular(Material2 const& mat);
+[[nodiscard]] uint64_t materialKey(Material2 const& mat);	// sorts hits by type, then by texture
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "tmpl8math.h" 
 #include "spline.h"
 
+#include <atomic>
+
 //struct Tri;
 
 #define PI				3.14159265358979323846264f
@@ -25,6 +27,22 @@ struct Frustum
 	FrustumPlane mPlanes[4];
 };
 
+inline float  balanceHeuristic(float const pdf, float const otherPdf)	{ return pdf / (pdf + otherPdf); }
+inline float  powerHeuristic(float const pdf, float const otherPdf)		{ return pdf * pdf / (pdf * pdf + otherPdf * otherPdf); }
+
+inline void   atomicAdd(std::atomic<float>& target, float const value)
+{
+	// lock-free on x64, std::atomic<float>::fetch_add needs c++20:
+	float current = target.load(std::memory_order_relaxed);
+	while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {}
+}
+
+inline void   atomicMax(std::atomic<float>& target, float const value)
+{
+	float current = target.load(std::memory_order_relaxed);
+	while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
 inline float  fracf_sign(float v)			{ return copysign(v - truncf(v), v); } 
 inline float2 fracf_sign(const float2& v)	{ return make_float2(fracf_sign(v.x), fracf_sign(v.y)); }
 inline float3 fracf_sign(const float3& v)	{ return make_float3(fracf_sign(v.x), fracf_sign(v.y), fracf_sign(v.z)); }
@@ -0,0 +1,62 @@
+#include "precomp.h"
+#include "memory_report.h"
+
+size_t memoryReport::Total() const
+{
+	size_t total = 0;
+	for (size_t const bytes : mTags) total += bytes;
+	return total;
+}
+
+size_t bvhBytes(tinybvh::BVH const& bvh)
+{
+	// fragments are only kept by a bvh that can still be rebuilt:
+	size_t bytes = 0;
+	if (bvh.bvhNode)	bytes += static_cast<size_t>(bvh.allocatedNodes) * sizeof(tinybvh::BVH::BVHNode);
+	if (bvh.primIdx)	bytes += static_cast<size_t>(bvh.idxCount) * sizeof(uint32_t);
+	if (bvh.fragment)	bytes += static_cast<size_t>(bvh.triCount) * sizeof(tinybvh::BVHBase::Fragment);
+	return bytes;
+}
+
+size_t blasBytes(tinybvh::BVH8_CPU const& bvh)
+{
+	// the wide layout is converted from the 8-way and the binary bvh, which stay allocated next to it:
+	size_t bytes = static_cast<size_t>(bvh.allocatedBlocks) * 64;
+	if (bvh.bvh8.mbvhNode) bytes += static_cast<size_t>(bvh.bvh8.allocatedNodes) * sizeof(tinybvh::MBVH<8>::MBVHNode);
+	return bytes + bvhBytes(bvh.bvh8.bvh);
+}
+
+static void writeScene(std::ofstream& file, sceneMemory const& bytes)
+{
+	file << "\"tris\":" << bytes.mTris << ",\"points\":" << bytes.mPoints << ",\"blas\":" << bytes.mBlas
+		<< ",\"textures\":" << bytes.mTextures << ",\"total\":" << bytes.Total();
+}
+
+bool dumpMemoryReport(memoryReport const& report, char const* path)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) return false;
+
+	file << "{\"total\":" << report.Total() << ",\n\"subsystems\":{";
+	for (int tag = 0; tag < MEMORY_TAGS_COUNT; tag++) file << (tag ? "," : "") << "\n\"" << MEMORY_TAG_NAMES[tag] << "\":" << report.mTags[tag];
+	file << "\n},\n\"models\":[";
+	for (size_t i = 0; i < report.mModels.size(); i++)
+	{
+		file << (i ? ",\n" : "\n") << "{\"model\":" << i << ",";
+		writeScene(file, report.mModels[i]);
+		file << "}";
+	}
+	file << "\n],\n\"instances\":[";
+	for (size_t i = 0; i < report.mInstances.size(); i++)
+	{
+		instanceMemory const& inst = report.mInstances[i];
+		file << (i ? ",\n" : "\n") << "{\"instance\":" << i << ",\"model\":" << inst.mModel << ",\"blas\":" << inst.mBlas << ",";
+		writeScene(file, inst.mBytes);
+		file << "}";
+	}
+	textureResidencyStats const paging = TextureResidency::Stats();
+	file << "\n],\n\"texture residency\":{\"resident\":" << paging.mResidentBytes << ",\"peak\":" << paging.mPeakBytes << ",\"budget\":" << paging.mBudget
+		<< ",\"textures\":" << paging.mTextures << ",\"faults\":" << paging.mFaults << ",\"loads\":" << paging.mLoads << ",\"evictions\":" << paging.mEvictions;
+	file << "}}\n";
+	return true;
+}
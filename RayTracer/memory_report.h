@@ -0,0 +1,65 @@
+#pragma once
+
+#define MEMORY_REPORT_FILE_PATH	"../assets/memory_report.json"
+
+enum memoryTags : uint8_t
+{
+	MEMORY_TAGS_TRIANGLES,		// Tri arrays of the meshes
+	MEMORY_TAGS_POINTS,			// Mesh::points, the vertices the blasses are built over
+	MEMORY_TAGS_BLAS,
+	MEMORY_TAGS_TLAS,			// tlas nodes, instances and their material copies
+	MEMORY_TAGS_TEXTURES,		// the texture store and the blue noise
+	MEMORY_TAGS_SKYDOME,		// texels and importance sampling tables
+	MEMORY_TAGS_FRAME_BUFFERS,	// accumulator, history and the per pixel and per row buffers
+	MEMORY_TAGS_LIGHTS,			// light lists, light tree, light buffer and emissive triangles
+	MEMORY_TAGS_CACHES,			// primary hits, radiance cache, restir reservoirs and the path guide
+	MEMORY_TAGS_RAY_QUEUES,		// camera rays and the frame arenas
+	MEMORY_TAGS_COUNT
+};
+
+inline char const* const MEMORY_TAG_NAMES[MEMORY_TAGS_COUNT] =
+{
+	"triangles", "points", "blas", "tlas", "textures", "skydome", "frame buffers", "lights", "caches", "ray queues"
+};
+
+// bytes of one model, or of the mesh and blas one instance uses
+struct sceneMemory
+{
+	size_t	mTris		= 0;
+	size_t	mPoints		= 0;
+	size_t	mBlas		= 0;
+	size_t	mTextures	= 0;	// a texture shared by several models counts for each of them
+
+	[[nodiscard]] inline size_t Total() const { return mTris + mPoints + mBlas + mTextures; }
+	inline sceneMemory& operator+=(sceneMemory const& other)
+	{
+		mTris += other.mTris; mPoints += other.mPoints; mBlas += other.mBlas; mTextures += other.mTextures;
+		return *this;
+	}
+};
+
+struct instanceMemory
+{
+	uint32_t	mModel;
+	uint32_t	mBlas;
+	sceneMemory	mBytes;	// the same for every instance of a blas, it is stored once
+};
+
+// bytes per subsystem, read from the containers that hold them when the report is made,
+// so nothing has to be counted on the allocation paths
+struct memoryReport
+{
+	size_t						mTags[MEMORY_TAGS_COUNT] = {};
+	std::vector<sceneMemory>	mModels;
+	std::vector<instanceMemory>	mInstances;
+
+	[[nodiscard]] size_t		Total() const;
+};
+
+template <typename T>
+[[nodiscard]] inline size_t vectorBytes(std::vector<T> const& v) { return v.capacity() * sizeof(T); }
+template <typename T>
+[[nodiscard]] inline size_t textureBytes(Texture<T> const& texture) { return texture.mOwnData ? sizeof(T) * texture.mWidth * texture.mHeight : 0; }
+[[nodiscard]] size_t	bvhBytes(tinybvh::BVH const& bvh);
+[[nodiscard]] size_t	blasBytes(tinybvh::BVH8_CPU const& bvh);
+[[nodiscard]] bool		dumpMemoryReport(memoryReport const& report, char const* path);
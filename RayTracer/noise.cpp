@@ -13,9 +13,17 @@ BlueNoise::BlueNoise(char const* path) :
 	mTexture(loadTextureI(path))  
 {}
 
+float3 const& BlueNoise::Texel(blueSeed const seed) const
+{
+	// every bounce reads the tile at its own offset, so bounces past the third no longer repeat a channel:
+	int const x = seed.mX + seed.mBounce * 37; 
+	int const y = seed.mY + seed.mBounce * 23; 
+	return mTexture.mData[(x & (mTexture.mWidth - 1)) + (y & (mTexture.mHeight - 1)) * mTexture.mWidth]; 
+}
+
 float BlueNoise::Float(blueSeed const seed) const 
 {
-	float const sample	= mTexture.mData[(seed.mX & (mTexture.mWidth - 1)) + (seed.mY & (mTexture.mHeight - 1)) * mTexture.mWidth].cell[seed.mBounce % 3];  
+	float const sample	= Texel(seed).cell[seed.mBounce % 3];  
 	float const noise	= fracf(sample + seed.mFrame * GOLDEN_RATIO); 
 	return noise; 
 }
@@ -27,7 +35,7 @@ float BlueNoise::FloatUnit(blueSeed const seed) const
 
 float2 BlueNoise::Float2(blueSeed const seed) const 
 {
-	float3 const sample = mTexture.mData[(seed.mX & (mTexture.mWidth - 1)) + (seed.mY & (mTexture.mHeight - 1)) * mTexture.mWidth];  
+	float3 const sample = Texel(seed);  
 	float2 const noise	= fracf(float2(sample.x, sample.y) + seed.mFrame * GOLDEN_RATIO); 
 	return noise;
 }
@@ -39,7 +47,7 @@ float2 BlueNoise::Float2Unit(blueSeed const seed) const
 
 float3 BlueNoise::Float3(blueSeed const seed) const  
 {
-	float3 const sample = mTexture.mData[(seed.mX & (mTexture.mWidth - 1)) + (seed.mY & (mTexture.mHeight - 1)) * mTexture.mWidth];
+	float3 const sample = Texel(seed);
 	float3 const noise = fracf(sample + seed.mFrame * GOLDEN_RATIO); 
 	return noise;     
 }
@@ -25,4 +25,7 @@ public:
 	float3	Float3(blueSeed const seed) const; 
 	float3	Float3Unit(blueSeed const seed) const; 
 	float3	Float3UnitLinear(blueSeed const seed) const;  
+
+private:
+	float3 const& Texel(blueSeed const seed) const; 
 };
\ No newline at end of file
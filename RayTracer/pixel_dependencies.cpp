@@ -0,0 +1,29 @@
+#include "precomp.h"
+#include "pixel_dependencies.h"
+
+void PixelDependencies::Init(int const pixels)
+{
+	mMasks.resize(pixels);
+	Clear();
+}
+
+void PixelDependencies::Clear()
+{
+	std::fill(mMasks.begin(), mMasks.end(), 0);
+}
+
+bool PixelDependencies::Affects(int const pixelIdx, uint64_t const changed) const
+{
+	// a shared bit can only report a false positive, never miss a dependency:
+	return (mMasks[pixelIdx] & changed) != 0;
+}
+
+uint64_t PixelDependencies::LightBit(int const light)
+{
+	return uint64_t(1) << light;
+}
+
+uint64_t PixelDependencies::InstanceBit(uint32_t const instIdx)
+{
+	return uint64_t(1) << (DEPENDENCY_LIGHTS_COUNT + instIdx % DEPENDENCY_INSTANCE_BITS);
+}
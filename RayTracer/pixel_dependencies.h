@@ -0,0 +1,33 @@
+#pragma once
+
+enum dependencyLights : uint8_t
+{
+	DEPENDENCY_LIGHTS_DIR,
+	DEPENDENCY_LIGHTS_POINT,
+	DEPENDENCY_LIGHTS_SPOT,
+	DEPENDENCY_LIGHTS_TEXTURED_SPOT,
+	DEPENDENCY_LIGHTS_EMISSIVES,
+	DEPENDENCY_LIGHTS_COUNT
+};
+
+int constexpr		DEPENDENCY_INSTANCE_BITS	= 64 - DEPENDENCY_LIGHTS_COUNT;	// instances past this share bits, a one-hash bloom filter
+uint64_t constexpr	DEPENDENCY_ALL				= ~uint64_t(0);
+
+// per pixel, the lights and instances any accumulated path of it touched,
+// so an edit only has to throw away the pixels it can change
+class PixelDependencies
+{
+public:
+	std::vector<uint64_t>	mMasks;
+
+public:
+	void							Init(int const pixels);
+	void							Clear();
+	[[nodiscard]] bool				Affects(int const pixelIdx, uint64_t const changed) const;
+
+	inline void						Record(int const pixelIdx, uint64_t const mask)	{ mMasks[pixelIdx] |= mask; }
+	inline void						Forget(int const pixelIdx)						{ mMasks[pixelIdx] = 0; }
+
+	[[nodiscard]] static uint64_t	LightBit(int const light);
+	[[nodiscard]] static uint64_t	InstanceBit(uint32_t const instIdx);
+};
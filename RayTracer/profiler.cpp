@@ -0,0 +1,145 @@
+#include "precomp.h"
+#include "profiler.h"
+
+#include <memory>
+#include <mutex>
+
+// threads register their ring once, recording after that takes no lock:
+static std::mutex									registry;
+static std::vector<std::unique_ptr<ProfileBuffer>>	buffers;
+static thread_local ProfileBuffer*					localBuffer = nullptr;
+static std::vector<std::pair<int, profileEvent>>	startup;
+
+static std::chrono::steady_clock::time_point const& epoch()
+{
+	static std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+	return start;
+}
+
+static void writeEvent(std::ofstream& file, bool& first, int const thread, profileEvent const& e)
+{
+	// names are literals from the source, they need no escaping:
+	file << (first ? "\n" : ",\n");
+	file << "{\"name\":\"" << e.mName << "\",\"ph\":\"X\",\"ts\":" << e.mStart << ",\"dur\":" << e.mDuration
+		<< ",\"pid\":0,\"tid\":" << thread << ",\"args\":{\"frame\":" << e.mFrame << "}}";
+	first = false;
+}
+
+// copies the ring while its thread may go on recording, background jobs do between frames,
+// the events it overwrote in the meantime are left out:
+static std::vector<profileEvent> snapshot(ProfileBuffer const& buffer)
+{
+	uint32_t const size		= static_cast<uint32_t>(PROFILER_EVENTS_PER_THREAD);
+	uint32_t const head		= buffer.mHead.load(std::memory_order_acquire);
+	uint32_t const oldest	= head - min(head, size);
+	std::vector<profileEvent> events;
+	events.reserve(head - oldest);
+	for (uint32_t i = oldest; i < head; i++) events.push_back(buffer.mEvents[i % size]);
+
+	// the owner may be writing event now, into the slot of event now - size:
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint32_t const now		= buffer.mHead.load(std::memory_order_relaxed);
+	uint32_t const valid	= now >= size ? now - size + 1 : 0;
+	if (valid > oldest) events.erase(events.begin(), events.begin() + min(valid - oldest, head - oldest));
+	return events;
+}
+
+static void writeThreadNames(std::ofstream& file, bool& first, int const threads)
+{
+	for (int t = 0; t < threads; t++)
+	{
+		file << (first ? "\n" : ",\n");
+		// the main thread records first, at startup:
+		std::string const name = t == 0 ? "main" : "thread " + std::to_string(t);
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t << ",\"args\":{\"name\":\"" << name << "\"}}";
+		first = false;
+	}
+}
+
+void Profiler::EndStartup()
+{
+	// the startup events move out of the rings, so frames can never overwrite them:
+	std::lock_guard<std::mutex> lock(registry);
+	for (std::unique_ptr<ProfileBuffer> const& buffer : buffers)
+	{
+		uint32_t const head		= buffer->mHead.load(std::memory_order_acquire);
+		uint32_t const count	= min(head, static_cast<uint32_t>(PROFILER_EVENTS_PER_THREAD));
+		for (uint32_t i = head - count; i < head; i++) startup.emplace_back(buffer->mThread, buffer->mEvents[i % PROFILER_EVENTS_PER_THREAD]);
+		buffer->mHead.store(0, std::memory_order_release);
+	}
+	sEnabled.store(INIT_PROFILER_ACTIVE, std::memory_order_relaxed);
+}
+
+void Profiler::FrameMark()
+{
+	sFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::Record(char const* name, int64_t const start, int64_t const end)
+{
+	ProfileBuffer& buffer	= LocalBuffer();
+	uint32_t const head		= buffer.mHead.load(std::memory_order_relaxed);
+	buffer.mEvents[head % PROFILER_EVENTS_PER_THREAD] = { name, start, end - start, sFrame.load(std::memory_order_relaxed) };
+	buffer.mHead.store(head + 1, std::memory_order_release);
+}
+
+int64_t Profiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch()).count();
+}
+
+bool Profiler::Dump(char const* path, int const frames)
+{
+	// called between frames from the ui, workers may still record background jobs meanwhile:
+	std::ofstream file(path);
+	if (!file.is_open()) return false;
+
+	uint32_t const frame	= sFrame.load(std::memory_order_relaxed);
+	uint32_t const first	= frame > static_cast<uint32_t>(frames) ? frame - frames : 0;
+	bool firstEvent			= true;
+
+	std::lock_guard<std::mutex> lock(registry);
+	file << "{\"traceEvents\":[";
+	writeThreadNames(file, firstEvent, static_cast<int>(buffers.size()));
+	for (std::unique_ptr<ProfileBuffer> const& buffer : buffers)
+	{
+		for (profileEvent const& e : snapshot(*buffer))
+		{
+			if (e.mFrame >= first && e.mFrame < frame) writeEvent(file, firstEvent, buffer->mThread, e);
+		}
+	}
+	file << "\n]}\n";
+	return true;
+}
+
+bool Profiler::DumpStartup(char const* path)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) return false;
+
+	bool firstEvent = true;
+	std::lock_guard<std::mutex> lock(registry);
+	file << "{\"traceEvents\":[";
+	writeThreadNames(file, firstEvent, static_cast<int>(buffers.size()));
+	for (std::pair<int, profileEvent> const& e : startup) writeEvent(file, firstEvent, e.first, e.second);
+	file << "\n]}\n";
+	return true;
+}
+
+size_t Profiler::StartupEventCount()
+{
+	std::lock_guard<std::mutex> lock(registry);
+	return startup.size();
+}
+
+ProfileBuffer& Profiler::LocalBuffer()
+{
+	if (!localBuffer)
+	{
+		std::lock_guard<std::mutex> lock(registry);
+		buffers.push_back(std::make_unique<ProfileBuffer>());
+		localBuffer				= buffers.back().get();
+		localBuffer->mThread	= static_cast<int>(buffers.size()) - 1;
+	}
+	return *localBuffer;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+int constexpr	PROFILER_EVENTS_PER_THREAD	= 1 << 14;	// ring size, the oldest events are overwritten
+int constexpr	PROFILER_MAX_DUMP_FRAMES	= 64;
+int constexpr	INIT_PROFILER_DUMP_FRAMES	= 8;
+bool constexpr	INIT_PROFILER_ACTIVE		= false;	// startup is always recorded, frames only when switched on
+
+#define PROFILER_FRAMES_FILE_PATH	"../assets/frames_trace.json"
+#define PROFILER_STARTUP_FILE_PATH	"../assets/startup_trace.json"
+
+// closed scope of one thread, written as a chrome trace complete event
+struct profileEvent
+{
+	char const*	mName;		// string literals only, nothing is copied
+	int64_t		mStart;		// microseconds since the profiler started
+	int64_t		mDuration;
+	uint32_t	mFrame;
+};
+
+// ring of one thread, only the owning thread writes to it, readers copy it and check mHead again
+struct ProfileBuffer
+{
+	profileEvent			mEvents[PROFILER_EVENTS_PER_THREAD];
+	std::atomic<uint32_t>	mHead	= 0;	// events ever written, the ring slot is mHead % size
+	int						mThread	= 0;
+};
+
+// per-thread scope markers for the frame phases and the startup sequence,
+// dumped as chrome trace json (chrome://tracing or ui.perfetto.dev)
+class Profiler
+{
+public:
+	inline static std::atomic<bool>		sEnabled	= true;
+	inline static std::atomic<uint32_t>	sFrame		= 0;
+	inline static int					sDumpFrames = INIT_PROFILER_DUMP_FRAMES;
+
+public:
+	static void						EndStartup();
+	static void						FrameMark();
+	static void						Record(char const* name, int64_t const start, int64_t const end);
+	[[nodiscard]] static int64_t	Now();
+	[[nodiscard]] static bool		Dump(char const* path, int const frames);
+	[[nodiscard]] static bool		DumpStartup(char const* path);
+	[[nodiscard]] static size_t		StartupEventCount();
+
+private:
+	[[nodiscard]] static ProfileBuffer& LocalBuffer();
+};
+
+// records the time between construction and destruction, one relaxed load when the profiler is off
+class ProfileScope
+{
+public:
+	explicit ProfileScope(char const* name) :
+		mName(Profiler::sEnabled.load(std::memory_order_relaxed) ? name : nullptr),
+		mStart(mName ? Profiler::Now() : 0)
+	{}
+	~ProfileScope() { if (mName) Profiler::Record(mName, mStart, Profiler::Now()); }
+
+	ProfileScope(ProfileScope const&)				= delete;
+	ProfileScope& operator=(ProfileScope const&)	= delete;
+
+private:
+	char const*	mName;
+	int64_t		mStart;
+};
+
+#define PROFILE_CONCAT_INNER(a, b)	a##b
+#define PROFILE_CONCAT(a, b)		PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name)			ProfileScope const PROFILE_CONCAT(profileScope, __LINE__)(name)
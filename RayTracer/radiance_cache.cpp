@@ -0,0 +1,153 @@
+#include "precomp.h"
+#include "radiance_cache.h"
+
+#include "light_tree.h"
+
+static uint64_t hashKey(uint64_t key)
+{
+	// splitmix64 finalizer, neighbouring cells end up far apart in the table:
+	key ^= key >> 30; key *= 0xbf58476d1ce4e5b9ull;
+	key ^= key >> 27; key *= 0x94d049bb133111ebull;
+	return key ^ (key >> 31);
+}
+
+void RadianceCache::Init()
+{
+	mCells = std::vector<RadianceCacheCell>(size_t(1) << RADIANCE_CACHE_SIZE_LOG2);
+	Clear();
+}
+
+void RadianceCache::Clear()
+{
+	for (RadianceCacheCell& cell : mCells)
+	{
+		cell.mKey.store(0, std::memory_order_relaxed);
+		for (int c = 0; c < 3; c++) cell.mSum[c].store(0.0f, std::memory_order_relaxed);
+		cell.mLumSum.store(0.0f, std::memory_order_relaxed);
+		cell.mLumSqSum.store(0.0f, std::memory_order_relaxed);
+		cell.mCount.store(0, std::memory_order_relaxed);
+	}
+	mUsedCells.store(0, std::memory_order_relaxed);
+	mQueries.store(0, std::memory_order_relaxed);
+	mHits.store(0, std::memory_order_relaxed);
+	mHitRate = 0.0f;
+}
+
+void RadianceCache::EndFrame()
+{
+	PROFILE_SCOPE("Radiance cache end frame");
+	uint32_t const queries = mQueries.exchange(0, std::memory_order_relaxed);
+	uint32_t const hits	= mHits.exchange(0, std::memory_order_relaxed);
+	mHitRate = queries > 0 ? static_cast<float>(hits) / static_cast<float>(queries) : 0.0f;
+
+	// cells are never evicted one by one, a crowded table starts over before probing fails everywhere:
+	if (mUsedCells.load(std::memory_order_relaxed) > mCells.size() * 3 / 4) Clear();
+}
+
+bool RadianceCache::Query(float3 const& point, float3 const& normal, float3 const& camPos, float const rayLength, color& radiance)
+{
+	mQueries.fetch_add(1, std::memory_order_relaxed);
+	float cellSize;
+	uint64_t const key = Key(point, normal, camPos, cellSize);
+
+	// a segment shorter than the cell could have crossed a wall into it, so its cell may leak light:
+	if (rayLength < cellSize) return false;
+	int const cellIdx = Find(key);
+	if (cellIdx < 0) return false;
+
+	RadianceCacheCell const& cell	= mCells[cellIdx];
+	uint32_t const count			= cell.mCount.load(std::memory_order_relaxed);
+	if (count < static_cast<uint32_t>(mMinSamples)) return false;
+
+	// only trust cells whose mean has settled, relative to its own brightness:
+	float const n		= static_cast<float>(count);
+	float const mean	= cell.mLumSum.load(std::memory_order_relaxed) / n;
+	float const var		= max(0.0f, cell.mLumSqSum.load(std::memory_order_relaxed) / n - mean * mean);
+	if (sqrtf(var / n) > mMaxError * max(mean, 1e-4f)) return false;
+
+	radiance = color(cell.mSum[0].load(std::memory_order_relaxed), cell.mSum[1].load(std::memory_order_relaxed), cell.mSum[2].load(std::memory_order_relaxed)) / n;
+	mHits.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void RadianceCache::Update(float3 const& point, float3 const& normal, float3 const& camPos, color const& radiance)
+{
+	float cellSize;
+	int const cellIdx = Insert(Key(point, normal, camPos, cellSize));
+	if (cellIdx < 0) return;
+
+	// the sums and the count are updated separately, a reader may briefly see one sample too few:
+	RadianceCacheCell& cell = mCells[cellIdx];
+	float const lum = luminance(radiance);
+	for (int c = 0; c < 3; c++) atomicAdd(cell.mSum[c], radiance[c]);
+	atomicAdd(cell.mLumSum, lum);
+	atomicAdd(cell.mLumSqSum, lum * lum);
+	cell.mCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RadianceCache::RecordPath(cacheVertex const* vertices, int const count, color const& light, float3 const& camPos)
+{
+	for (int i = 0; i < count; i++)
+	{
+		// radiance the rest of the path gathered from this vertex on, without the throughput up to it:
+		cacheVertex const& v	= vertices[i];
+		color const gathered	= light - v.mLight;
+		color leaving			= BLACK;
+		for (int c = 0; c < 3; c++) if (v.mThroughput[c] > 0.0f) leaving[c] = gathered[c] / v.mThroughput[c];
+		Update(v.mPoint, v.mNormal, camPos, fmaxf(leaving, 0.0f));
+	}
+}
+
+uint64_t RadianceCache::Key(float3 const& point, float3 const& normal, float3 const& camPos, float& cellSize) const
+{
+	// level of detail by camera distance keeps cells roughly the same size on screen:
+	float const dist	= length(point - camPos);
+	int const level		= dist < mLevelDist ? 0 : min(static_cast<int>(log2f(dist / mLevelDist)) + 1, RADIANCE_CACHE_MAX_LEVEL);
+	cellSize			= mCellSize * static_cast<float>(1 << level);
+
+	// dominant axis and sign of the normal, so both sides of a thin wall get their own cells:
+	float3 const a	= float3(fabsf(normal.x), fabsf(normal.y), fabsf(normal.z));
+	int const axis	= a.x >= a.y && a.x >= a.z ? 0 : a.y >= a.z ? 1 : 2;
+	uint64_t const facing = static_cast<uint64_t>(axis * 2 + (normal[axis] < 0.0f ? 1 : 0));
+
+	uint64_t key = uint64_t(1) << 63 | static_cast<uint64_t>(level) << 57 | facing << 54;
+	for (int i = 0; i < 3; i++)
+	{
+		int64_t const q = static_cast<int64_t>(floorf(point[i] / cellSize)) + (1 << 17);
+		key |= (static_cast<uint64_t>(q) & 0x3ffff) << (i * 18);
+	}
+	return key;
+}
+
+int RadianceCache::Find(uint64_t const key) const
+{
+	uint64_t const mask = (uint64_t(1) << RADIANCE_CACHE_SIZE_LOG2) - 1;
+	uint64_t const slot = hashKey(key);
+	for (int i = 0; i < RADIANCE_CACHE_MAX_PROBES; i++)
+	{
+		int const cellIdx		= static_cast<int>((slot + i) & mask);
+		uint64_t const stored	= mCells[cellIdx].mKey.load(std::memory_order_acquire);
+		if (stored == key) return cellIdx;
+		if (stored == 0) return -1;
+	}
+	return -1;
+}
+
+int RadianceCache::Insert(uint64_t const key)
+{
+	uint64_t const mask = (uint64_t(1) << RADIANCE_CACHE_SIZE_LOG2) - 1;
+	uint64_t const slot = hashKey(key);
+	for (int i = 0; i < RADIANCE_CACHE_MAX_PROBES; i++)
+	{
+		int const cellIdx	= static_cast<int>((slot + i) & mask);
+		uint64_t stored		= mCells[cellIdx].mKey.load(std::memory_order_acquire);
+		if (stored == 0 && mCells[cellIdx].mKey.compare_exchange_strong(stored, key, std::memory_order_acq_rel))
+		{
+			mUsedCells.fetch_add(1, std::memory_order_relaxed);
+			return cellIdx;
+		}
+		// a failed exchange leaves the winning key in stored, which may be ours:
+		if (stored == key) return cellIdx;
+	}
+	return -1; // table full around this slot, the sample is dropped
+}
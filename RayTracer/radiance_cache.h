@@ -0,0 +1,61 @@
+#pragma once
+
+int constexpr	RADIANCE_CACHE_SIZE_LOG2			= 20;		// cells in the hash table
+int constexpr	RADIANCE_CACHE_MAX_PROBES			= 8;		// linear probing steps before a key gives up
+int constexpr	RADIANCE_CACHE_MAX_LEVEL			= 15;
+int constexpr	RADIANCE_CACHE_MAX_VERTICES			= 10;		// matches the max bounces slider
+float constexpr INIT_RADIANCE_CACHE_CELL_SIZE		= 0.05f;	// world size of a cell at the camera, doubles with every level
+float constexpr INIT_RADIANCE_CACHE_LEVEL_DIST		= 2.0f;		// camera distance of the first level change
+int constexpr	INIT_RADIANCE_CACHE_TERMINATE_BOUNCE = 2;		// first bounce allowed to end in the cache
+int constexpr	INIT_RADIANCE_CACHE_MIN_SAMPLES		= 16;
+float constexpr INIT_RADIANCE_CACHE_MAX_ERROR		= 0.2f;		// relative standard error of the cell luminance
+float constexpr INIT_RADIANCE_CACHE_TRAIN_FRACTION	= 0.1f;		// paths that ignore the cache and keep feeding it
+
+// cache vertex of a path, kept until the path ends so the radiance leaving it is known
+struct cacheVertex
+{
+	float3	mPoint;
+	float3	mNormal;
+	color	mLight;			// path radiance right before this vertex
+	color	mThroughput;	// path throughput right before this vertex
+};
+
+// radiance leaving a surface cell, accumulated lock-free by all render threads
+struct RadianceCacheCell
+{
+	std::atomic<uint64_t>	mKey;		// zero for empty cells
+	std::atomic<float>		mSum[3];
+	std::atomic<float>		mLumSum;
+	std::atomic<float>		mLumSqSum;
+	std::atomic<uint32_t>	mCount;
+};
+
+// world-space hashed grid of outgoing radiance, cells get coarser away from the camera
+class RadianceCache
+{
+public:
+	std::vector<RadianceCacheCell>	mCells;
+	std::atomic<uint32_t>			mUsedCells		= 0;
+	std::atomic<uint32_t>			mQueries		= 0;	// since the last EndFrame
+	std::atomic<uint32_t>			mHits			= 0;
+	float							mHitRate		= 0.0f; // of the last frame
+	float							mCellSize		= INIT_RADIANCE_CACHE_CELL_SIZE;
+	float							mLevelDist		= INIT_RADIANCE_CACHE_LEVEL_DIST;
+	int								mTerminateBounce = INIT_RADIANCE_CACHE_TERMINATE_BOUNCE;
+	int								mMinSamples		= INIT_RADIANCE_CACHE_MIN_SAMPLES;
+	float							mMaxError		= INIT_RADIANCE_CACHE_MAX_ERROR;
+	float							mTrainFraction	= INIT_RADIANCE_CACHE_TRAIN_FRACTION;
+
+public:
+	void						Init();
+	void						Clear();
+	void						EndFrame();
+	[[nodiscard]] bool			Query(float3 const& point, float3 const& normal, float3 const& camPos, float const rayLength, color& radiance);
+	void						Update(float3 const& point, float3 const& normal, float3 const& camPos, color const& radiance);
+	void						RecordPath(cacheVertex const* vertices, int const count, color const& light, float3 const& camPos);
+
+private:
+	[[nodiscard]] uint64_t		Key(float3 const& point, float3 const& normal, float3 const& camPos, float& cellSize) const;
+	[[nodiscard]] int			Find(uint64_t const key) const;
+	[[nodiscard]] int			Insert(uint64_t const key);
+};
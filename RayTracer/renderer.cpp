@@ -1,13 +1,6 @@
 #include "precomp.h"
 #include "renderer.h"
 
-#include "lights_stochastic.h" 
-#include "lights_vectorized.h" 
-
-Lights lights;    
-Lights2 lights2;    
-NewLights lights3; 
-
 void Renderer::Tick(float deltaTime)
 {
 #if DEBUG_MODE
@@ -17,102 +10,200 @@ void Renderer::Tick(float deltaTime)
 
 	if (mFrame < mSet.mMaxFrames || !mSet.mMaxFramesEnabled) 
 	{
-		float const scale = 1.0f / static_cast<float>(mSpp++);  
+		mSampleIdx = static_cast<uint32_t>(mSpp - 1); 
+		mSpp++; 
 		int			debugRayIdx	= 0;
-#pragma omp parallel for schedule(dynamic)
-		for (int y = 0; y < SCRHEIGHT; y++) for (int x = 0; x < SCRWIDTH; x++) 
+		bool const	restir		= mSet.mRestirEnabled && mSet.mRenderMode == RENDER_MODES_SHADED && mSet.mConvergeMode == CONVERGE_MODES_ACCUMULATION; 
+		bool const	batched		= mSet.mBatchedShadingEnabled && !restir && mSet.mRenderMode == RENDER_MODES_SHADED && mSet.mConvergeMode == CONVERGE_MODES_ACCUMULATION; 
+		bool const	packets		= mSet.mPacketTracingEnabled && !mSet.mDebugViewerEnabled && mSet.mRenderMode == RENDER_MODES_SHADED && mSet.mConvergeMode == CONVERGE_MODES_NONE; 
+		if (mRadianceCacheVersion != mBVHScene.mVersion)
 		{
-			int const pixelIdx = x + y * SCRWIDTH; 
-			blueSeed seed = { x, y, mFrame };  
-
-			if (mBreakPixel && input.mMousePos.x == x && input.mMousePos.y == y)
-			{
-				__debugbreak(); 
-			}
-
-			switch (mSet.mRenderMode) 
-			{
-			case RENDER_MODES_NORMALS:
-			{
-				float2 const pixelCoord = float2(static_cast<float>(x), static_cast<float>(y));
-				Ray primRay = mCamera.GenPrimaryRay(pixelCoord);
-				tinybvh::Ray primRay2 = { primRay.O, primRay.D };
-				color const pixel = TraceNormals(primRay2);  
-				mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
-				break;
-			}
-			case RENDER_MODES_DEPTH:
-			{
-				float2 const pixelCoord = float2(static_cast<float>(x), static_cast<float>(y));
-				Ray primRay = mCamera.GenPrimaryRay(pixelCoord);
-				tinybvh::Ray primRay2 = { primRay.O, primRay.D };
-				color const pixel = TraceDepth(primRay2); 
-				mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
-				break;
-			}
-			case RENDER_MODES_ALBEDO:
-			{
-				float2 const pixelCoord = float2(static_cast<float>(x), static_cast<float>(y));
-				Ray primRay = mCamera.GenPrimaryRay(pixelCoord); 
-				tinybvh::Ray primRay2 = { primRay.O, primRay.D }; 
-				color const pixel = TraceAlbedo(primRay2);  
-				mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
-				break;
-			}
-			case RENDER_MODES_SHADED:
+			mRadianceCache.Clear(); 
+			mRadianceCacheVersion = mBVHScene.mVersion; 
+		}
+		if (mPrimaryHitsVersion != mBVHScene.mVersion)
+		{
+			ClearPrimaryHits(); 
+			mPrimaryHitsVersion = mBVHScene.mVersion; 
+		}
+		bool const measureSplits = mSet.mPrimarySplittingEnabled && mSet.mPrimarySplitsAdaptive && !restir && !batched; 
+		if (measureSplits)
+		{
+			std::fill(mRowPrimaryTime.begin(), mRowPrimaryTime.end(), 0.0f); 
+			std::fill(mRowSecondaryTime.begin(), mRowSecondaryTime.end(), 0.0f); 
+		}
+		bool const traversalCost = mSet.mRenderMode == RENDER_MODES_TRAVERSAL_COST; 
+		if (traversalCost) std::fill(mRowBounceCosts.begin(), mRowBounceCosts.end(), bounceCost{}); 
+		bool const cameraRays = mSet.mRenderMode != RENDER_MODES_SHADED || mSet.mConvergeMode == CONVERGE_MODES_ACCUMULATION; 
+		if (cameraRays) GenCameraRays(mSet.mRenderMode == RENDER_MODES_SHADED); 
+		if (restir) PrepareRestir(); 
+		if (batched) TraceBatched(); 
+		if (packets) TracePackets(); 
+		{
+			PROFILE_SCOPE("Trace and resolve");
+			Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
 			{
-				switch (mSet.mConvergeMode)  
-				{
-				case CONVERGE_MODES_ACCUMULATION:
-				{
-					float2 const pixelCoord		= mSet.mAaEnabled ? mSet.mBlueNoiseEnabled ? RandomOnPixel(seed) : RandomOnPixel(x, y) : CenterOfPixel(x, y);
-					Ray primRay					= mSet.mDofEnabled ? mSet.mBlueNoiseEnabled ? mCamera.GenPrimaryRayFocused(pixelCoord, seed) : mCamera.GenPrimaryRayFocused(pixelCoord) : mCamera.GenPrimaryRay(pixelCoord);    
-					tinybvh::Ray primRay2 = { primRay.O, primRay.D };  
-					color const pixel = Trace(primRay2);  
-					//mAccumulator[pixelIdx]		+= mSet.mBlueNoiseEnabled ? Trace(primRay, seed) : Trace(primRay); 
-					mAccumulator[pixelIdx] += pixel; 
-					color const average			= mAccumulator[pixelIdx] * scale;
-					mScreen->pixels[pixelIdx]	= RGBF32_to_RGB8(average);
-					break;
-				}
-				case CONVERGE_MODES_REPROJECTION:
-				{
-					float2 const pixelCoord		= CenterOfPixel(x, y);  
-					Ray primRay					= mCamera.GenPrimaryRay(pixelCoord);    
-					color const sample			= mSet.mBlueNoiseEnabled ? Trace(primRay, seed) : Trace(primRay); 
-					color const reprojected		= Reproject(primRay, sample); 
-					mAccumulator[pixelIdx]		= reprojected; 
-					mScreen->pixels[pixelIdx]	= RGBF32_to_RGB8(reprojected); 
-					break; 
-				}
-				default:
+				// one marker per row, the gaps between them are threads looking for work:
+				PROFILE_SCOPE("Render rows");
+				for (int x = 0; x < SCRWIDTH; x++) 
 				{
-					float2 const pixelCoord = mSet.mAaEnabled ? mSet.mBlueNoiseEnabled ? RandomOnPixel(seed) : RandomOnPixel(x, y) : CenterOfPixel(x, y); 
-					Ray primRay				= mSet.mDofEnabled ? mSet.mBlueNoiseEnabled ? mCamera.GenPrimaryRayFocused(pixelCoord, seed) : mCamera.GenPrimaryRayFocused(pixelCoord) : mCamera.GenPrimaryRay(pixelCoord);
-					color sample			= BLACK; 
+					int const pixelIdx = x + y * SCRWIDTH; 
+					blueSeed seed = { x, y, mFrame };  
 
-					if (mSet.mDebugViewerEnabled && y == mDebugViewer.mRow && x % mDebugViewer.mEvery == 0)
+					if (mBreakPixel && input.mMousePos.x == x && input.mMousePos.y == y)
 					{
-						debug debug = {};
-						debugRayIdx++;
-						debug.mIsSelected = debugRayIdx == mDebugViewer.mSelected;
-						sample = TraceDebug(primRay, debug);
-					}
-					else
-					{  
-						sample = mSet.mBlueNoiseEnabled ? Trace(primRay, seed) : Trace(primRay); 
+						__debugbreak(); 
 					}
 
-					mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(sample);
-					break;
-				}
+					switch (mSet.mRenderMode) 
+					{
+					case RENDER_MODES_NORMALS:
+					{
+						tinybvh::Ray primRay2 = mPrimaryRays[pixelIdx]; 
+						color const pixel = TraceNormals(primRay2);  
+						mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
+						break;
+					}
+					case RENDER_MODES_DEPTH:
+					{
+						tinybvh::Ray primRay2 = mPrimaryRays[pixelIdx]; 
+						color const pixel = TraceDepth(primRay2); 
+						mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
+						break;
+					}
+					case RENDER_MODES_ALBEDO:
+					{
+						tinybvh::Ray primRay2 = mPrimaryRays[pixelIdx]; 
+						color const pixel = TraceAlbedo(primRay2);  
+						mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
+						break;
+					}
+					case RENDER_MODES_TRAVERSAL_COST:
+					{
+						tinybvh::Ray primRay2 = mPrimaryRays[pixelIdx]; 
+						color const pixel = TraceTraversalCost(primRay2, pixelIdx, y);  
+						mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(pixel);
+						break;
+					}
+					case RENDER_MODES_SHADED:
+					{
+						switch (mSet.mConvergeMode)  
+						{
+						case CONVERGE_MODES_ACCUMULATION:
+						{
+							color pixel = BLACK; 
+							if (batched)
+							{
+								pixel = mBatchedPixels[pixelIdx]; 
+							}
+							else if (restir)
+							{
+								// the primary ray was intersected in PrepareRestir, the path continues after the camera dimensions: 
+								tinybvh::Ray const& primRay2 = mPrimaryRays[pixelIdx]; 
+								Sampler::Begin(pixelIdx, mSampleIdx); 
+								Sampler::Seek(SAMPLER_CAMERA_DIMENSIONS); 
+								pixel = DidHit(primRay2) ? TraceFromHit(primRay2, &mRestir.GetFinal(pixelIdx), pixelIdx) : Miss(primRay2.D); 
+								Sampler::End(); 
+							}
+							else
+							{
+								Sampler::Begin(pixelIdx, mSampleIdx); 
+								Sampler::Seek(SAMPLER_CAMERA_DIMENSIONS); 
+								tinybvh::Ray primRay2 = mPrimaryRays[pixelIdx]; 
+								if (measureSplits)
+								{
+									// rows belong to one thread, so the sums need no atomics: 
+									Timer timer; 
+									bool const hit = IntersectPrimary(primRay2, pixelIdx); 
+									float const primaryTime = timer.elapsed(); 
+									pixel = hit ? TraceFromHit(primRay2, nullptr, pixelIdx) : Miss(primRay2.D); 
+									if (hit)
+									{
+										mRowPrimaryTime[y]		+= primaryTime; 
+										mRowSecondaryTime[y]	+= timer.elapsed() - primaryTime; 
+									}
+								}
+								else pixel = IntersectPrimary(primRay2, pixelIdx) ? TraceFromHit(primRay2, nullptr, pixelIdx) : Miss(primRay2.D); 
+								Sampler::End(); 
+							}
+							//mAccumulator[pixelIdx]		+= mSet.mBlueNoiseEnabled ? Trace(primRay, seed) : Trace(primRay); 
+							// w counts the samples of the pixel, pixels reset on their own restart from zero: 
+							mAccumulator[pixelIdx]		+= float4(pixel, 1.0f); 
+							color const average			= mAccumulator[pixelIdx] / mAccumulator[pixelIdx].w;
+							mScreen->pixels[pixelIdx]	= RGBF32_to_RGB8(average);
+							break;
+						}
+						case CONVERGE_MODES_REPROJECTION:
+						{
+							float2 const pixelCoord		= CenterOfPixel(x, y);  
+							Ray primRay					= mCamera.GenPrimaryRay(pixelCoord);    
+							color const sample			= mSet.mBlueNoiseEnabled ? Trace(primRay, seed) : Trace(primRay); 
+							color const reprojected		= Reproject(primRay, sample); 
+							mAccumulator[pixelIdx]		= reprojected; 
+							mScreen->pixels[pixelIdx]	= RGBF32_to_RGB8(reprojected); 
+							break; 
+						}
+						default:
+						{
+							if (packets)
+							{
+								mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(mBatchedPixels[pixelIdx]);
+								break; 
+							}
+							float2 const pixelCoord = mSet.mAaEnabled ? mSet.mBlueNoiseEnabled ? RandomOnPixel(seed) : RandomOnPixel(x, y) : CenterOfPixel(x, y); 
+							Ray primRay				= mSet.mDofEnabled ? mSet.mBlueNoiseEnabled ? mCamera.GenPrimaryRayFocused(pixelCoord, seed) : mCamera.GenPrimaryRayFocused(pixelCoord) : mCamera.GenPrimaryRay(pixelCoord);
+							color sample			= BLACK; 
+
+							if (mSet.mDebugViewerEnabled && y == mDebugViewer.mRow && x % mDebugViewer.mEvery == 0)
+							{
+								debug debug = {};
+								debugRayIdx++;
+								debug.mIsSelected = debugRayIdx == mDebugViewer.mSelected;
+								sample = TraceDebug(primRay, debug);
+							}
+							else
+							{  
+								sample = mSet.mBlueNoiseEnabled ? Trace(primRay, seed) : Trace(primRay); 
+							}
+
+							mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(sample);
+							break;
+						}
+						}
+
+						break;
+					}
+					default: break; 
+					}
+				}  
+			});
+		}
+		if (restir) mRestir.EndFrame(); 
+		if (mSet.mGuidingEnabled && mSet.mRenderMode == RENDER_MODES_SHADED && mSet.mConvergeMode == CONVERGE_MODES_ACCUMULATION) mGuide.EndFrame(); 
+		if (mSet.mRadianceCacheEnabled) mRadianceCache.EndFrame(); 
+		if (Torus::sCollectStats) mTorusReport = Torus::Report(); 
+		if (measureSplits) AdaptPrimarySplits(); 
+		if (traversalCost)
+		{
+			for (int bounce = 0; bounce < INIT_MAX_BOUNCES; bounce++)
+			{
+				bounceCost& sum = mBounceCosts[bounce]; 
+				sum = {}; 
+				for (int y = 0; y < SCRHEIGHT; y++)
+				{
+					bounceCost const& row = mRowBounceCosts[y * INIT_MAX_BOUNCES + bounce]; 
+					sum.mNodes		+= row.mNodes; 
+					sum.mTris		+= row.mTris; 
+					sum.mInstances	+= row.mInstances; 
+					sum.mRays		+= row.mRays; 
 				}
-
-				break;
 			}
-			default: break; 
-			}
-		}  
+		}
+		mPrimaryReuseRate = static_cast<float>(mPrimaryReuses.exchange(0, std::memory_order_relaxed)) / static_cast<float>(SCRWIDTH * SCRHEIGHT); 
+		uint64_t const paths = mPathCount.exchange(0, std::memory_order_relaxed); 
+		uint64_t const kills = mRouletteKills.exchange(0, std::memory_order_relaxed); 
+		mAvgPathLength	= paths > 0 ? static_cast<float>(mPathVertices.exchange(0, std::memory_order_relaxed)) / static_cast<float>(paths) : 0.0f; 
+		mRouletteRate	= paths > 0 ? static_cast<float>(kills) / static_cast<float>(paths) : 0.0f; 
 		mFrame++; 
 	}
 
@@ -132,6 +223,7 @@ void Renderer::Tick(float deltaTime)
 	}
 	else if (mSet.mConvergeMode == CONVERGE_MODES_ACCUMULATION)
 	{
+		if (mSet.mRestirEnabled) mCamera.BuildFrustum(); // temporal reuse reprojects into this frame 
 		if (mCamera.Update(deltaTime))
 		{
 			//if (mSet.mAutoFocusEnabled) mCamera.Focus(mScene); 
@@ -163,13 +255,15 @@ void Renderer::Tick(float deltaTime)
 #else
 	mTimer.reset();
 	float const scale = 1.0f / static_cast<float>(mSpp++); 
-	#pragma omp parallel for schedule(dynamic) 
-	for (int y = 0; y < SCRHEIGHT; y++) for (int x = 0; x < SCRWIDTH; x++)
+	Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
 	{
-		int const	pixelIdx = x + y * SCRWIDTH;
-		mAccumulator[pixelIdx] += Trace(mCamera.GetPrimaryRayFocused(RandomOnPixel(x, y))); 
-		mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(mAccumulator[pixelIdx] * scale); 
-	}
+		for (int x = 0; x < SCRWIDTH; x++)
+		{
+			int const	pixelIdx = x + y * SCRWIDTH;
+			mAccumulator[pixelIdx] += Trace(mCamera.GetPrimaryRayFocused(RandomOnPixel(x, y))); 
+			mScreen->pixels[pixelIdx] = RGBF32_to_RGB8(mAccumulator[pixelIdx] * scale); 
+		}
+	});
 	if (mCamera.Update(deltaTime))
 	{
 		mCamera.Focus(mScene); 
@@ -181,94 +275,339 @@ void Renderer::Tick(float deltaTime)
 
 color Renderer::Trace(Ray& primRay) const
 {
-	color	light		= BLACK; 
-	color	throughput	= WHITE; 
-
 	mScene.FindNearest(primRay);  
-	Ray ray = primRay;  
+	return TraceFromPrimary(primRay, nullptr, nullptr); 
+}
 
-	for (int bounce = 0; bounce < mSet.mMaxBounces; bounce++) 
+static void splitPath(pathState& path, int const splits)
+{
+	// every branch carries an equal share, roulette then judges it against its share: 
+	float const share	= 1.0f / static_cast<float>(splits); 
+	path.throughput		*= share; 
+	path.rouletteWeight	*= share; 
+	path.directWeight	= static_cast<float>(splits); 
+	path.split			= true; 
+}
+
+static pathState branchOf(pathState const& path)
+{
+	pathState branch	= path; 
+	branch.light		= BLACK; 
+	branch.directWeight = 0.0f; 
+	return branch; 
+}
+
+color Renderer::Trace(tinybvh::Ray& primRay)		
+{
+	if (!mBVHScene.Intersect(primRay)) return Miss(primRay.D);  
+	return TraceFromHit(primRay, nullptr, -1); 
+}
+
+bool Renderer::IntersectPrimary(tinybvh::Ray& ray, int const pixelIdx)
+{
+	if (!mSet.mPrimaryCacheEnabled) return mBVHScene.Intersect(ray); 
+	primaryHit& cached = mPrimaryHits[pixelIdx]; 
+	if (cached.prim != PRIMARY_HIT_EMPTY)
 	{
-		if (DidHit(ray))
+		// without jitter the ray is exactly the one of the previous frame, and so is its hit: 
+		if (!mSet.mAaEnabled && !mSet.mDofEnabled)
 		{
-			Intersection const hit = CalcIntersection(ray);  
+			mPrimaryReuses.fetch_add(1, std::memory_order_relaxed); 
+			if (cached.t >= BVH_FAR) return false; 
+			ray.hit.t		= cached.t; 
+			ray.hit.u		= cached.u; 
+			ray.hit.v		= cached.v; 
+			ray.hit.prim	= cached.prim; 
+			ray.hit.inst	= cached.inst; 
+			mBVHScene.Resolve(ray); 
+			return true; 
+		}
+		// a jittered ray mostly hits the same triangle, its distance then bounds the traversal: 
+		if (cached.t < BVH_FAR) mBVHScene.IntersectTriangle(ray, cached.inst, cached.prim); 
+	}
+	mBVHScene.mTlas.Intersect(ray); 
+	if (!didHit(ray))
+	{
+		cached = primaryHit{ BVH_FAR, 0.0f, 0.0f, 0, 0 }; 
+		return false; 
+	}
+	if (ray.hit.prim == cached.prim && ray.hit.inst == cached.inst) mPrimaryReuses.fetch_add(1, std::memory_order_relaxed); 
+	cached = primaryHit{ ray.hit.t, ray.hit.u, ray.hit.v, ray.hit.prim, ray.hit.inst }; 
+	mBVHScene.Resolve(ray); 
+	return true; 
+}
 
-			color albedo	= hit.mat->GetAlbedo();    
-			color emission	= hit.mat->GetEmission();   
+void Renderer::ClearPrimaryHits()
+{
+	std::fill(mPrimaryHits.begin(), mPrimaryHits.end(), primaryHit{}); 
+}
 
-			Ray		scattered;
-			color	indirect = albedo; 
-			if (hit.mat->Scatter(hit, scattered, indirect))  
+color Renderer::TraceFromHit(tinybvh::Ray const& primRay, Reservoir const* reservoir, int const pixelIdx)
+{
+	pathState path;
+	path.ray		= primRay;
+	path.pixelIdx	= pixelIdx; 
+	TracePath(path, reservoir); 
+	return path.light;
+}
+
+void Renderer::TracePath(pathState& path, Reservoir const* reservoir)
+{
+	while (path.active && path.bounce < mSet.mMaxBounces) 
+	{
+		int const splits = SplitCount(path); 
+		if (splits > 1)
+		{
+			// the other branches are traced to the end right away, this path goes on as the first one with its own index: 
+			// paths of no pixel draw white noise, their count only has to exist: 
+			static thread_local uint32_t unowned = 0; 
+			uint32_t& next = path.pixelIdx >= 0 ? mSplitSampleIdx[path.pixelIdx] : unowned; 
+			samplerState const parent = Sampler::Suspend(); 
+			splitPath(path, splits); 
+			for (int i = 1; i < splits; i++)
 			{
-				color const direct = CalcDirectLight(hit) * albedo;  
-				light += (direct + emission) * throughput;  
-				throughput *= indirect;   
-				ray = scattered;  
-				mScene.FindNearest(ray); 
-				continue;
+				pathState branch = branchOf(path); 
+				Sampler::Resume(Sampler::Split(parent, next)); 
+				TracePath(branch, reservoir); 
+				path.light			+= branch.light; 
 			}
+			Sampler::Resume(parent); 
+		}
 
-			light += (CalcDirectLightWithArea(hit) * albedo + emission) * throughput;  
-			return light;
+		scatterRecord record; 
+		record.attenuation	= path.ray.hit.albedo; 
+		record.scattered	= scatter(*path.ray.hit.mat, path.ray, record.out, record.attenuation, record.pdf); 
+		GuideScatter(path.ray, record); 
+		ShadeVertex(path, record, reservoir); 
+		reservoir = nullptr; // reservoirs only exist for the primary hit 
+	}
+	FinishPath(path); 
+}
+
+void Renderer::TraceBatched()
+{
+	PROFILE_SCOPE("Batched trace");
+	Jobs::ParallelFor2D(int2(SCRWIDTH, SCRHEIGHT), int2(BATCH_TILE_SIZE), [&](int const x0, int const y0, int const x1, int const y1)
+	{
+		// one tile at a time lives in the arena of this thread: 
+		FrameScope const										scope; 
+		FrameVector<pathState>									paths((x1 - x0) * (y1 - y0)); 
+		FrameVector<std::pair<uint64_t, uint32_t>>				bins;		// material key, path index 
+		FrameVector<tinybvh::Ray const*>						in; 
+		FrameVector<scatterRecord>								records; 
+
+		// primary rays of the tile, misses are resolved right away: 
+		for (int y = y0; y < y1; y++) for (int x = x0; x < x1; x++)
+		{
+			int const pixelIdx	= x + y * SCRWIDTH; 
+			Sampler::Begin(pixelIdx, mSampleIdx); 
+			Sampler::Seek(SAMPLER_CAMERA_DIMENSIONS); 
+			pathState path; 
+			path.ray		= mPrimaryRays[pixelIdx]; 
+			path.pixelIdx	= pixelIdx; 
+			path.sampler	= Sampler::Suspend(); 
+			if (!IntersectPrimary(path.ray, pixelIdx))
+			{
+				mBatchedPixels[pixelIdx] = Miss(path.ray.D); 
+				continue; 
+			}
+			mBatchedPixels[pixelIdx] = BLACK; 
+			paths.push_back(path); 
 		}
-		else
+
+		for (int bounce = 0; bounce < mSet.mMaxBounces; bounce++)
 		{
-			light += Miss(ray.D) * throughput;
-			return light;
+			// branches join the batch as paths of their own and add to the same pixel: 
+			for (size_t i = 0, live = paths.size(); i < live; i++)
+			{
+				int const splits = paths[i].active ? SplitCount(paths[i]) : 1; 
+				if (splits <= 1) continue; 
+				samplerState const parent = paths[i].sampler; 
+				splitPath(paths[i], splits); 
+				for (int s = 1; s < splits; s++)
+				{
+					pathState branch	= branchOf(paths[i]); 
+					branch.sampler		= Sampler::Split(parent, mSplitSampleIdx[paths[i].pixelIdx]); 
+					paths.push_back(branch); 
+				}
+			}
+
+			// bin the live paths by material, so each kernel runs over a coherent batch: 
+			bins.clear(); 
+			for (uint32_t i = 0; i < paths.size(); i++) if (paths[i].active) bins.push_back({ materialKey(*paths[i].ray.hit.mat), i }); 
+			if (bins.empty()) break; 
+			std::sort(bins.begin(), bins.end()); 
+
+			for (size_t first = 0; first < bins.size();)
+			{
+				uint8_t const type	= paths[bins[first].second].ray.hit.mat->type; 
+				size_t last			= first; 
+				while (last < bins.size() && paths[bins[last].second].ray.hit.mat->type == type) last++; 
+
+				int const count = static_cast<int>(last - first); 
+				in.resize(count); 
+				records.resize(count); 
+				for (int i = 0; i < count; i++)
+				{
+					in[i]				= &paths[bins[first + i].second].ray; 
+					records[i].sampler	= paths[bins[first + i].second].sampler; 
+				}
+				scatterBatch(type, in.data(), records.data(), count); 
+				for (int i = 0; i < count; i++)
+				{
+					pathState& path = paths[bins[first + i].second]; 
+					Sampler::Resume(records[i].sampler); 
+					GuideScatter(path.ray, records[i]); 
+					ShadeVertex(path, records[i], nullptr); 
+					path.sampler = Sampler::Suspend(); 
+				}
+				first = last; 
+			}
 		}
-	}
-	return light;
+
+		for (pathState const& path : paths)
+		{
+			FinishPath(path); 
+			mBatchedPixels[path.pixelIdx] += path.light; 
+		}
+		Sampler::End(); 
+	});
 }
 
-color Renderer::Trace(tinybvh::Ray& primRay)		
+void Renderer::ShadeVertex(pathState& path, scatterRecord const& record, Reservoir const* reservoir)
 {
-	color	light		= BLACK;
-	color	throughput	= WHITE;
-	if (!mBVHScene.Intersect(primRay)) return Miss(primRay.D);  
-	tinybvh::Ray ray = primRay;
-	for (int bounce = 0; bounce < mSet.mMaxBounces; bounce++) 
+	tinybvh::Ray const& ray = path.ray; 
+	path.dependencies |= PixelDependencies::InstanceBit(ray.hit.inst); 
+	if (mSet.mRadianceCacheEnabled && !isSpecular(*ray.hit.mat))
 	{
-		float const emissivity = ray.hit.mat->emissivity;
-		tinybvh::Ray scattered;
-		color indirect = ray.hit.albedo; 
-		if (scatter(*ray.hit.mat, ray, scattered, indirect))    
-		{ 
-			//if (dot(ray.hit.normal, ray.D) < 0.0f) indirect *= expf(-0.06f * ray.hit.t); 
-			color const direct = CalcDirectLight(ray) * ray.hit.albedo;  
-			light += (direct + ray.hit.albedo * emissivity) * throughput;
-			throughput *= indirect; ray = scattered;
-			if (!mBVHScene.Intersect(ray)) return light + Miss(ray.D) * throughput; 
-			continue; 
+		// a few paths keep tracing in full, so the cache does not only learn from itself: 
+		if (path.bounce == 0) path.cacheTraining = Sampler::Get1D() < mRadianceCache.mTrainFraction; 
+		color cached; 
+		if (!path.cacheTraining && path.bounce >= mRadianceCache.mTerminateBounce && 
+			mRadianceCache.Query(ray.hit.point, ray.hit.normal, mCamera.mPosition, ray.hit.t, cached))
+		{
+			// the cell mixes light from everywhere, so the pixel now depends on everything: 
+			path.light			+= cached * path.throughput; 
+			path.dependencies	= DEPENDENCY_ALL; 
+			path.active			= false; 
+			return; 
+		}
+		if (path.cacheVertexCount < RADIANCE_CACHE_MAX_VERTICES)
+		{
+			cacheVertex& vertex = path.cacheVertices[path.cacheVertexCount++]; 
+			vertex.mPoint		= ray.hit.point; 
+			vertex.mNormal		= ray.hit.normal; 
+			vertex.mLight		= path.light; 
+			vertex.mThroughput	= path.throughput; 
 		}
-		return light + (CalcDirectLightWithArea(ray) * ray.hit.albedo + ray.hit.albedo * emissivity) * throughput; 
 	}
-	return light;
+	path.bounce++; 
+
+	bool const mis = mSet.mMisHeuristic != MIS_HEURISTICS_NONE; 
+	float emissivity = ray.hit.mat->emissivity; 
+	if (!path.countEmission && emissivity > 0.0f)
+	{
+		// only lobes the explicit sample covers give it up, without mis in full, delta and glossy specular lobes keep it, 
+		// and so do emitters it cannot pick, like the analytic shapes the registry skips: 
+		float const lightPdf = mBVHScene.mEmissives.Pdf(ray.hit.inst, ray.hit.prim, ray.D, ray.hit.t); 
+		if (path.bsdfPdf > 0.0f && lightPdf > 0.0f) emissivity *= mis ? MisWeight(path.bsdfPdf, lightPdf) : 0.0f; 
+	}
+	// branches of a split share the direct light of the split vertex, the first one adds it for all: 
+	float const directWeight = path.directWeight; 
+	path.directWeight = 1.0f; 
+	if (!record.scattered)
+	{
+		if (directWeight > 0.0f)
+		{
+			// the sampled emitters are weighted by the bsdf already, the other lights by the albedo: 
+			color const direct	= CalcDirectLightWithArea(ray, reservoir); 
+			color const sampled	= mSet.mEmissivesEnabled ? CalcEmissiveLight(ray) : BLACK; 
+			if (direct.x + direct.y + direct.z + sampled.x + sampled.y + sampled.z > 0.0f) path.dependencies |= SampledLights(mSet.mEmissivesEnabled); 
+			path.light += (direct * ray.hit.albedo + ray.hit.albedo * emissivity + sampled) * path.throughput * directWeight; 
+		}
+		path.active	= false; 
+		return; 
+	}
+
+	//if (dot(ray.hit.normal, ray.D) < 0.0f) indirect *= expf(-0.06f * ray.hit.t); 
+	bool const sampleEmissives	= mSet.mEmissivesEnabled && !isSpecular(*ray.hit.mat); 
+	bool const sampleSkydome	= mis && mSet.mSkydomeEnabled && !isSpecular(*ray.hit.mat); 
+	if (directWeight > 0.0f)
+	{
+		// emitters and the skydome are sampled against the bsdf, as bsdf sampling finds them, the point lights stay lambertian: 
+		color const direct	= CalcDirectLight(ray, reservoir); 
+		color sampled		= BLACK; 
+		if (sampleEmissives) sampled += CalcEmissiveLight(ray); 
+		if (sampleSkydome) sampled += CalcSkydomeLight(ray); 
+		if (direct.x + direct.y + direct.z + sampled.x + sampled.y + sampled.z > 0.0f) path.dependencies |= SampledLights(sampleEmissives); 
+		path.light		+= (direct * ray.hit.albedo + ray.hit.albedo * emissivity + sampled) * path.throughput * directWeight;
+	}
+	path.countEmission	= !sampleEmissives; 
+	path.skydomeSampled	= sampleSkydome; 
+	path.bsdfPdf		= record.pdf; 
+	path.throughput		*= record.attenuation; 
+	if (mSet.mRouletteEnabled && path.bounce >= mSet.mRouletteMinDepth)
+	{
+		// survival follows the throughput, a path that could still add much is rarely cut: 
+		float const peak		= max(path.throughput.x, max(path.throughput.y, path.throughput.z)); 
+		float const survival	= min(0.95f, peak / path.rouletteWeight); 
+		if (survival <= 0.0f || Sampler::Get1D() >= survival)
+		{
+			mRouletteKills.fetch_add(1, std::memory_order_relaxed); 
+			path.active = false; 
+			return; 
+		}
+		path.throughput /= survival; 
+	}
+	if (mSet.mGuidingEnabled && mGuide.IsTraining() && record.pdf > 0.0f && path.guideVertexCount < GUIDE_MAX_VERTICES)
+	{
+		guideVertex& vertex = path.guideVertices[path.guideVertexCount++]; 
+		vertex.mPoint		= ray.hit.point; 
+		vertex.mPdf			= record.pdf; 
+		vertex.mDirection	= record.out.D; 
+		vertex.mLight		= path.light; 
+		vertex.mThroughput	= path.throughput; 
+	}
+	path.ray			= record.out; 
+	if (!mBVHScene.Intersect(path.ray))
+	{
+		float const weight = path.skydomeSampled && path.bsdfPdf > 0.0f ? MisWeight(path.bsdfPdf, mSkydome.Pdf(path.ray.D)) : 1.0f; 
+		path.light	+= Miss(path.ray.D) * path.throughput * weight; 
+		path.active	= false; 
+	}
 }
 
 color Renderer::Trace(Ray& primRay, blueSeed& seed) const    
+{
+	mScene.FindNearest(primRay);
+	return TraceFromPrimary(primRay, &seed, nullptr); 
+}
+
+color Renderer::TraceFromPrimary(Ray const& primRay, blueSeed* seed, bool const* dirOccluded) const
 {
 	color	light		= BLACK;
 	color	throughput	= WHITE;
-
-	mScene.FindNearest(primRay);
-	Ray ray = primRay;
+	Ray		ray			= primRay;
 
 	for (int bounce = 0; bounce < mSet.mMaxBounces; bounce++)
 	{
 		if (DidHit(ray))
 		{
 			Intersection const hit = CalcIntersection(ray);
+			if (seed) seed->mBounce = bounce; 
 
-			seed.mBounce = bounce; 
+			// the packet tracer already knows the directional shadow of the primary hit: 
+			bool const* occluded = bounce == 0 ? dirOccluded : nullptr; 
 
 			color albedo	= hit.mat->GetAlbedo();
 			color emission	= hit.mat->GetEmission(); 
 
 			Ray		scattered;
-			color	indirect = albedo;
-			if (hit.mat->Scatter(hit, seed, scattered, indirect))
+			color	indirect	= albedo;
+			bool const scatters	= seed ? hit.mat->Scatter(hit, *seed, scattered, indirect) : hit.mat->Scatter(hit, scattered, indirect); 
+			if (scatters)
 			{
-				color const direct = CalcDirectLight(hit) * albedo;   
+				color const direct = CalcDirectLight(hit, occluded) * albedo;   
 				light += (direct + emission) * throughput; 
 				throughput *= indirect;   
 				ray = scattered;
@@ -276,7 +615,8 @@ color Renderer::Trace(Ray& primRay, blueSeed& seed) const
 				continue;
 			}
 
-			light += (CalcDirectLightWithArea(hit, seed) * albedo + emission) * throughput;  
+			color const area = seed ? CalcDirectLightWithArea(hit, *seed, occluded) : CalcDirectLightWithArea(hit, occluded); 
+			light += (area * albedo + emission) * throughput;  
 			return light;
 		}
 		else
@@ -288,6 +628,52 @@ color Renderer::Trace(Ray& primRay, blueSeed& seed) const
 	return light;
 }
 
+void Renderer::TracePackets()
+{
+	PROFILE_SCOPE("Packet trace");
+	Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
+	{
+		for (int x0 = 0; x0 < SCRWIDTH; x0 += PACKET_WIDTH)
+		{
+			// the same camera rays as the scalar path of this mode: 
+			int const	count = min(PACKET_WIDTH, SCRWIDTH - x0); 
+			Ray			rays[PACKET_WIDTH]; 
+			blueSeed	seeds[PACKET_WIDTH]; 
+			for (int i = 0; i < count; i++)
+			{
+				int const x = x0 + i; 
+				seeds[i] = { static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint16_t>(mFrame) }; 
+				float2 const pixelCoord = mSet.mAaEnabled ? mSet.mBlueNoiseEnabled ? RandomOnPixel(seeds[i]) : RandomOnPixel(x, y) : CenterOfPixel(x, y); 
+				rays[i] = mSet.mDofEnabled ? mSet.mBlueNoiseEnabled ? mCamera.GenPrimaryRayFocused(pixelCoord, seeds[i]) : mCamera.GenPrimaryRayFocused(pixelCoord) : mCamera.GenPrimaryRay(pixelCoord);
+			}
+			Ray8 packet(rays, count); 
+			mScene.FindNearest8(packet); 
+			packet.Store(rays, count); 
+
+			// shadow rays of the primary hits towards the directional light go as one packet too, missed lanes get t = 0: 
+			bool occluded[PACKET_WIDTH] = {}; 
+			if (mSet.mDirLightEnabled)
+			{
+				Ray shadows[PACKET_WIDTH]; 
+				for (int i = 0; i < count; i++)
+				{
+					bool const hit		= DidHit(rays[i]); 
+					float3 const point	= hit ? calcIntersectionPoint(rays[i]) : rays[i].O; 
+					shadows[i]			= Ray(point + -mDirLight.mDirection * sEps, -mDirLight.mDirection, hit ? RAY_FAR : 0.0f); 
+				}
+				int const mask = mScene.IsOccluded8(Ray8(shadows, count)); 
+				for (int i = 0; i < count; i++) occluded[i] = (mask >> i) & 1; 
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				bool const* dirOccluded = mSet.mDirLightEnabled ? &occluded[i] : nullptr; 
+				mBatchedPixels[x0 + i + y * SCRWIDTH] = TraceFromPrimary(rays[i], mSet.mBlueNoiseEnabled ? &seeds[i] : nullptr, dirOccluded); 
+			}
+		}
+	});
+}
+
 color Renderer::TraceDebug(Ray& ray, debug debug)
 {
 	color light			= BLACK;
@@ -352,6 +738,65 @@ color Renderer::TraceDepth(tinybvh::Ray& ray) const
 	return 0.01f * float3(ray.hit.t, ray.hit.t, ray.hit.t); 
 }
 
+static color heatColor(float const t)
+{
+	// blue through cyan, green and yellow to red, evenly spaced: 
+	color const stops[] = { BLUE, CYAN, GREEN, YELLOW, RED }; 
+	float const f	= clamp(t, 0.0f, 1.0f) * 4.0f; 
+	int const i		= min(static_cast<int>(f), 3); 
+	return lerp(stops[i], stops[i + 1], f - static_cast<float>(i)); 
+}
+
+color Renderer::TraceTraversalCost(tinybvh::Ray& ray, int const pixelIdx, int const y)
+{
+	// the path follows the bsdf like the shaded mode, every segment counts towards its bounce: 
+	traversalCost shown; 
+	for (int bounce = 0; bounce < mSet.mMaxBounces; bounce++)
+	{
+		traversalCost cost; 
+		bool const hit		= mBVHScene.IntersectCounted(ray, cost); 
+		bounceCost& sum		= mRowBounceCosts[y * INIT_MAX_BOUNCES + bounce]; 
+		sum.mNodes			+= cost.mNodes; 
+		sum.mTris			+= cost.mTris; 
+		sum.mInstances		+= cost.mInstances; 
+		sum.mRays++; 
+		if (bounce == mSet.mCostBounce) shown = cost; 
+		if (!hit || bounce >= mSet.mCostBounce) break; 
+
+		tinybvh::Ray out; 
+		color attenuation = ray.hit.albedo; 
+		if (!scatter(*ray.hit.mat, ray, out, attenuation)) break; 
+		ray = out; 
+	}
+	mTraversalCosts[pixelIdx] = shown; 
+
+	uint32_t const counts[COST_METRICS_COUNT] = { shown.mNodes, shown.mTris, shown.mInstances }; 
+	float const count = static_cast<float>(counts[mSet.mCostMetric]); 
+	if (count == 0.0f) return BLACK; 
+	float const t = mSet.mCostLogScale ? logf(1.0f + count) / logf(1.0f + mSet.mCostMax) : count / mSet.mCostMax; 
+	return heatColor(t); 
+}
+
+void Renderer::ExportTraversalCost(char const* path) const
+{
+	printSaving(path); 
+	std::ofstream file; file.open(path); 
+	file << "x,y,nodes,triangles,instances" << endl; 
+	for (int y = 0; y < SCRHEIGHT; y++) for (int x = 0; x < SCRWIDTH; x++)
+	{
+		traversalCost const& cost = mTraversalCosts[x + y * SCRWIDTH]; 
+		file << x << "," << y << "," << cost.mNodes << "," << cost.mTris << "," << cost.mInstances << endl; 
+	}
+	file << endl << "bounce,rays,nodes,triangles,instances" << endl; 
+	for (int bounce = 0; bounce < INIT_MAX_BOUNCES; bounce++)
+	{
+		bounceCost const& sum = mBounceCosts[bounce]; 
+		file << bounce << "," << sum.mRays << "," << sum.mNodes << "," << sum.mTris << "," << sum.mInstances << endl; 
+	}
+	file.close(); 
+	printSuccess(path); 
+}
+
 color Renderer::TraceAlbedo(Ray& ray) const
 {
 	mScene.FindNearest(ray);
@@ -369,29 +814,42 @@ color Renderer::TraceAlbedo(tinybvh::Ray& ray)
 	return ray.hit.albedo; 
 }
 
-color Renderer::CalcDirectLight(Intersection const& hit) const
+color Renderer::CalcDirectLight(Intersection const& hit, bool const* dirOccluded) const
 {
 	color result = BLACK;
-	if (mSet.mDirLightEnabled)	result += mDirLight.Intensity(hit);
-	if (mSet.mTexturedSpotlightEnabled) result += mTexturedSpotlight.Intensity(hit); 
-	//result += mSet.mStochasticLights ? lights.EvaluateStochastic(info) : lights.Evaluate(info); 
-	//result += lights3.Evaluate(info);  
+	if (mSet.mDirLightEnabled)	result += dirOccluded ? (*dirOccluded ? BLACK : mDirLight.Unshadowed(hit.normal)) : mDirLight.Intensity(hit);
+	if (mSet.mStochasticLights)
+	{
+		if (mSet.mTexturedSpotlightEnabled) result += mTexturedSpotlight.Intensity(hit); 
+		result += mLightTree.EvaluateStochastic(hit); 
+	}
+	else result += mLightBuffer.Evaluate(hit); 
 	return result;
 }  
 
-color Renderer::CalcDirectLight(tinybvh::Ray const& ray) const
+color Renderer::CalcDirectLight(tinybvh::Ray const& ray, Reservoir const* reservoir) const
 {
 	color result = BLACK; 
 	if (mSet.mDirLightEnabled)	result += mDirLight.Intensity(mBVHScene, ray); 
-	if (mSet.mTexturedSpotlightEnabled) result += mTexturedSpotlight.Intensity(mBVHScene, ray); 
+	if (reservoir)
+	{
+		if (mSet.mTexturedSpotlightEnabled) result += mTexturedSpotlight.Intensity(mBVHScene, ray); 
+		result += mRestir.Shade(mLightTree, mBVHScene, *reservoir, ray); 
+	}
+	else if (mSet.mStochasticLights)
+	{
+		if (mSet.mTexturedSpotlightEnabled) result += mTexturedSpotlight.Intensity(mBVHScene, ray); 
+		result += mLightTree.EvaluateStochastic(mBVHScene, ray); 
+	}
+	else result += mLightBuffer.Evaluate(mBVHScene, ray); 
 
 	return result; 
 }
 
-color Renderer::CalcDirectLightWithArea(Intersection const& hit) const
+color Renderer::CalcDirectLightWithArea(Intersection const& hit, bool const* dirOccluded) const
 {
 	color result = BLACK;
-	result += CalcDirectLight(hit);  
+	result += CalcDirectLight(hit, dirOccluded);  
 
 	if (mSet.mQuadLightEnabled) result += CalcQuadLight(hit);
 	result += mSet.mSkydomeEnabled ? mSkydome.Intensity(hit) : MissIntensity(hit);   
@@ -399,21 +857,20 @@ color Renderer::CalcDirectLightWithArea(Intersection const& hit) const
 	return result;
 } 
 
-color Renderer::CalcDirectLightWithArea(tinybvh::Ray const& ray) const
+color Renderer::CalcDirectLightWithArea(tinybvh::Ray const& ray, Reservoir const* reservoir) const
 {
 	color result = BLACK;
-	result += CalcDirectLight(ray); 
+	result += CalcDirectLight(ray, reservoir); 
 
-	//if (mSet.mQuadLightEnabled) result += CalcQuadLight(hit);
 	result += mSet.mSkydomeEnabled ? mSkydome.Intensity(mBVHScene, ray) : MissIntensity(ray); 
 
 	return result;
 }
 
-color Renderer::CalcDirectLightWithArea(Intersection const& hit, blueSeed const seed) const  
+color Renderer::CalcDirectLightWithArea(Intersection const& hit, blueSeed const seed, bool const* dirOccluded) const  
 {
 	color result = BLACK;
-	result += CalcDirectLight(hit); 
+	result += CalcDirectLight(hit, dirOccluded); 
 
 	if (mSet.mQuadLightEnabled) result += CalcQuadLight(hit, seed); 
 	result += mSet.mSkydomeEnabled ? mSkydome.Intensity(hit, seed) : MissIntensity(hit);   
@@ -454,6 +911,46 @@ color Renderer::CalcQuadLight(Intersection const& hit, blueSeed const seed) cons
 	return attenuation * cosa * probability;
 }
 
+color Renderer::CalcEmissiveLight(tinybvh::Ray const& ray) const
+{
+	emissiveSample sample; 
+	float const r0 = Sampler::Get1D(); 
+	float2 const r12 = Sampler::Get2D(); 
+	if (!mBVHScene.mEmissives.Sample(mBVHScene, r0, r12.x, r12.y, sample)) return BLACK; 
+
+	float3 dir = sample.point - ray.hit.point; 
+	float const dist2	= dot(dir, dir); 
+	float const dist	= sqrtf(dist2); 
+	dir /= dist; 
+
+	float const cosSurface	= dot(ray.hit.normal, dir); 
+	float const cosLight	= fabsf(dot(sample.normal, dir)); // emissive triangles are double-sided 
+	if (cosSurface <= 0.0f || cosLight <= 0.0f) return BLACK; 
+
+	occlusionRay const shadow = { ray.hit.point + dir * sEps, dir, dist - 2.0f * sEps }; 
+	if (mBVHScene.IsOccluded(shadow)) return BLACK; 
+
+	// convert the area pdf to solid angle, the bsdf is the one bsdf sampling estimates, fresnel included: 
+	float const pdf		= sample.pdf * dist2 / cosLight; 
+	float const weight	= mSet.mMisHeuristic != MIS_HEURISTICS_NONE ? MisWeight(pdf, scatterPdf(*ray.hit.mat, ray, dir)) : 1.0f; 
+	return sample.radiance * scatterEval(*ray.hit.mat, ray, dir) * weight / pdf; 
+}
+
+color Renderer::CalcSkydomeLight(tinybvh::Ray const& ray) const
+{
+	float3	dir; 
+	float	pdf; 
+	float2 const r = Sampler::Get2D(); 
+	if (!mSkydome.SampleDirection(r.x, r.y, dir, pdf)) return BLACK; 
+
+	float const cosSurface = dot(ray.hit.normal, dir); 
+	if (cosSurface <= 0.0f) return BLACK; 
+	if (mBVHScene.IsOccluded({ ray.hit.point + dir * sEps, dir })) return BLACK; 
+
+	float const weight = MisWeight(pdf, scatterPdf(*ray.hit.mat, ray, dir)); 
+	return mSkydome.Sample(dir) * scatterEval(*ray.hit.mat, ray, dir) * weight / pdf; 
+}
+
 color Renderer::Miss(float3 const direction) const
 {
 	return mSet.mSkydomeEnabled ? mSkydome.Sample(direction) : mMiss;
@@ -553,18 +1050,208 @@ color Renderer::Reproject(Ray const& primRay, color const& sample) const
 	return historyWeight * historySample + (1.0f - historyWeight) * sample;
 }
 
+memoryReport Renderer::GatherMemory() const
+{
+	PROFILE_SCOPE("Gather memory");
+	memoryReport report; 
+	mBVHScene.GatherMemory(report); 
+	size_t* const tags = report.mTags; 
+
+	tags[MEMORY_TAGS_TEXTURES]		+= ResourceManager::TextureBytes() + textureBytes(BlueNoise::GetInstance().mTexture); 
+	tags[MEMORY_TAGS_SKYDOME]		+= textureBytes(mSkydome.mTexture) + vectorBytes(mSkydome.mMarginalCdf) + vectorBytes(mSkydome.mConditionalCdf); 
+	tags[MEMORY_TAGS_FRAME_BUFFERS]	+= textureBytes(mAccumulator) + textureBytes(mHistory) + vectorBytes(mBatchedPixels) + vectorBytes(mSplitSampleIdx) + vectorBytes(mDependencies.mMasks) + 
+		vectorBytes(mTraversalCosts) + vectorBytes(mRowBounceCosts) + vectorBytes(mRowPrimaryTime) + vectorBytes(mRowSecondaryTime) + 
+		static_cast<size_t>(SCRWIDTH) * SCRHEIGHT * sizeof(uint); // the screen surface 
+	tags[MEMORY_TAGS_LIGHTS]		+= vectorBytes(mPointLights) + vectorBytes(mSpotLights) + vectorBytes(mLightTree.mNodes) + vectorBytes(mLightTree.mLights) + 
+		static_cast<size_t>(mLightBuffer.mPadded) * LIGHT_BUFFER_FIELDS_COUNT * sizeof(float) + textureBytes(mTexturedSpotlight.mTexture); 
+	tags[MEMORY_TAGS_CACHES]		+= vectorBytes(mPrimaryHits) + vectorBytes(mRadianceCache.mCells) + 
+		vectorBytes(mRestir.mCurrent) + vectorBytes(mRestir.mPrevious) + vectorBytes(mRestir.mSpatial) + 
+		vectorBytes(mGuide.mSpatialNodes) + vectorBytes(mGuide.mDTrees) + vectorBytes(mGuide.mRecords) + vectorBytes(mGuide.mSampleCounts); 
+	for (GuideDTree const& tree : mGuide.mDTrees) tags[MEMORY_TAGS_CACHES] += vectorBytes(tree.mSampling) + vectorBytes(tree.mBuilding); 
+	tags[MEMORY_TAGS_RAY_QUEUES]	+= vectorBytes(mPrimaryRays) + FrameArena::Stats().mCapacity; 
+	return report; 
+}
+
 void Renderer::ResetAccumulator()
 {
 	mSpp = 1;
 	mFrame = 0; 
 	mAccumulator.Clear();   
+	mDependencies.Clear(); 
+	ClearPrimaryHits(); // camera moves and setting changes both come through here 
 } 
 
+void Renderer::Invalidate(uint64_t const changed)
+{
+	// every edit that gets here changes the radiance the cache holds, it is cleared once before the next frame, 
+	// even while a slider is dragged over several: 
+	mRadianceCacheVersion = mBVHScene.mVersion - 1; 
+	if (!mSet.mSelectiveResetEnabled || changed == DEPENDENCY_ALL || mSet.mConvergeMode != CONVERGE_MODES_ACCUMULATION)
+	{
+		ResetAccumulator(); 
+		return; 
+	}
+	// pixels none of whose paths touched the change keep their samples: 
+	Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
+	{
+		for (int pixelIdx = y * SCRWIDTH; pixelIdx < (y + 1) * SCRWIDTH; pixelIdx++)
+		{
+			if (!mDependencies.Affects(pixelIdx, changed)) continue; 
+			mAccumulator[pixelIdx] = float4(0.0f); 
+			mDependencies.Forget(pixelIdx); 
+		}
+	});
+	mFrame = 0; // the reset pixels need frames again when the frame count is capped 
+}
+
 void Renderer::ResetHistory()
 {
 	mHistory.Clear();  
 }
 
+void Renderer::RebuildLights(uint64_t const changed)
+{
+	mLightTree.Build(mPointLights, mSpotLights, mSet.mPointLightsEnabled, mSet.mSpotlightsEnabled); 
+	mLightBuffer.Build(mPointLights, mSpotLights, mSet.mTexturedSpotlightEnabled ? &mTexturedSpotlight : nullptr, 
+		mSet.mPointLightsEnabled, mSet.mSpotlightsEnabled); 
+	mRestir.Invalidate(); 
+	ResetGuide(); 
+	Invalidate(changed); 
+}
+
+void Renderer::ResetGuide()
+{
+	// the guide covers the scene bounds, points outside fall into the border cells: 
+	tinybvh::BVH::BVHNode const* root = mBVHScene.mTlas.bvhNode; 
+	mGuide.Reset(root ? float3(root->aabbMin) : float3(-1.0f), root ? float3(root->aabbMax) : float3(1.0f)); 
+}
+
+void Renderer::PrepareRestir()
+{
+	PROFILE_SCOPE("ReSTIR prepare");
+	// candidates and temporal reuse need the primary hit of every pixel: 
+	Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
+	{
+		for (int x = 0; x < SCRWIDTH; x++)
+		{
+			int const pixelIdx		= x + y * SCRWIDTH; 
+			tinybvh::Ray& primRay2	= mPrimaryRays[pixelIdx]; 
+			IntersectPrimary(primRay2, pixelIdx); 
+			Sampler::Begin(pixelIdx, mSampleIdx); 
+			mRestir.GenerateCandidates(mLightTree, mBVHScene, primRay2, pixelIdx); 
+			mRestir.TemporalReuse(mLightTree, mCamera.GetPrevFrustum(), pixelIdx); 
+			Sampler::End(); 
+		}
+	});
+
+	// spatial reuse reads the reservoirs of the neighbours, so it waits for all of them: 
+	if (!mRestir.mSpatialEnabled) return; 
+	Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
+	{
+		for (int x = 0; x < SCRWIDTH; x++)
+		{
+			Sampler::Begin(x + y * SCRWIDTH, mSampleIdx); 
+			mRestir.SpatialReuse(mLightTree, x, y); 
+			Sampler::End(); 
+		}
+	});
+}
+
+void Renderer::GuideScatter(tinybvh::Ray const& ray, scatterRecord& record) const
+{
+	if (!mSet.mGuidingEnabled || !record.scattered || isSpecular(*ray.hit.mat)) return; 
+	int const dTree = mGuide.Lookup(ray.hit.point); 
+	if (!mGuide.HasDistribution(dTree)) return; 
+
+	// one-sample mis, the bsdf sample is kept with probability alpha and reweighted by the mixture pdf: 
+	float const alpha = mGuide.mBsdfFraction; 
+	if (Sampler::Get1D() < alpha)
+	{
+		if (record.pdf <= 0.0f)
+		{
+			record.attenuation /= alpha; // delta lobes can only come from the bsdf 
+			return; 
+		}
+		float const mixture = alpha * record.pdf + (1.0f - alpha) * mGuide.Pdf(dTree, record.out.D); 
+		record.attenuation	*= record.pdf / mixture; 
+		record.pdf			= mixture; 
+		return; 
+	}
+
+	float3	dir; 
+	float	guidePdf; 
+	float2 const r = Sampler::Get2D(); 
+	if (!mGuide.Sample(dTree, r.x, r.y, dir, guidePdf))
+	{
+		record.attenuation = BLACK; 
+		return; 
+	}
+	float const mixture = alpha * scatterPdf(*ray.hit.mat, ray, dir) + (1.0f - alpha) * guidePdf; 
+	record.out			= tinybvh::Ray(ray.hit.point + dir * sEps, dir); 
+	record.attenuation	= mixture > 0.0f ? scatterEval(*ray.hit.mat, ray, dir) / mixture : BLACK; 
+	record.pdf			= mixture; 
+}
+
+void Renderer::FinishPath(pathState const& path)
+{
+	mPathCount.fetch_add(1, std::memory_order_relaxed); 
+	mPathVertices.fetch_add(path.bounce, std::memory_order_relaxed); 
+	if (path.guideVertexCount > 0) mGuide.RecordPath(path.guideVertices, path.guideVertexCount, path.light); 
+	if (path.cacheVertexCount > 0) mRadianceCache.RecordPath(path.cacheVertices, path.cacheVertexCount, path.light, mCamera.mPosition); 
+	// every path of a pixel runs on the thread that owns the pixel, so no atomics: 
+	if (mSet.mSelectiveResetEnabled && path.pixelIdx >= 0) mDependencies.Record(path.pixelIdx, path.dependencies); 
+}
+
+uint64_t Renderer::SampledLights(bool const emissives) const
+{
+	// the vertex only knows its light was not black, so every light type it sampled is a dependency: 
+	uint64_t lights = 0; 
+	if (mSet.mDirLightEnabled)			lights |= PixelDependencies::LightBit(DEPENDENCY_LIGHTS_DIR); 
+	if (mSet.mPointLightsEnabled)		lights |= PixelDependencies::LightBit(DEPENDENCY_LIGHTS_POINT); 
+	if (mSet.mSpotlightsEnabled)		lights |= PixelDependencies::LightBit(DEPENDENCY_LIGHTS_SPOT); 
+	if (mSet.mTexturedSpotlightEnabled) lights |= PixelDependencies::LightBit(DEPENDENCY_LIGHTS_TEXTURED_SPOT); 
+	if (emissives)						lights |= PixelDependencies::LightBit(DEPENDENCY_LIGHTS_EMISSIVES); 
+	return lights; 
+}
+
+void Renderer::AdaptPrimarySplits()
+{
+	double primary = 0.0, secondary = 0.0; 
+	for (int y = 0; y < SCRHEIGHT; y++)
+	{
+		primary		+= mRowPrimaryTime[y]; 
+		secondary	+= mRowSecondaryTime[y]; 
+	}
+	if (primary <= 0.0 || secondary <= 0.0) return; 
+
+	// optimal branching of a two-stage estimator, sqrt of the cost ratio times the variance ratio of the stages: 
+	double const perBranch	= secondary / mPrimarySplits; 
+	float const optimum		= static_cast<float>(sqrt(mSet.mSplitVarianceRatio * primary / perBranch)); 
+	mPrimarySplitEstimate	= lerp(mPrimarySplitEstimate, optimum, 0.1f); 
+	mPrimarySplits			= clamp(static_cast<int>(mPrimarySplitEstimate + 0.5f), 1, MAX_SPLIT_FACTOR); 
+}
+
+int Renderer::SplitCount(pathState const& path) const
+{
+	if (path.split) return 1; 
+	if (path.bounce == 0 && mSet.mPrimarySplittingEnabled) return mPrimarySplits; 
+	if (!mSet.mSplittingEnabled || isSpecular(*path.ray.hit.mat)) return 1; 
+
+	// paths that arrive dim after a specular chain get fewer branches, they would be cut by roulette anyway: 
+	float const peak = max(path.throughput.x, max(path.throughput.y, path.throughput.z)); 
+	return clamp(static_cast<int>(static_cast<float>(mSet.mSplitFactor) * peak / path.rouletteWeight + 0.5f), 1, MAX_SPLIT_FACTOR); 
+}
+
+float Renderer::MisWeight(float const pdf, float const otherPdf) const
+{
+	switch (mSet.mMisHeuristic)
+	{
+	case MIS_HEURISTICS_BALANCE:	return balanceHeuristic(pdf, otherPdf); 
+	case MIS_HEURISTICS_POWER:		return powerHeuristic(pdf, otherPdf); 
+	default: return 1.0f; 
+	}
+}
+
 void Renderer::PerformanceReport()
 {
 	mAvg = (1 - mAlpha) * mAvg + mAlpha * mTimer.elapsed() * 1000;
@@ -580,6 +1267,7 @@ void Renderer::UI()
 
 void Renderer::RenderDebugViewer()
 {
+	PROFILE_SCOPE("Debug viewer");
 	int addr = 0;
 	for (int y = 0; y < SCRHEIGHT; y++) for (int x = 0; x < SCRWIDTH; x++, addr++)
 	{
@@ -594,28 +1282,15 @@ void Renderer::RenderDebugViewer()
 
 void Renderer::Init()
 {
+	PROFILE_SCOPE("Renderer::Init");
+	// the skydome decodes on a worker while the rest is set up, nothing before the wait touches it: 
+	JobCounter skydomeLoaded; 
+	Jobs::Submit([this]() { mSkydome = Skydome("../assets/hdr/kloppenheim_06_puresky_4k.hdr"); }, &skydomeLoaded); 
 	ResourceManager::Init();  
 	InitUi();
 	InitAccumulator(); 
 	mSplineAnimator = SplineAnimator(&mMovieSpline);  
 
-	//lights2.Add(LIGHT_TYPES_TEXTURED_SPOTLIGHT2); 
-	//lights2.mData[0].mTs.mIntensity = 20.0f;     
-	//lights2.mData[0].mTs.mTexture = loadTextureI("../assets/LDR_RG01_0.png");
-	//lights2.mData[0].mTs.mTexture.mSampleMode = TEXTURE_SAMPLE_MODES_CLAMPED;
-	//lights2.mData[0].mTs.mTexture.mFilterMode = TEXTURE_FILTER_MODES_NEAREST;  
-	//transformTexturedSpotlight(lights2.mData[0], { 0.0f, 4.0f, -2.5f }, 0.0f); 
-
-	lights3.Add(NEW_LIGHT_TYPES_POINT_LIGHT); 
-	lights3.mData[0].mPs[0].mColor = WHITE; 
-	lights3.mData[0].mPs[1].mColor = WHITE;
-	lights3.mData[0].mPs[2].mColor = WHITE;  
-	lights3.mData[0].mPs[3].mColor = WHITE;   
-	//lights3.mData[0].mPs.mR4 = _mm_set1_ps(1.0f);  
-	//lights3.mData[0].mPs.mR4 = _mm_set1_ps(1.0f);  
-	//lights3.mData[0].mPs.mB4 = _mm_set1_ps(1.0f);  
-	//lights3.mData[0].mPs.mI4 = _mm_set1_ps(1.0f);   
-
 	mFrame = 0;  
 	 
 	mMiss						= INIT_MISS; 
@@ -629,6 +1304,29 @@ void Renderer::Init()
 	mSet.mPointLightsEnabled	= INIT_LIGHTS_POINT_LIGHTS_ACTIVE;
 	mSet.mSpotlightsEnabled		= INIT_LIGHTS_SPOT_LIGHTS_ACTIVE; 
 	mSet.mSkydomeEnabled		= INIT_LIGHTS_SKYDOME_ACTIVE;
+	mSet.mEmissivesEnabled		= INIT_LIGHTS_EMISSIVES_ACTIVE;
+	mSet.mRestirEnabled			= INIT_RESTIR_ACTIVE;
+	mSet.mMisHeuristic			= INIT_MIS_HEURISTIC;
+	mSet.mBatchedShadingEnabled	= INIT_BATCHED_SHADING_ACTIVE;
+	mSet.mPacketTracingEnabled	= INIT_PACKET_TRACING_ACTIVE;
+	mSet.mAnalyticShapesEnabled	= INIT_ANALYTIC_SHAPES_ACTIVE;
+	mSet.mPrimaryCacheEnabled	= INIT_PRIMARY_CACHE_ACTIVE;
+	mSet.mSelectiveResetEnabled	= INIT_SELECTIVE_RESET_ACTIVE;
+	mSet.mGuidingEnabled		= INIT_GUIDING_ACTIVE;
+	mSet.mRadianceCacheEnabled	= INIT_RADIANCE_CACHE_ACTIVE;
+	mSet.mRouletteEnabled		= INIT_ROULETTE_ACTIVE;
+	mSet.mRouletteMinDepth		= INIT_ROULETTE_MIN_DEPTH;
+	mSet.mSplittingEnabled		= INIT_SPLITTING_ACTIVE;
+	mSet.mSplitFactor			= INIT_SPLIT_FACTOR;
+	mSet.mPrimarySplittingEnabled	= INIT_PRIMARY_SPLITTING_ACTIVE;
+	mSet.mPrimarySplitsAdaptive	= INIT_PRIMARY_SPLITS_ADAPTIVE;
+	mSet.mSplitVarianceRatio	= INIT_SPLIT_VARIANCE_RATIO;
+	mSet.mCostMetric			= INIT_COST_METRIC;
+	mSet.mCostBounce			= 0;
+	mSet.mCostMax				= INIT_COST_MAX;
+	mSet.mCostLogScale			= INIT_COST_LOG_SCALE;
+	mPrimarySplits				= INIT_PRIMARY_SPLITS;
+	mPrimarySplitEstimate		= static_cast<float>(INIT_PRIMARY_SPLITS);
 
 	mSet.mDofEnabled			= INIT_DOF_ACTIVE;
 	mSet.mBreakPixelEnabled		= INIT_BREAK_PIXEL;
@@ -641,6 +1339,9 @@ void Renderer::Init()
 	mDirLight.mDirection	= normalize(mDirLight.mDirection); 
 	mDirLight.mStrength		= 1.0f;
 	mDirLight.mColor		= WHITE;    
+	mBVHScene.AddAnalytic(mScene); 
+	mBVHScene.SetAnalyticVisible(mSet.mAnalyticShapesEnabled); 
+	RebuildLights(); 
 
 	mSphereMaterial = Material();     
 	mTorusMaterial	= Material();  
@@ -650,7 +1351,7 @@ void Renderer::Init()
 
 	mCubeMaterial.mGlossy.emission = WHITE * 2.0f;   
 
-	mSkydome = Skydome("../assets/hdr/kloppenheim_06_puresky_4k.hdr");    
+	Jobs::Wait(skydomeLoaded); 
 }
 
 inline void Renderer::InitUi()
@@ -666,11 +1367,44 @@ inline void Renderer::InitAccumulator()
 	//mHistory.mOwnData		= true; 
 	mHistory.mSampleMode	= TEXTURE_SAMPLE_MODES_CLAMPED;    
 	mHistory.mFilterMode	= TEXTURE_FILTER_MODES_LINEAR;     
+	mRestir.Init(SCRWIDTH, SCRHEIGHT); 
+	mPrimaryRays.resize(SCRWIDTH * SCRHEIGHT); 
+	mBatchedPixels.resize(SCRWIDTH * SCRHEIGHT); 
+	mSplitSampleIdx.resize(SCRWIDTH * SCRHEIGHT); 
+	mPrimaryHits.resize(SCRWIDTH * SCRHEIGHT); 
+	mDependencies.Init(SCRWIDTH * SCRHEIGHT); 
+	mTraversalCosts.resize(SCRWIDTH * SCRHEIGHT); 
+	mRowBounceCosts.resize(SCRHEIGHT * INIT_MAX_BOUNCES); 
+	mRadianceCache.Init(); 
+	mRowPrimaryTime.resize(SCRHEIGHT); 
+	mRowSecondaryTime.resize(SCRHEIGHT); 
+}
+
+void Renderer::GenCameraRays(bool const sampled)
+{
+	PROFILE_SCOPE("Camera rays");
+	// jitter and lens draw from the sampler per pixel, blue noise is one of its types; the camera then 
+	// turns the row into rays eight at a time. without aa the pixel is offset by half of it, like CenterOfPixel: 
+	bool const jittered = sampled && mSet.mAaEnabled; 
+	bool const focused	= sampled && mSet.mDofEnabled; 
+	Jobs::ParallelFor(0, SCRHEIGHT, 1, [&](int const y)
+	{
+		float2 offsets[SCRWIDTH]; 
+		float2 lens[SCRWIDTH]; 
+		if (sampled) for (int x = 0; x < SCRWIDTH; x++)
+		{
+			Sampler::Begin(x + y * SCRWIDTH, mSampleIdx); 
+			offsets[x] = jittered ? Sampler::Get2D() : float2(0.5f); 
+			if (focused) lens[x] = Sampler::Get2D(); 
+			Sampler::End(); 
+		}
+		mCamera.GenPrimaryRays(0, y, SCRWIDTH, &mPrimaryRays[y * SCRWIDTH], sampled ? offsets : nullptr, focused ? lens : nullptr); 
+	});
 }
 
 float2 Renderer::RandomOnPixel(int const x, int const y) const
 {
-	return { static_cast<float>(x) + RandomFloat(), static_cast<float>(y) + RandomFloat() }; 
+	return float2(static_cast<float>(x), static_cast<float>(y)) + Sampler::Get2D(); 
 }
 
 float2 Renderer::RandomOnPixel(blueSeed const seed) const 
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "lights.h"
+#include "light_tree.h"
+#include "light_buffer.h"
+#include "restir.h"
+#include "guiding.h"
+#include "radiance_cache.h"
+#include "pixel_dependencies.h"
 #include "materials.h" 
 #include "ui.h" 
 #include "scene.h"
@@ -15,7 +21,16 @@ enum renderModes : uint8_t
 	RENDER_MODES_NORMALS,
 	RENDER_MODES_DEPTH,
 	RENDER_MODES_ALBEDO,
-	RENDER_MODES_SHADED
+	RENDER_MODES_SHADED,
+	RENDER_MODES_TRAVERSAL_COST	// heatmap of the bvh work per pixel
+};
+
+enum costMetrics : uint8_t
+{
+	COST_METRICS_NODES,
+	COST_METRICS_TRIANGLES,
+	COST_METRICS_INSTANCES,
+	COST_METRICS_COUNT
 };
 
 enum convergeModes : uint8_t
@@ -25,7 +40,16 @@ enum convergeModes : uint8_t
 	CONVERGE_MODES_REPROJECTION
 };
 
+enum misHeuristics : uint8_t
+{
+	MIS_HEURISTICS_NONE,		// light sampling only, bsdf hits on sampled emitters are dropped
+	MIS_HEURISTICS_BALANCE, 
+	MIS_HEURISTICS_POWER, 
+	MIS_HEURISTICS_COUNT
+};
+
 inline auto constexpr MOVIE_FILE_PATH = "../assets/spline.txt";
+inline auto constexpr TRAVERSAL_COST_FILE_PATH = "../assets/traversal_cost.csv";
 
 color const		INIT_MISS						= WHITE * 0.4f;  
 int constexpr	INIT_RENDER_MODE				= RENDER_MODES_NORMALS;
@@ -33,11 +57,36 @@ int constexpr	INIT_CONVERGE_MODE				= CONVERGE_MODES_ACCUMULATION;
 float constexpr INIT_EPS						= 1e-3f;
 float constexpr INIT_HISTORY_WEIGHT				= 0.8f; 
 int constexpr	INIT_MAX_BOUNCES				= 10;  
+int constexpr	INIT_MIS_HEURISTIC				= MIS_HEURISTICS_POWER; 
 
 bool constexpr	INIT_LIGHTS_DIR_LIGHT_ACTIVE	= false;  
 bool constexpr	INIT_LIGHTS_POINT_LIGHTS_ACTIVE	= false;
 bool constexpr	INIT_LIGHTS_SPOT_LIGHTS_ACTIVE	= false;
 bool constexpr	INIT_LIGHTS_SKYDOME_ACTIVE		= false;        
+bool constexpr	INIT_LIGHTS_EMISSIVES_ACTIVE	= true;  
+bool constexpr	INIT_RESTIR_ACTIVE				= false; 
+bool constexpr	INIT_BATCHED_SHADING_ACTIVE		= false; 
+bool constexpr	INIT_PACKET_TRACING_ACTIVE		= false; 
+bool constexpr	INIT_ANALYTIC_SHAPES_ACTIVE		= false; 
+int constexpr	PACKET_WIDTH					= 8;	// rays per avx2 stream query of the analytic scene 
+bool constexpr	INIT_PRIMARY_CACHE_ACTIVE		= true; 
+bool constexpr	INIT_SELECTIVE_RESET_ACTIVE		= true; 
+uint32_t constexpr PRIMARY_HIT_EMPTY			= UINT32_MAX;	// prim of a pixel without a cached hit 
+bool constexpr	INIT_GUIDING_ACTIVE				= false; 
+bool constexpr	INIT_RADIANCE_CACHE_ACTIVE		= false; 
+bool constexpr	INIT_ROULETTE_ACTIVE			= true; 
+int constexpr	INIT_ROULETTE_MIN_DEPTH			= 3;	// vertices shaded before a path can be terminated 
+bool constexpr	INIT_SPLITTING_ACTIVE			= false; 
+int constexpr	INIT_SPLIT_FACTOR				= 4;	// branches at the first diffuse vertex of a full-throughput path 
+int constexpr	MAX_SPLIT_FACTOR				= 16; 
+bool constexpr	INIT_PRIMARY_SPLITTING_ACTIVE	= false; 
+bool constexpr	INIT_PRIMARY_SPLITS_ADAPTIVE	= true; 
+int constexpr	INIT_PRIMARY_SPLITS				= 2;	// secondary paths per primary hit 
+float constexpr INIT_SPLIT_VARIANCE_RATIO		= 4.0f;	// assumed variance of the secondary paths over that of the primary sample 
+int constexpr	BATCH_TILE_SIZE					= 16;	// paths of a batch come from one square tile 
+int constexpr	INIT_COST_METRIC				= COST_METRICS_NODES; 
+float constexpr INIT_COST_MAX					= 200.0f;	// count that maps to the hot end of the heatmap 
+bool constexpr	INIT_COST_LOG_SCALE				= false; 
 
 bool constexpr	INIT_DOF_ACTIVE					= false;  
 bool constexpr	INIT_BREAK_PIXEL				= false; 
@@ -51,6 +100,7 @@ struct Settings
 	// MODES:
 	int		mRenderMode; 
 	int		mConvergeMode;
+	int		mMisHeuristic;		// combines bsdf sampling with emissive and skydome sampling 
 	// DEBUGGING:
 	bool	mDebugViewerEnabled; 
 	bool	mBreakPixelEnabled; 
@@ -62,6 +112,19 @@ struct Settings
 	bool	mAutoFocusEnabled;	// make depth of field automatically focus
 	bool	mBlueNoiseEnabled; 
 	bool	mStochasticLights; 
+	bool	mRestirEnabled;		// reservoir resampling for the primary hit 
+	bool	mBatchedShadingEnabled;	// trace tiles wavefront-style and shade hits sorted by material 
+	bool	mPacketTracingEnabled;	// analytic scene: primary and directional shadow rays eight at a time 
+	bool	mAnalyticShapesEnabled;	// the analytic scene's shapes in the tlas, next to the meshes 
+	bool	mPrimaryCacheEnabled;	// reuse the primary hit of the previous frame while the camera is still 
+	bool	mSelectiveResetEnabled;	// edits only reset the pixels whose paths touched what changed 
+	bool	mGuidingEnabled;	// learn incident radiance and mix it with bsdf sampling 
+	bool	mRadianceCacheEnabled;	// end diffuse paths in a world-space cache after a few bounces 
+	bool	mRouletteEnabled;	// throughput-based russian roulette 
+	bool	mSplittingEnabled;	// branch paths at their first diffuse vertex 
+	bool	mPrimarySplittingEnabled;	// trace several secondary paths per primary hit 
+	bool	mPrimarySplitsAdaptive;	// pick their count from the measured primary and secondary cost 
+	bool	mCostLogScale;		// heatmap over the log of the count, so the few worst pixels do not wash out the rest 
 	// LIGHTS:
 	bool	mDirLightEnabled;
 	bool	mPointLightsEnabled;
@@ -69,9 +132,25 @@ struct Settings
 	bool	mQuadLightEnabled;
 	bool	mSkydomeEnabled;
 	bool	mTexturedSpotlightEnabled; 
+	bool	mEmissivesEnabled;	// next-event estimation for emissive triangles 
 	// SLIDERS:
 	int		mMaxBounces; 
 	int		mMaxFrames;
+	int		mRouletteMinDepth; 
+	int		mSplitFactor; 
+	float	mSplitVarianceRatio; 
+	int		mCostMetric; 
+	int		mCostBounce;		// path segment the heatmap shows, zero for primary rays 
+	float	mCostMax; 
+};
+
+// traversal work of all rays of one bounce in a frame
+struct bounceCost
+{
+	uint64_t	mNodes		= 0;
+	uint64_t	mTris		= 0;
+	uint64_t	mInstances	= 0;
+	uint64_t	mRays		= 0;
 };
 
 struct Intersection
@@ -86,6 +165,40 @@ struct Intersection
 	uint8_t			padding[7];
 };
 
+// primary hit of a pixel in the previous frame, t is BVH_FAR for a miss
+struct primaryHit
+{
+	float		t		= BVH_FAR;
+	float		u		= 0.0f;
+	float		v		= 0.0f;
+	uint32_t	prim	= PRIMARY_HIT_EMPTY;
+	uint32_t	inst	= 0;
+};
+
+// state of one path in flight, shared by the recursive and the batched tracer
+struct pathState
+{
+	tinybvh::Ray	ray;
+	color			light			= BLACK;
+	color			throughput		= WHITE;
+	float			bsdfPdf			= 0.0f;		// pdf of the last scatter direction, zero for delta lobes
+	int				pixelIdx		= -1;		// -1 for paths that belong to no pixel 
+	bool			countEmission	= true;		// emitters found by a non-specular bounce are already sampled explicitly
+	bool			skydomeSampled	= false;	// the previous vertex sampled the skydome explicitly
+	bool			active			= true;
+	int				bounce			= 0;		// vertices shaded so far 
+	float			rouletteWeight	= 1.0f;		// throughput roulette aims for, split branches aim lower 
+	bool			split			= false;	// branched already, branches do not branch again 
+	float			directWeight	= 1.0f;		// of the direct light at the next vertex, zero for branches that share it 
+	bool			cacheTraining	= false;	// ignores the radiance cache and only feeds it 
+	uint64_t		dependencies	= 0;		// lights and instances the path touched 
+	int				guideVertexCount = 0;
+	guideVertex		guideVertices[GUIDE_MAX_VERTICES];
+	int				cacheVertexCount = 0;
+	cacheVertex		cacheVertices[RADIANCE_CACHE_MAX_VERTICES];
+	samplerState	sampler;	// the batched tracer interleaves paths on one thread 
+};
+
 namespace Tmpl8
 {
 class Renderer final : public TheApp
@@ -112,6 +225,19 @@ public:
 
 	std::vector<PointLight> mPointLights; 
 	std::vector<Spotlight>	mSpotLights; 
+	LightTree				mLightTree; 
+	LightBuffer				mLightBuffer; 
+	Restir					mRestir; 
+	PathGuide				mGuide; 
+	RadianceCache			mRadianceCache; 
+	uint32_t				mRadianceCacheVersion = 0;	// scene version the cache was filled with, Invalidate sets it stale for the edits that leave the version 
+	std::vector<tinybvh::Ray> mPrimaryRays;	// camera rays of the current frame, restir intersects them in place for reservoir reuse 
+	std::vector<color>		mBatchedPixels;	// output of the batched tracer 
+	PixelDependencies		mDependencies; 
+	std::vector<primaryHit>	mPrimaryHits;	// per pixel, emptied whenever the accumulator resets 
+	uint32_t				mPrimaryHitsVersion = 0;	// scene version the primary hits were found in 
+	std::atomic<uint32_t>	mPrimaryReuses	= 0;	// primary rays the cache answered this frame 
+	float					mPrimaryReuseRate = 0.0f;	// of the last frame 
 	TexturedSpotlight		mTexturedSpotlight; 
 	DirectionalLight		mDirLight;
 	Skydome					mSkydome;  
@@ -122,6 +248,21 @@ public:
 	float					mHistoryWeight; 
 
 	int						mSpp;
+	uint32_t				mSampleIdx;		// sample index of the frame being accumulated 
+	std::vector<uint32_t>	mSplitSampleIdx;	// per pixel, branches split off so far, a pixel is traced by one thread at a time 
+	std::atomic<uint64_t>	mPathCount		= 0;	// finished paths of the current frame 
+	std::atomic<uint64_t>	mPathVertices	= 0; 
+	std::atomic<uint64_t>	mRouletteKills	= 0; 
+	float					mAvgPathLength	= 0.0f;	// of the last frame 
+	float					mRouletteRate	= 0.0f;	// fraction of paths the last frame ended by roulette 
+	int						mPrimarySplits;			// secondary paths per primary hit 
+	float					mPrimarySplitEstimate;	// smoothed optimum, mPrimarySplits rounds it 
+	std::vector<float>		mRowPrimaryTime;		// seconds spent on primary visibility per row 
+	std::vector<float>		mRowSecondaryTime; 
+	std::vector<traversalCost> mTraversalCosts;	// per pixel, of the bounce the heatmap shows 
+	std::vector<bounceCost>	mRowBounceCosts;	// per row and bounce, rows belong to one thread 
+	bounceCost				mBounceCosts[INIT_MAX_BOUNCES];	// of the last frame 
+	torusReport				mTorusReport;	// analytic torus tests of the last frame with stats on 
 	int						mFrame; 
 	bool					mBreakPixel; 
 
@@ -134,7 +275,12 @@ public:
 public:
 	void						Tick( float deltaTime ) override;
 	void						ResetAccumulator(); 
+	void						Invalidate(uint64_t const changed); 
 	void						ResetHistory(); 
+	void						RebuildLights(uint64_t const changed = DEPENDENCY_ALL); 
+	void						ResetGuide(); 
+	void						ExportTraversalCost(char const* path) const; 
+	[[nodiscard]] memoryReport	GatherMemory() const; 
 
 	inline Settings&			GetSettings()			{ return mSet; } 
 	inline DebugViewer2D&		GetDebugViewer()		{ return mDebugViewer; }
@@ -148,7 +294,20 @@ public:
 private:
 	[[nodiscard]] color			Trace(Ray& primRay) const;  
 	[[nodiscard]] color			Trace(tinybvh::Ray& primRay); 
+	[[nodiscard]] color			TraceFromHit(tinybvh::Ray const& primRay, Reservoir const* reservoir, int const pixelIdx); 
+	bool						IntersectPrimary(tinybvh::Ray& ray, int const pixelIdx); 
+	void						ClearPrimaryHits(); 
+	void						TracePath(pathState& path, Reservoir const* reservoir); 
+	void						TraceBatched(); 
+	void						ShadeVertex(pathState& path, scatterRecord const& record, Reservoir const* reservoir); 
+	void						GuideScatter(tinybvh::Ray const& ray, scatterRecord& record) const; 
+	void						FinishPath(pathState const& path); 
+	[[nodiscard]] int			SplitCount(pathState const& path) const; 
+	[[nodiscard]] uint64_t		SampledLights(bool const emissives) const; 
+	void						AdaptPrimarySplits(); 
 	[[nodiscard]] color			Trace(Ray& primRay, blueSeed& seed) const;    
+	[[nodiscard]] color			TraceFromPrimary(Ray const& primRay, blueSeed* seed, bool const* dirOccluded) const; 
+	void						TracePackets(); 
 	[[nodiscard]] color			TraceDebug(Ray& ray, debug debug = {});
 	[[nodiscard]] color			TraceNormals(Ray& ray) const;  
 	[[nodiscard]] color			TraceNormals(tinybvh::Ray& ray);  
@@ -156,19 +315,25 @@ private:
 	[[nodiscard]] color			TraceDepth(tinybvh::Ray& ray) const; 
 	[[nodiscard]] color			TraceAlbedo(Ray& ray) const; 
 	[[nodiscard]] color			TraceAlbedo(tinybvh::Ray& ray); 
-	[[nodiscard]] color			CalcDirectLight(Intersection const& hit) const; 
-	[[nodiscard]] color			CalcDirectLight(tinybvh::Ray const& ray) const; 
-	[[nodiscard]] color			CalcDirectLightWithArea(Intersection const& info) const;
-	[[nodiscard]] color			CalcDirectLightWithArea(tinybvh::Ray const& ray) const; 
-	[[nodiscard]] color			CalcDirectLightWithArea(Intersection const& hit, blueSeed const seed) const;
+	[[nodiscard]] color			TraceTraversalCost(tinybvh::Ray& ray, int const pixelIdx, int const y); 
+	[[nodiscard]] color			CalcDirectLight(Intersection const& hit, bool const* dirOccluded = nullptr) const; 
+	[[nodiscard]] color			CalcDirectLight(tinybvh::Ray const& ray, Reservoir const* reservoir = nullptr) const; 
+	[[nodiscard]] color			CalcDirectLightWithArea(Intersection const& info, bool const* dirOccluded = nullptr) const;
+	[[nodiscard]] color			CalcDirectLightWithArea(tinybvh::Ray const& ray, Reservoir const* reservoir = nullptr) const; 
+	[[nodiscard]] color			CalcDirectLightWithArea(Intersection const& hit, blueSeed const seed, bool const* dirOccluded = nullptr) const;
 	[[nodiscard]] color			CalcQuadLight(Intersection const& hit) const;
+	[[nodiscard]] color			CalcEmissiveLight(tinybvh::Ray const& ray) const; 
+	[[nodiscard]] color			CalcSkydomeLight(tinybvh::Ray const& ray) const; 
+	[[nodiscard]] float			MisWeight(float const pdf, float const otherPdf) const; 
 	[[nodiscard]] color			CalcQuadLight(Intersection const& hit, blueSeed const seed) const; 
 	[[nodiscard]] color			Miss(float3 const direction) const;
 	[[nodiscard]] color			MissIntensity(Intersection const& hit) const; 
 	[[nodiscard]] color			MissIntensity(tinybvh::Ray const& ray) const;  
 	[[nodiscard]] Intersection	CalcIntersection(Ray const& ray) const;
 	[[nodiscard]] color			Reproject(Ray const& primRay, color const& sample) const;  
+	void						PrepareRestir(); 
 	void						PerformanceReport();  
+	void						GenCameraRays(bool const sampled); 
 
 	[[nodiscard]] inline float2		RandomOnPixel(int const x, int const y) const;  
 	[[nodiscard]] inline float2		RandomOnPixel(blueSeed const seed) const;  
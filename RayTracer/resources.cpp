@@ -5,8 +5,241 @@
 #include <../lib/assimp/Importer.hpp>
 #include <../lib/assimp/scene.h>  
 #include <../lib/assimp/postprocess.h> 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// one decoded image, shared by every handle that loads its file or a file with the same texels
+struct textureEntry
+{
+	PackedTexture				mTexture;	// owns the texels, or is a paged view of mPages
+	std::unique_ptr<PagedTexture> mPages;	// for large textures, only their resident tiles take memory
+	std::string					mPath;
+	std::vector<std::string>	mKeys;		// path and format of every file that resolved to it
+	uint64_t					mHash;
+	int							mRefs = 0;
+};
+
+// handles are taken and dropped by loaders on any thread, the store itself is only touched under the lock:
+static std::mutex									store;
+static std::vector<std::unique_ptr<textureEntry>>	entries;
+static std::vector<int>								freeEntries;
+static std::unordered_map<std::string, int>			byKey;
+static std::unordered_multimap<uint64_t, int>		byHash;
+static std::unordered_set<uint64_t>					paging;		// texels whose cache file is being written outside the lock
+static std::condition_variable						pagingDone;
+
+static std::string textureKey(std::string const& path, uint8_t const format)
+{
+	return path + (format == TEXTURE_FORMATS_FLOAT ? "#f" : "#i");
+}
+
+static size_t entryBytes(textureEntry const& entry)
+{
+	return entry.mPages ? entry.mPages->mResidentBytes.load(std::memory_order_relaxed) : textureBytes(entry.mTexture);
+}
+
+static uint64_t hashTexels(void const* data, size_t const bytes)
+{
+	// fnv-1a over whole words, it only narrows down the images that are compared in full:
+	uint8_t const*	p = static_cast<uint8_t const*>(data);
+	uint64_t		h = 0xcbf29ce484222325ull;
+	size_t			i = 0;
+	for (; i + 8 <= bytes; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, p + i, 8);
+		h = (h ^ word) * 0x100000001b3ull;
+	}
+	for (; i < bytes; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+	return h;
+}
 
 void ResourceManager::Init()
 {
+	PROFILE_SCOPE("ResourceManager::Init");
 	BlueNoise::GetInstance(); 
 }
+
+TextureHandle ResourceManager::LoadTexture(std::string const& path, uint8_t const format)
+{
+	std::string const key = textureKey(path, format);
+	{
+		std::lock_guard<std::mutex> lock(store);
+		auto const it = byKey.find(key);
+		if (it != byKey.end())
+		{
+			entries[it->second]->mRefs++;
+			return TextureHandle(it->second);
+		}
+	}
+
+	// decoded outside the lock, so loaders on other threads are not held up:
+	Texture<float3> const source	= format == TEXTURE_FORMATS_FLOAT ? loadTextureF(path.c_str()) : loadTextureI(path.c_str());
+	uint64_t const hash				= hashTexels(source.mData, sizeof(float3) * source.mWidth * source.mHeight);
+	PackedTexture packed			= packTexture(source);
+
+	bool const paged = TextureResidency::sEnabled && max(packed.mWidth, packed.mHeight) >= TEXTURE_PAGING_MIN_SIZE;
+	std::unique_lock<std::mutex> lock(store);
+	for (;;)
+	{
+		// another thread may have loaded the same file in the meantime:
+		auto const it = byKey.find(key);
+		if (it != byKey.end())
+		{
+			entries[it->second]->mRefs++;
+			return TextureHandle(it->second);
+		}
+
+		// the same texels under another name are shared as well:
+		auto const range = byHash.equal_range(hash);
+		for (auto i = range.first; i != range.second; ++i)
+		{
+			textureEntry& entry = *entries[i->second];
+			if (entry.mTexture.mWidth != packed.mWidth || entry.mTexture.mHeight != packed.mHeight) continue;
+			// the texels of a paged texture are on disk, its hash and size have to do:
+			if (!entry.mPages && textureBytes(packed) > 0 && memcmp(entry.mTexture.mData, packed.mData, textureBytes(packed)) != 0) continue;
+			entry.mKeys.push_back(key);
+			entry.mRefs++;
+			byKey[key] = i->second;
+			return TextureHandle(i->second);
+		}
+
+		// one load writes the cache file of these texels, the others wait for its entry and share it:
+		if (!paged || paging.find(hash) == paging.end()) break;
+		pagingDone.wait(lock);
+	}
+
+	std::unique_ptr<PagedTexture> pages;
+	if (paged)
+	{
+		// the mip chain is written with the store open, so other loads and the ui are not held up by the disk:
+		paging.insert(hash);
+		lock.unlock();
+		pages = pageTexture(packed, hash);
+		lock.lock();
+		paging.erase(hash);
+		pagingDone.notify_all();
+	}
+
+	int entryIdx = static_cast<int>(entries.size());
+	if (!freeEntries.empty())
+	{
+		entryIdx = freeEntries.back();
+		freeEntries.pop_back();
+	}
+	else entries.emplace_back();
+	entries[entryIdx]			= std::make_unique<textureEntry>();
+	textureEntry& entry			= *entries[entryIdx];
+	if (pages)
+	{
+		entry.mPages				= std::move(pages);
+		entry.mTexture				= PackedTexture(entry.mPages.get(), packed.mWidth, packed.mHeight);
+	}
+	else entry.mTexture			= std::move(packed);
+	entry.mPath					= path;
+	entry.mKeys.push_back(key);
+	entry.mHash					= hash;
+	entry.mRefs					= 1;
+	byKey[key]					= entryIdx;
+	byHash.insert({ hash, entryIdx });
+	return TextureHandle(entryIdx);
+}
+
+std::vector<textureInfo> ResourceManager::TextureInfo()
+{
+	std::lock_guard<std::mutex> lock(store);
+	std::vector<textureInfo> infos;
+	for (std::unique_ptr<textureEntry> const& entry : entries)
+	{
+		if (!entry) continue;
+		infos.push_back({ entry->mPath, entry->mTexture.mWidth, entry->mTexture.mHeight, entryBytes(*entry),
+			entry->mRefs, static_cast<int>(entry->mKeys.size()) - 1, entry->mPages != nullptr });
+	}
+	return infos;
+}
+
+size_t ResourceManager::TextureBytes()
+{
+	std::lock_guard<std::mutex> lock(store);
+	size_t bytes = 0;
+	for (std::unique_ptr<textureEntry> const& entry : entries) if (entry) bytes += entryBytes(*entry);
+	return bytes;
+}
+
+void ResourceManager::AddRef(int const entry)
+{
+	std::lock_guard<std::mutex> lock(store);
+	entries[entry]->mRefs++;
+}
+
+void ResourceManager::Release(int const entry)
+{
+	// the texels are freed after the lock is let go:
+	std::unique_ptr<textureEntry> unused;
+	{
+		std::lock_guard<std::mutex> lock(store);
+		textureEntry& e = *entries[entry];
+		if (--e.mRefs > 0) return;
+		for (std::string const& key : e.mKeys) byKey.erase(key);
+		auto const range = byHash.equal_range(e.mHash);
+		for (auto i = range.first; i != range.second; ++i) if (i->second == entry)
+		{
+			byHash.erase(i);
+			break;
+		}
+		unused = std::move(entries[entry]);
+		freeEntries.push_back(entry);
+	}
+}
+
+PackedTexture ResourceManager::View(int const entry)
+{
+	std::lock_guard<std::mutex> lock(store);
+	PackedTexture const& texture	= entries[entry]->mTexture;
+	PackedTexture view				= texture.mPaged ? PackedTexture(texture.mPages, texture.mWidth, texture.mHeight) : PackedTexture(texture.mData, texture.mWidth, texture.mHeight);
+	view.mSampleMode				= texture.mSampleMode;
+	view.mFilterMode				= texture.mFilterMode;
+	return view;
+}
+
+size_t ResourceManager::EntryBytes(int const entry)
+{
+	std::lock_guard<std::mutex> lock(store);
+	return entryBytes(*entries[entry]);
+}
+
+TextureHandle::TextureHandle(TextureHandle const& other) :
+	mEntry(other.mEntry)
+{
+	if (mEntry >= 0) ResourceManager::AddRef(mEntry);
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept :
+	mEntry(other.mEntry)
+{
+	other.mEntry = -1;
+}
+
+TextureHandle::~TextureHandle()
+{
+	if (mEntry >= 0) ResourceManager::Release(mEntry);
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other) noexcept
+{
+	std::swap(mEntry, other.mEntry);
+	return *this;
+}
+
+PackedTexture TextureHandle::View() const
+{
+	return mEntry >= 0 ? ResourceManager::View(mEntry) : PackedTexture();
+}
+
+size_t TextureHandle::Bytes() const
+{
+	return mEntry >= 0 ? ResourceManager::EntryBytes(mEntry) : 0;
+}
@@ -3,9 +3,31 @@
 #include "textures.h" 
 #include "bvh_scene.h"  
 
+// resident texture of the store, for the ui
+struct textureInfo
+{
+	std::string	mPath;		// first file it was loaded from
+	int			mWidth;
+	int			mHeight;
+	size_t		mBytes;		// only the resident tiles of a paged texture
+	int			mRefs;		// live handles
+	int			mAliases;	// files that turned out to hold the same image
+	bool		mPaged;
+};
+
 class ResourceManager
 {
 public:
-	static void Init(); 
-};
+	static void								Init();
+	// shared by every handle with the same path and format, or the same texels under another path
+	[[nodiscard]] static TextureHandle		LoadTexture(std::string const& path, uint8_t const format = TEXTURE_FORMATS_FLOAT);
+	[[nodiscard]] static std::vector<textureInfo> TextureInfo();
+	[[nodiscard]] static size_t				TextureBytes();
 
+private:
+	friend class TextureHandle;
+	static void								AddRef(int const entry);
+	static void								Release(int const entry);
+	[[nodiscard]] static PackedTexture		View(int const entry);
+	[[nodiscard]] static size_t				EntryBytes(int const entry);
+};
@@ -0,0 +1,184 @@
+#include "precomp.h"
+#include "restir.h"
+
+#include "renderer.h"
+#include "bvh_scene.h"
+
+void Restir::Init(int const width, int const height)
+{
+	mWidth	= width;
+	mHeight = height;
+	mCurrent.assign(width * height, {});
+	mPrevious.assign(width * height, {});
+	mSpatial.assign(width * height, {});
+	mHistoryValid = false;
+}
+
+void Restir::Invalidate()
+{
+	// light indices of the previous frame no longer match the tree:
+	mHistoryValid = false;
+}
+
+void Restir::GenerateCandidates(LightTree const& tree, BVHScene const& scene, tinybvh::Ray const& ray, int const pixelIdx)
+{
+	Reservoir reservoir;
+	if (ray.hit.t >= BVH_FAR || tree.IsEmpty())
+	{
+		mCurrent[pixelIdx] = reservoir;
+		return;
+	}
+	reservoir.mPoint	= ray.hit.point;
+	reservoir.mNormal	= ray.hit.normal;
+	reservoir.mT		= ray.hit.t;
+
+	// resampled importance sampling, the light tree is the source distribution:
+	Sampler::Seek(SAMPLER_RESTIR_CANDIDATES);
+	for (int i = 0; i < mCandidates; i++)
+	{
+		float sourcePdf;
+		float2 const r		= Sampler::Get2D();
+		int const lightIdx	= tree.SampleIdx(reservoir.mPoint, reservoir.mNormal, r.x, sourcePdf);
+		if (lightIdx < 0)
+		{
+			reservoir.mM += 1.0f;
+			continue;
+		}
+		float const pHat = targetPdf(tree, lightIdx, reservoir.mPoint, reservoir.mNormal);
+		update(reservoir, lightIdx, pHat / sourcePdf, pHat, 1.0f, r.y);
+	}
+	finalize(reservoir);
+
+	// visibility reuse, occluded samples must not spread to other pixels:
+	if (mVisibilityEnabled && reservoir.mLightIdx >= 0 && reservoir.mW > 0.0f)
+	{
+		float3 dir			= tree.Position(reservoir.mLightIdx) - reservoir.mPoint;
+		float const dist	= length(dir);
+		dir					/= dist;
+		occlusionRay const shadow = { reservoir.mPoint + dir * Renderer::sEps, dir, dist - 2.0f * Renderer::sEps };
+		if (scene.IsOccluded(shadow)) reservoir.mW = 0.0f;
+	}
+	mCurrent[pixelIdx] = reservoir;
+}
+
+void Restir::TemporalReuse(LightTree const& tree, Frustum const& prevFrustum, int const pixelIdx)
+{
+	if (!mTemporalEnabled || !mHistoryValid) return;
+	Reservoir const& current = mCurrent[pixelIdx];
+	if (current.mT <= 0.0f) return;
+
+	// find the pixel in the previous frame, same projection as the reprojector:
+	float const dLeft	= distanceToFrustum(prevFrustum.mPlanes[0], current.mPoint);
+	float const dRight	= distanceToFrustum(prevFrustum.mPlanes[1], current.mPoint);
+	float const dTop	= distanceToFrustum(prevFrustum.mPlanes[2], current.mPoint);
+	float const dBottom = distanceToFrustum(prevFrustum.mPlanes[3], current.mPoint);
+	int const prevX		= static_cast<int>(mWidth * dLeft / (dLeft + dRight));
+	int const prevY		= static_cast<int>(mHeight * dTop / (dTop + dBottom));
+	if (prevX < 0 || prevX >= mWidth || prevY < 0 || prevY >= mHeight) return;
+
+	Reservoir previous = mPrevious[prevX + prevY * mWidth];
+	if (!isSimilar(previous, current)) return;
+	previous.mM = min(previous.mM, mHistoryClamp * current.mM);
+
+	Reservoir reservoir;
+	reservoir.mPoint	= current.mPoint;
+	reservoir.mNormal	= current.mNormal;
+	reservoir.mT		= current.mT;
+	Sampler::Seek(SAMPLER_RESTIR_TEMPORAL);
+	float2 const r = Sampler::Get2D();
+	combine(reservoir, current, current.mTargetPdf, r.x);
+	combine(reservoir, previous, targetPdf(tree, previous.mLightIdx, current.mPoint, current.mNormal), r.y);
+	finalize(reservoir);
+	mCurrent[pixelIdx] = reservoir;
+}
+
+void Restir::SpatialReuse(LightTree const& tree, int const x, int const y)
+{
+	int const pixelIdx = x + y * mWidth;
+	Reservoir const& center = mCurrent[pixelIdx];
+	if (center.mT <= 0.0f)
+	{
+		mSpatial[pixelIdx] = center;
+		return;
+	}
+
+	Reservoir reservoir;
+	reservoir.mPoint	= center.mPoint;
+	reservoir.mNormal	= center.mNormal;
+	reservoir.mT		= center.mT;
+	Sampler::Seek(SAMPLER_RESTIR_SPATIAL);
+	combine(reservoir, center, center.mTargetPdf, Sampler::Get1D());
+
+	// neighbours are reused without a shadow ray, which trades a little bias for speed:
+	for (int i = 0; i < mSpatialSamples; i++)
+	{
+		float2 const r		= Sampler::Get2D();
+		float const pick	= Sampler::Get1D();
+		float const angle	= TWOPI * r.x;
+		float const radius	= mSpatialRadius * sqrtf(r.y);
+		int const nx		= x + static_cast<int>(cosf(angle) * radius);
+		int const ny		= y + static_cast<int>(sinf(angle) * radius);
+		if (nx < 0 || nx >= mWidth || ny < 0 || ny >= mHeight || (nx == x && ny == y)) continue;
+
+		Reservoir const& neighbour = mCurrent[nx + ny * mWidth];
+		if (!isSimilar(neighbour, center)) continue;
+		combine(reservoir, neighbour, targetPdf(tree, neighbour.mLightIdx, center.mPoint, center.mNormal), pick);
+	}
+	finalize(reservoir);
+	mSpatial[pixelIdx] = reservoir;
+}
+
+color Restir::Shade(LightTree const& tree, BVHScene const& scene, Reservoir const& reservoir, tinybvh::Ray const& ray) const
+{
+	if (reservoir.mLightIdx < 0 || reservoir.mW <= 0.0f) return BLACK;
+
+	float3 dir			= tree.Position(reservoir.mLightIdx) - ray.hit.point;
+	float const dist	= length(dir);
+	dir					/= dist;
+	occlusionRay const shadow = { ray.hit.point + dir * Renderer::sEps, dir, dist - 2.0f * Renderer::sEps };
+	if (scene.IsOccluded(shadow)) return BLACK;
+
+	return tree.Unshadowed(reservoir.mLightIdx, ray.hit.point, ray.hit.normal) * reservoir.mW;
+}
+
+void Restir::EndFrame()
+{
+	PROFILE_SCOPE("ReSTIR end frame");
+	std::swap(mPrevious, mSpatialEnabled ? mSpatial : mCurrent);
+	mHistoryValid = true;
+}
+
+float targetPdf(LightTree const& tree, int const lightIdx, float3 const point, float3 const normal)
+{
+	if (lightIdx < 0) return 0.0f;
+	return luminance(tree.Unshadowed(lightIdx, point, normal));
+}
+
+bool update(Reservoir& reservoir, int const lightIdx, float const weight, float const targetPdf, float const m, float const r)
+{
+	reservoir.mWeightSum	+= weight;
+	reservoir.mM			+= m;
+	if (weight <= 0.0f || r * reservoir.mWeightSum >= weight) return false;
+	reservoir.mLightIdx		= lightIdx;
+	reservoir.mTargetPdf	= targetPdf;
+	return true;
+}
+
+bool combine(Reservoir& reservoir, Reservoir const& other, float const targetPdf, float const r)
+{
+	return update(reservoir, other.mLightIdx, targetPdf * other.mW * other.mM, targetPdf, other.mM, r);
+}
+
+void finalize(Reservoir& reservoir)
+{
+	float const denom	= reservoir.mM * reservoir.mTargetPdf;
+	reservoir.mW		= denom > 0.0f ? reservoir.mWeightSum / denom : 0.0f;
+}
+
+bool isSimilar(Reservoir const& neighbour, Reservoir const& center)
+{
+	// reject neighbours on other surfaces, by normal and by distance to the tangent plane:
+	if (neighbour.mT <= 0.0f) return false;
+	if (dot(neighbour.mNormal, center.mNormal) < 0.9f) return false;
+	return fabsf(dot(neighbour.mPoint - center.mPoint, center.mNormal)) < 0.05f * center.mT;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "light_tree.h"
+
+class BVHScene;
+
+int constexpr	INIT_RESTIR_CANDIDATES		= 32;
+int constexpr	INIT_RESTIR_SPATIAL_SAMPLES = 5;
+float constexpr INIT_RESTIR_SPATIAL_RADIUS	= 30.0f;	// in pixels
+float constexpr INIT_RESTIR_HISTORY_CLAMP	= 20.0f;	// previous frame counts at most this many times the current one
+bool constexpr	INIT_RESTIR_TEMPORAL_ACTIVE	= true;
+bool constexpr	INIT_RESTIR_SPATIAL_ACTIVE	= true;
+bool constexpr	INIT_RESTIR_VISIBILITY_ACTIVE = true;
+
+// weighted reservoir holding one light sample for the primary hit of a pixel
+struct Reservoir
+{
+	float3	mPoint		= 0.0f;		// primary hit the reservoir was built for
+	int		mLightIdx	= -1;		// index into LightTree::mLights
+	float3	mNormal		= 0.0f;		// zero when the pixel missed
+	float	mT			= 0.0f;		// primary hit distance
+	float	mWeightSum	= 0.0f;
+	float	mTargetPdf	= 0.0f;		// target pdf of the chosen light at mPoint
+	float	mW			= 0.0f;		// contribution weight of the chosen light
+	float	mM			= 0.0f;		// number of candidates seen
+};
+
+// spatiotemporal reservoir resampling for point lights and spotlights
+class Restir
+{
+public:
+	std::vector<Reservoir>	mCurrent;
+	std::vector<Reservoir>	mPrevious;
+	std::vector<Reservoir>	mSpatial;
+	int						mWidth				= 0;
+	int						mHeight				= 0;
+	int						mCandidates			= INIT_RESTIR_CANDIDATES;
+	int						mSpatialSamples		= INIT_RESTIR_SPATIAL_SAMPLES;
+	float					mSpatialRadius		= INIT_RESTIR_SPATIAL_RADIUS;
+	float					mHistoryClamp		= INIT_RESTIR_HISTORY_CLAMP;
+	bool					mTemporalEnabled	= INIT_RESTIR_TEMPORAL_ACTIVE;
+	bool					mSpatialEnabled		= INIT_RESTIR_SPATIAL_ACTIVE;
+	bool					mVisibilityEnabled	= INIT_RESTIR_VISIBILITY_ACTIVE;
+	bool					mHistoryValid		= false;
+
+public:
+	void						Init(int const width, int const height);
+	void						Invalidate();
+	void						GenerateCandidates(LightTree const& tree, BVHScene const& scene, tinybvh::Ray const& ray, int const pixelIdx);
+	void						TemporalReuse(LightTree const& tree, Frustum const& prevFrustum, int const pixelIdx);
+	void						SpatialReuse(LightTree const& tree, int const x, int const y);
+	[[nodiscard]] color			Shade(LightTree const& tree, BVHScene const& scene, Reservoir const& reservoir, tinybvh::Ray const& ray) const;
+	void						EndFrame();
+
+	[[nodiscard]] inline Reservoir const& GetFinal(int const pixelIdx) const { return mSpatialEnabled ? mSpatial[pixelIdx] : mCurrent[pixelIdx]; }
+};
+
+[[nodiscard]] float	targetPdf(LightTree const& tree, int const lightIdx, float3 const point, float3 const normal);
+bool				update(Reservoir& reservoir, int const lightIdx, float const weight, float const targetPdf, float const m, float const r);
+bool				combine(Reservoir& reservoir, Reservoir const& other, float const targetPdf, float const r);
+void				finalize(Reservoir& reservoir);
+[[nodiscard]] bool	isSimilar(Reservoir const& neighbour, Reservoir const& center);
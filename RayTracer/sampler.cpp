@@ -0,0 +1,174 @@
+#include "precomp.h"
+#include "sampler.h"
+
+static thread_local samplerState state;
+
+static uint32_t hashUInt(uint32_t x)
+{
+	// lowbias32 by chris wellons:
+	x ^= x >> 16; x *= 0x7feb352du;
+	x ^= x >> 15; x *= 0x846ca68bu;
+	return x ^ (x >> 16);
+}
+
+static uint32_t reverseBits(uint32_t x)
+{
+	x = (x << 16) | (x >> 16);
+	x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+	x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+	x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+	return ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+}
+
+static uint32_t nestedUniformScramble(uint32_t x, uint32_t const seed)
+{
+	// hash-based owen scrambling after burley, laine-karras on the reversed bits:
+	x = reverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverseBits(x);
+}
+
+static uint32_t sobolSecond(uint32_t index)
+{
+	// second sobol dimension, the first one is the bit-reversed index:
+	uint32_t result = 0;
+	for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1) if (index & 1) result ^= v;
+	return result;
+}
+
+static float toFloat(uint32_t const x)
+{
+	return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static float2 sobol(uint32_t const pixel, uint32_t const index, uint32_t const dimension)
+{
+	// every dimension pair gets its own shuffle of the index, so the pairs do not correlate:
+	uint32_t const seed		= hashUInt(pixel ^ hashUInt(dimension + 0x9e3779b9u));
+	uint32_t const shuffled	= nestedUniformScramble(index, seed);
+	uint32_t const x		= nestedUniformScramble(reverseBits(shuffled), hashUInt(seed));
+	uint32_t const y		= nestedUniformScramble(sobolSecond(shuffled), hashUInt(seed + 1));
+	return float2(toFloat(x), toFloat(y));
+}
+
+static float2 rank1(uint32_t const pixel, uint32_t const index, uint32_t const dimension)
+{
+	// every dimension reads the blue noise tile at its own offset instead of reusing the three channels:
+	Texture<float3> const& noise	= BlueNoise::GetInstance().mTexture;
+	uint32_t const offset			= hashUInt(dimension);
+	uint32_t const x				= (pixel % SCRWIDTH + (offset & 0xffff)) & (noise.mWidth - 1);
+	uint32_t const y				= (pixel / SCRWIDTH + (offset >> 16)) & (noise.mHeight - 1);
+	float3 const rotation			= noise.mData[x + y * noise.mWidth];
+
+	// r2 sequence, the generalised golden ratio for two dimensions:
+	float constexpr a1 = 0.7548776662466927f;
+	float constexpr a2 = 0.5698402909980532f;
+	float const i = static_cast<float>(index);
+	return float2(fracf(rotation.x + a1 * i), fracf(rotation.y + a2 * i));
+}
+
+void Sampler::Begin(uint32_t const pixelIdx, uint32_t const sampleIdx)
+{
+	state.mPixel		= pixelIdx;
+	state.mIndex		= sampleIdx;
+	state.mDimension	= 0;
+	state.mActive		= true;
+}
+
+void Sampler::End()
+{
+	state.mActive = false;
+}
+
+void Sampler::Seek(uint32_t const dimension)
+{
+	state.mDimension = dimension;
+}
+
+samplerState Sampler::Suspend()
+{
+	return state;
+}
+
+void Sampler::Resume(samplerState const& saved)
+{
+	state = saved;
+}
+
+samplerState Sampler::Split(samplerState const& parent, uint32_t& next)
+{
+	// branches of a pixel take consecutive indices, so together they stay stratified,
+	// and the frame indices cannot reach them:
+	samplerState child	= parent;
+	child.mIndex		= SAMPLER_SPLIT_INDICES | (next++ & (SAMPLER_SPLIT_INDICES - 1));
+	return child;
+}
+
+float Sampler::Get1D()
+{
+	return Get2D().x;
+}
+
+float2 Sampler::Get2D()
+{
+	if (!state.mActive) return float2(RandomFloat(), RandomFloat());
+	uint32_t const dimension = state.mDimension++;
+	switch (sType)
+	{
+	case SAMPLER_TYPES_SOBOL:	return sobol(state.mPixel, state.mIndex, dimension);
+	case SAMPLER_TYPES_RANK1:	return rank1(state.mPixel, state.mIndex, dimension);
+	default:					return float2(RandomFloat(), RandomFloat());
+	}
+}
+
+float2 concentricDisk(float2 const& u)
+{
+	// shirley-chiu mapping, no rejection and low distortion:
+	float2 const o = u * 2.0f - 1.0f;
+	if (o.x == 0.0f && o.y == 0.0f) return float2(0.0f, 0.0f);
+	float r, theta;
+	if (fabsf(o.x) > fabsf(o.y))
+	{
+		r		= o.x;
+		theta	= PI * 0.25f * (o.y / o.x);
+	}
+	else
+	{
+		r		= o.y;
+		theta	= PI * 0.5f - PI * 0.25f * (o.x / o.y);
+	}
+	return float2(cosf(theta), sinf(theta)) * r;
+}
+
+static void orthonormalBasis(float3 const& n, float3& tangent, float3& bitangent)
+{
+	// branchless basis after duff et al.:
+	float const sign	= copysignf(1.0f, n.z);
+	float const a		= -1.0f / (sign + n.z);
+	float const b		= n.x * n.y * a;
+	tangent				= float3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	bitangent			= float3(b, sign + n.y * n.y * a, -n.y);
+}
+
+float3 cosineHemisphere(float3 const& normal, float2 const& u)
+{
+	float2 const d = concentricDisk(u);
+	float const z = sqrtf(max(0.0f, 1.0f - d.x * d.x - d.y * d.y));
+	float3 tangent, bitangent;
+	orthonormalBasis(normal, tangent, bitangent);
+	return normalize(tangent * d.x + bitangent * d.y + normal * z);
+}
+
+float3 uniformHemisphere(float3 const& normal, float2 const& u)
+{
+	float const z	= u.x;
+	float const r	= sqrtf(max(0.0f, 1.0f - z * z));
+	float const phi = TWOPI * u.y;
+	float3 tangent, bitangent;
+	orthonormalBasis(normal, tangent, bitangent);
+	return tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) + normal * z;
+}
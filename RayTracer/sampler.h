@@ -0,0 +1,49 @@
+#pragma once
+
+enum samplerTypes : uint8_t
+{
+	SAMPLER_TYPES_RANDOM,	// thread-local white noise, the old behaviour
+	SAMPLER_TYPES_SOBOL,	// owen-scrambled sobol pairs, decorrelated per pixel and dimension
+	SAMPLER_TYPES_RANK1,	// r2 rank-1 sequence, rotated per pixel by the blue noise texture
+	SAMPLER_TYPES_COUNT
+};
+
+int constexpr INIT_SAMPLER_TYPE			= SAMPLER_TYPES_SOBOL;
+uint32_t constexpr SAMPLER_SPLIT_INDICES = 1u << 31;	// branches of split paths index the upper half, frames the lower one
+int constexpr SAMPLER_CAMERA_DIMENSIONS = 2;	// pixel jitter and lens, paths start after them whether aa and dof are on or not
+// passes outside the path seek to their own dimensions, far above the ones a path reaches:
+int constexpr SAMPLER_RESTIR_CANDIDATES	= 1024;	// one per candidate
+int constexpr SAMPLER_RESTIR_TEMPORAL	= 1536;
+int constexpr SAMPLER_RESTIR_SPATIAL	= 1600;	// one for the center, two per neighbour
+
+// position of a path in its sample sequence, kept by paths that interleave on one thread
+struct samplerState
+{
+	uint32_t	mPixel		= 0;
+	uint32_t	mIndex		= 0;	// sample index of the pixel, the accumulated frame
+	uint32_t	mDimension	= 0;	// next free dimension, every draw takes one
+	bool		mActive		= false;	// falls back to white noise when no sample was begun
+};
+
+// per-pixel, per-sample, per-dimension random numbers for the path tracer,
+// the current state is thread-local just like RandomFloat()
+class Sampler
+{
+public:
+	inline static int sType = INIT_SAMPLER_TYPE;
+
+public:
+	static void						Begin(uint32_t const pixelIdx, uint32_t const sampleIdx);
+	static void						End();
+	static void						Seek(uint32_t const dimension);
+	[[nodiscard]] static samplerState Suspend();
+	static void						Resume(samplerState const& saved);
+	// next, the running count of branches of the pixel, their indices never repeat however the split count changes
+	[[nodiscard]] static samplerState Split(samplerState const& parent, uint32_t& next);
+	[[nodiscard]] static float		Get1D();
+	[[nodiscard]] static float2		Get2D();
+};
+
+[[nodiscard]] float2	concentricDisk(float2 const& u);
+[[nodiscard]] float3	cosineHemisphere(float3 const& normal, float2 const& u);
+[[nodiscard]] float3	uniformHemisphere(float3 const& normal, float2 const& u);
@@ -10,9 +10,11 @@ Skydome::Skydome()
 Skydome::Skydome(char const* path) :
 	mTexture(loadTextureF(path)) 
 { 
+	PROFILE_SCOPE("Skydome distribution");
 	mTexture.mSampleMode	= TEXTURE_SAMPLE_MODES_LOOPED;
 	mTexture.mFilterMode	= TEXTURE_FILTER_MODES_LINEAR;  
 	//mTexture.mOwnData		= true;  
+	BuildDistribution(); 
 }
 
 color Skydome::Intensity(Intersection const& hit) const 
@@ -44,3 +46,78 @@ color Skydome::Sample(float3 const& direction) const
 	float2 const uv = calcSphereUv(direction);
 	return mTexture.Sample(uv);            
 }
+
+bool Skydome::SampleDirection(float const r0, float const r1, float3& direction, float& pdf) const
+{
+	if (mTotalWeight <= 0.0f) return false; 
+	int const width		= mTexture.mWidth; 
+	int const height	= mTexture.mHeight; 
+
+	// pick a row, then a texel within that row: 
+	int const y				= min(static_cast<int>(std::upper_bound(mMarginalCdf.begin(), mMarginalCdf.end(), r0) - mMarginalCdf.begin()), height - 1); 
+	float const* rowCdf		= mConditionalCdf.data() + y * width; 
+	int const x				= min(static_cast<int>(std::upper_bound(rowCdf, rowCdf + width, r1) - rowCdf), width - 1); 
+
+	// jitter inside the texel, reusing what is left of the random numbers: 
+	float const rowStart	= y > 0 ? mMarginalCdf[y - 1] : 0.0f; 
+	float const colStart	= x > 0 ? rowCdf[x - 1] : 0.0f; 
+	float const du			= clamp((r1 - colStart) / max(rowCdf[x] - colStart, 1e-12f), 0.0f, 1.0f); 
+	float const dv			= clamp((r0 - rowStart) / max(mMarginalCdf[y] - rowStart, 1e-12f), 0.0f, 1.0f); 
+	float const u			= (static_cast<float>(x) + du) / static_cast<float>(width); 
+	float const v			= (static_cast<float>(y) + dv) / static_cast<float>(height); 
+
+	// inverse of calcSphereUv: 
+	float const theta		= v * PI; 
+	float const phi			= u * TWOPI - PI; 
+	float const sinTheta	= sinf(theta); 
+	direction	= float3(sinTheta * cosf(phi), -cosf(theta), -sinTheta * sinf(phi)); 
+	pdf			= Pdf(direction); 
+	return pdf > 0.0f; 
+}
+
+float Skydome::Pdf(float3 const& direction) const
+{
+	if (mTotalWeight <= 0.0f) return 0.0f; 
+	float2 const uv			= calcSphereUv(direction); 
+	int const x				= min(static_cast<int>(uv.x * mTexture.mWidth), mTexture.mWidth - 1); 
+	int const y				= min(static_cast<int>(uv.y * mTexture.mHeight), mTexture.mHeight - 1); 
+	float const sinTheta	= sinf(uv.y * PI); 
+	if (sinTheta <= 0.0f) return 0.0f; 
+
+	// texel probability to uv density, then to solid angle: 
+	float const pdfUv = TexelWeight(x, y) / mTotalWeight * static_cast<float>(mTexture.mWidth * mTexture.mHeight); 
+	return pdfUv / (2.0f * PI * PI * sinTheta); 
+}
+
+void Skydome::BuildDistribution()
+{
+	int const width		= mTexture.mWidth; 
+	int const height	= mTexture.mHeight; 
+	mMarginalCdf.assign(height, 0.0f); 
+	mConditionalCdf.assign(width * height, 0.0f); 
+	mTotalWeight = 0.0f; 
+	if (!mTexture.mData) return; 
+
+	for (int y = 0; y < height; y++)
+	{
+		float* rowCdf	= mConditionalCdf.data() + y * width; 
+		float rowSum	= 0.0f; 
+		for (int x = 0; x < width; x++)
+		{
+			rowSum		+= TexelWeight(x, y); 
+			rowCdf[x]	= rowSum; 
+		}
+		if (rowSum > 0.0f) for (int x = 0; x < width; x++) rowCdf[x] /= rowSum; 
+		mTotalWeight	+= rowSum; 
+		mMarginalCdf[y] = mTotalWeight; 
+	}
+	if (mTotalWeight > 0.0f) for (int y = 0; y < height; y++) mMarginalCdf[y] /= mTotalWeight; 
+}
+
+float Skydome::TexelWeight(int const x, int const y) const
+{
+	// luminance times the solid angle a texel of this row covers: 
+	color const c			= mTexture[x + y * mTexture.mWidth]; 
+	float const sinTheta	= sinf((static_cast<float>(y) + 0.5f) / static_cast<float>(mTexture.mHeight) * PI); 
+	return (0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z) * sinTheta; 
+}
@@ -8,7 +8,10 @@ class BVHScene;
 class Skydome
 {
 public:
-	Texture<color> mTexture;  
+	Texture<color>		mTexture;  
+	std::vector<float>	mMarginalCdf;		// per row, for importance sampling by luminance 
+	std::vector<float>	mConditionalCdf;	// per texel, normalized within its row 
+	float				mTotalWeight = 0.0f; 
 
 public:
 						Skydome(); 
@@ -17,5 +20,11 @@ public:
 	[[nodiscard]] color Intensity(Intersection const& hit, blueSeed const seed) const;
 	[[nodiscard]] color Intensity(BVHScene const& scene, tinybvh::Ray const& ray) const; 
 	[[nodiscard]] color Sample(float3 const& direction) const;
+	[[nodiscard]] bool	SampleDirection(float const r0, float const r1, float3& direction, float& pdf) const;
+	[[nodiscard]] float Pdf(float3 const& direction) const;	// solid angle pdf of SampleDirection()
+
+private:
+	void				BuildDistribution(); 
+	[[nodiscard]] float TexelWeight(int const x, int const y) const; 
 };
 
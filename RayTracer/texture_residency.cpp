@@ -0,0 +1,210 @@
+#include "precomp.h"
+#include "texture_residency.h"
+
+#include <filesystem>
+
+// paged textures register themselves, eviction walks them under the lock:
+static std::mutex					registry;
+static std::vector<PagedTexture*>	textures;
+
+PagedTexture::PagedTexture(int const width, int const height, size_t const texelSize, uint64_t const hash) :
+	mTexelSize(texelSize),
+	mTileBytes(texelSize * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE)
+{
+	// levels are halved and rounded up until a single tile holds one:
+	int w = width, h = height, firstTile = 0;
+	for (;;)
+	{
+		int const tilesX = (w + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+		int const tilesY = (h + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+		mLevels.push_back({ w, h, tilesX, tilesY, firstTile });
+		firstTile += tilesX * tilesY;
+		if (tilesX == 1 && tilesY == 1) break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+	mTileCount	= firstTile;
+	mTiles		= std::make_unique<textureTile[]>(mTileCount);
+
+	// named after the texels, so the file of an earlier run is found again:
+	char name[96];
+	snprintf(name, sizeof(name), "%016llx_%dx%d_%zu.tiles", static_cast<unsigned long long>(hash), width, height, texelSize);
+	mCachePath = std::string(TEXTURE_CACHE_DIRECTORY) + name;
+
+	// a file that was cut short is written again:
+	std::error_code error;
+	mCached = std::filesystem::file_size(mCachePath, error) == static_cast<uintmax_t>(mTileCount) * mTileBytes;
+	if (!mCached) std::filesystem::create_directories(TEXTURE_CACHE_DIRECTORY, error);
+	TextureResidency::Register(this);
+}
+
+PagedTexture::~PagedTexture()
+{
+	TextureResidency::Unregister(this);
+	Jobs::Wait(mLoads);
+	for (int i = 0; i < mTileCount; i++) FREE64(mTiles[i].mData.load(std::memory_order_relaxed));
+	TextureResidency::Resident(-static_cast<ptrdiff_t>(mResidentBytes.load()));
+}
+
+void PagedTexture::WriteLevel(int const level, void const* texels)
+{
+	textureLevel const& l	= mLevels[level];
+	uint8_t const* src		= static_cast<uint8_t const*>(texels);
+	std::ofstream file(mCachePath, std::ios::binary | (level == 0 ? std::ios::trunc : std::ios::app));
+	std::vector<uint8_t> tile(mTileBytes);
+	for (int ty = 0; ty < l.mTilesY; ty++) for (int tx = 0; tx < l.mTilesX; tx++)
+	{
+		// tiles on the border repeat the last texel, so every tile is read the same way:
+		for (int y = 0; y < TEXTURE_TILE_SIZE; y++) for (int x = 0; x < TEXTURE_TILE_SIZE; x++)
+		{
+			int const sx = min(tx * TEXTURE_TILE_SIZE + x, l.mWidth - 1);
+			int const sy = min(ty * TEXTURE_TILE_SIZE + y, l.mHeight - 1);
+			memcpy(tile.data() + (x + y * TEXTURE_TILE_SIZE) * mTexelSize, src + (sx + static_cast<size_t>(sy) * l.mWidth) * mTexelSize, mTexelSize);
+		}
+		file.write(reinterpret_cast<char const*>(tile.data()), mTileBytes);
+	}
+}
+
+void PagedTexture::Pin()
+{
+	int const last = mTileCount - 1;
+	// counted even over the budget, the fallback has to be there:
+	mTiles[last].mState.store(TEXTURE_TILE_STATES_LOADING, std::memory_order_relaxed);
+	TextureResidency::Resident(static_cast<ptrdiff_t>(mTileBytes));
+	Load(last);
+}
+
+void PagedTexture::Evict(int const tileIdx)
+{
+	// claimed first, a tile that is being loaded is left alone:
+	textureTile& tile	= mTiles[tileIdx];
+	uint8_t expected	= TEXTURE_TILE_STATES_RESIDENT;
+	if (!tile.mState.compare_exchange_strong(expected, TEXTURE_TILE_STATES_LOADING, std::memory_order_acq_rel)) return;
+	FREE64(tile.mData.exchange(nullptr, std::memory_order_acq_rel));
+	tile.mState.store(TEXTURE_TILE_STATES_ABSENT, std::memory_order_release);
+	mResidentBytes.fetch_sub(mTileBytes, std::memory_order_relaxed);
+	TextureResidency::Resident(-static_cast<ptrdiff_t>(mTileBytes));
+	TextureResidency::sEvictions.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PagedTexture::Request(int const tileIdx)
+{
+	// only the thread that flips the state sends the load, the others keep falling back meanwhile:
+	textureTile& tile = mTiles[tileIdx];
+	uint8_t expected = TEXTURE_TILE_STATES_ABSENT;
+	if (tile.mState.load(std::memory_order_relaxed) != expected) return;
+	if (!tile.mState.compare_exchange_strong(expected, TEXTURE_TILE_STATES_LOADING, std::memory_order_acq_rel)) return;
+	// a full budget serves the coarser level until the next eviction makes room:
+	if (!TextureResidency::Reserve(mTileBytes))
+	{
+		tile.mState.store(TEXTURE_TILE_STATES_ABSENT, std::memory_order_release);
+		return;
+	}
+	TextureResidency::sFaults.fetch_add(1, std::memory_order_relaxed);
+	TextureResidency::sFrameFaults.fetch_add(1, std::memory_order_relaxed);
+	// read by an idle worker, the frame keeps sampling the stand-in meanwhile:
+	Jobs::SubmitBackground([this, tileIdx]() { Load(tileIdx); }, &mLoads);
+}
+
+void PagedTexture::Load(int const tileIdx)
+{
+	PROFILE_SCOPE("PagedTexture::Load");
+	uint8_t* const data = static_cast<uint8_t*>(MALLOC64(mTileBytes));
+	std::ifstream file(mCachePath, std::ios::binary);
+	file.seekg(static_cast<std::streamoff>(tileIdx) * static_cast<std::streamoff>(mTileBytes));
+	file.read(reinterpret_cast<char*>(data), mTileBytes);
+	if (!file)
+	{
+		// stays resident as black rather than being asked for again on every sample:
+		printf("[TILE LOADING FAILED]\t%s\n", mCachePath.c_str());
+		memset(data, 0, mTileBytes);
+	}
+
+	textureTile& tile = mTiles[tileIdx];
+	tile.mLastUse.store(TextureResidency::Frame(), std::memory_order_relaxed);
+	tile.mData.store(data, std::memory_order_release);
+	tile.mState.store(TEXTURE_TILE_STATES_RESIDENT, std::memory_order_release);
+	mResidentBytes.fetch_add(mTileBytes, std::memory_order_relaxed);
+	TextureResidency::sLoads.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TextureResidency::EndFrame()
+{
+	PROFILE_SCOPE("TextureResidency::EndFrame");
+	sLastFrameFaults = sFrameFaults.exchange(0, std::memory_order_relaxed);
+	sFrame.fetch_add(1, std::memory_order_relaxed);
+	// loads stop at the budget, so eviction starts a little below it to leave room for the next frame,
+	// the tiles are only scanned then and scenes that fit pay nothing for it:
+	size_t const target = static_cast<size_t>(static_cast<double>(sBudget.load(std::memory_order_relaxed)) * TEXTURE_EVICT_TARGET);
+	if (sResident.load(std::memory_order_acquire) <= target) return;
+
+	struct candidate
+	{
+		uint32_t		mLastUse;
+		PagedTexture*	mTexture;
+		int				mTile;
+	};
+	std::lock_guard<std::mutex> lock(registry);
+	std::vector<candidate> candidates;
+	for (PagedTexture* const texture : textures) for (int i = 0; i < texture->mTileCount - 1; i++)
+	{
+		textureTile const& tile = texture->mTiles[i];
+		if (tile.mState.load(std::memory_order_acquire) != TEXTURE_TILE_STATES_RESIDENT) continue;
+		candidates.push_back({ tile.mLastUse.load(std::memory_order_relaxed), texture, i });
+	}
+	std::sort(candidates.begin(), candidates.end(), [](candidate const& a, candidate const& b) { return a.mLastUse < b.mLastUse; });
+
+	for (candidate const& c : candidates)
+	{
+		if (sResident.load(std::memory_order_relaxed) <= target) break;
+		c.mTexture->Evict(c.mTile);
+	}
+}
+
+textureResidencyStats TextureResidency::Stats()
+{
+	textureResidencyStats stats;
+	stats.mResidentBytes	= sResident.load(std::memory_order_relaxed);
+	stats.mPeakBytes		= sPeak.load(std::memory_order_relaxed);
+	stats.mBudget			= sBudget.load(std::memory_order_relaxed);
+	stats.mFaults			= sFaults.load(std::memory_order_relaxed);
+	stats.mFaultsLastFrame	= sLastFrameFaults;
+	stats.mLoads			= sLoads.load(std::memory_order_relaxed);
+	stats.mEvictions		= sEvictions.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock(registry);
+	stats.mTextures			= static_cast<int>(textures.size());
+	return stats;
+}
+
+void TextureResidency::Register(PagedTexture* const texture)
+{
+	std::lock_guard<std::mutex> lock(registry);
+	textures.push_back(texture);
+}
+
+void TextureResidency::Unregister(PagedTexture* const texture)
+{
+	std::lock_guard<std::mutex> lock(registry);
+	textures.erase(std::find(textures.begin(), textures.end(), texture));
+}
+
+bool TextureResidency::Reserve(size_t const bytes)
+{
+	// taken when the load is sent, so the loads in flight cannot overshoot the budget either:
+	size_t const now = sResident.fetch_add(bytes, std::memory_order_acq_rel) + bytes;
+	if (now > sBudget.load(std::memory_order_relaxed))
+	{
+		sResident.fetch_sub(bytes, std::memory_order_acq_rel);
+		return false;
+	}
+	size_t peak = sPeak.load(std::memory_order_relaxed);
+	while (now > peak && !sPeak.compare_exchange_weak(peak, now, std::memory_order_relaxed));
+	return true;
+}
+
+void TextureResidency::Resident(ptrdiff_t const bytes)
+{
+	size_t const now	= sResident.fetch_add(static_cast<size_t>(bytes), std::memory_order_acq_rel) + static_cast<size_t>(bytes);
+	size_t peak			= sPeak.load(std::memory_order_relaxed);
+	while (now > peak && !sPeak.compare_exchange_weak(peak, now, std::memory_order_relaxed));
+}
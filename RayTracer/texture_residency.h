@@ -0,0 +1,129 @@
+#pragma once
+
+#include "jobs.h"
+#include <memory>
+
+#define TEXTURE_CACHE_DIRECTORY	"../assets/cache/"
+
+int constexpr		TEXTURE_TILE_SIZE			= 64;					// texels along a side, a packed tile is 128 kB
+int constexpr		TEXTURE_PAGING_MIN_SIZE		= 1024;					// smaller textures stay resident as a whole
+float constexpr		TEXTURE_EVICT_TARGET		= 0.9f;					// part of the budget eviction goes down to, the rest is for the loads of the next frame
+bool constexpr		INIT_TEXTURE_PAGING			= true;
+size_t constexpr	INIT_TEXTURE_BUDGET			= size_t(2048) << 20;	// bytes of tiles, pinned ones included
+
+enum textureTileStates : uint8_t
+{
+	TEXTURE_TILE_STATES_ABSENT,
+	TEXTURE_TILE_STATES_LOADING,	// a job reads it from the cache
+	TEXTURE_TILE_STATES_RESIDENT
+};
+
+// one level of the mip chain, its tiles are stored in row order from mFirstTile on
+struct textureLevel
+{
+	int		mWidth;
+	int		mHeight;
+	int		mTilesX;
+	int		mTilesY;
+	int		mFirstTile;
+};
+
+struct textureTile
+{
+	std::atomic<uint8_t*>	mData		= nullptr;
+	std::atomic<uint32_t>	mLastUse	= 0;	// frame, for the lru order
+	std::atomic<uint8_t>	mState		= TEXTURE_TILE_STATES_ABSENT;
+};
+
+// statistics since the start, the faults also of the previous frame alone
+struct textureResidencyStats
+{
+	size_t		mResidentBytes		= 0;
+	size_t		mPeakBytes			= 0;
+	size_t		mBudget				= 0;
+	uint64_t	mFaults				= 0;	// tiles that were asked for while absent
+	uint32_t	mFaultsLastFrame	= 0;
+	uint64_t	mLoads				= 0;
+	uint64_t	mEvictions			= 0;
+	int			mTextures			= 0;
+};
+
+// mip chain of one texture in fixed size tiles, kept in a file of the disk cache and read back on first access,
+// the coarsest level is a single tile that always stays resident so there is always something to fall back to
+class PagedTexture
+{
+public:
+	std::vector<textureLevel>		mLevels;
+	std::unique_ptr<textureTile[]>	mTiles;
+	std::string						mCachePath;
+	size_t							mTexelSize;
+	size_t							mTileBytes;
+	int								mTileCount;
+	std::atomic<size_t>				mResidentBytes = 0;
+
+public:
+	PagedTexture(int const width, int const height, size_t const texelSize, uint64_t const hash);
+	~PagedTexture();
+	PagedTexture(PagedTexture const&)				= delete;
+	PagedTexture& operator=(PagedTexture const&)	= delete;
+
+	// texels of the tile, null while it is absent, only asking starts the load and only while the budget has room
+	[[nodiscard]] inline uint8_t const* Tile(int const tileIdx, bool const request);
+	[[nodiscard]] inline bool			Cached() const { return mCached; }
+	// starts the load of an absent tile, the same as asking for it through Tile
+	void								Request(int const tileIdx);
+	// appends a level to the cache file, levels in order, the texels in row order
+	void								WriteLevel(int const level, void const* texels);
+	// makes the coarsest level resident, after the cache file is complete
+	void								Pin();
+	void								Evict(int const tileIdx);
+
+private:
+	void								Load(int const tileIdx);
+
+	JobCounter						mLoads;
+	bool							mCached;	// the file is left from an earlier run
+};
+
+// keeps the tiles of all paged textures within the budget, the least recently used go first
+class TextureResidency
+{
+public:
+	inline static bool							sEnabled	= INIT_TEXTURE_PAGING;	// for textures loaded from now on
+	inline static std::atomic<size_t>			sBudget		= INIT_TEXTURE_BUDGET;
+
+	// evicts down to the budget, only between frames when no job samples
+	static void									EndFrame();
+	[[nodiscard]] static textureResidencyStats	Stats();
+	[[nodiscard]] static inline uint32_t		Frame() { return sFrame.load(std::memory_order_relaxed); }
+
+private:
+	friend class PagedTexture;
+	static void									Register(PagedTexture* const texture);
+	static void									Unregister(PagedTexture* const texture);
+	static void									Resident(ptrdiff_t const bytes);
+	[[nodiscard]] static bool					Reserve(size_t const bytes);	// false when it would not fit the budget
+
+	inline static std::atomic<uint32_t>			sFrame			= 1;
+	inline static std::atomic<size_t>			sResident		= 0;
+	inline static std::atomic<size_t>			sPeak			= 0;
+	inline static std::atomic<uint64_t>			sFaults			= 0;
+	inline static std::atomic<uint32_t>			sFrameFaults	= 0;
+	inline static std::atomic<uint64_t>			sLoads			= 0;
+	inline static std::atomic<uint64_t>			sEvictions		= 0;
+	inline static uint32_t						sLastFrameFaults = 0;
+};
+
+inline uint8_t const* PagedTexture::Tile(int const tileIdx, bool const request)
+{
+	textureTile& tile = mTiles[tileIdx];
+	if (uint8_t const* const data = tile.mData.load(std::memory_order_acquire))
+	{
+		// written only when it changes, so tiles read by every thread do not bounce between the caches:
+		uint32_t const frame = TextureResidency::Frame();
+		if (tile.mLastUse.load(std::memory_order_relaxed) != frame) tile.mLastUse.store(frame, std::memory_order_relaxed);
+		return data;
+	}
+	if (request) Request(tileIdx);
+	return nullptr;
+}
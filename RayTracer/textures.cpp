@@ -23,8 +23,7 @@ PackedTexture packTexture(AlbedoTexture const& albedo, NormalTexture const& norm
 	uint const size = packed.mWidth * packed.mHeight;
 	for (int i = 0; i < size; i++)
 	{
-		packed.mData[i].albedo = albedo.mData[i];
-		packed.mData[i].normal = normal.mData[i];
+		packed.mData[i] = { albedo.mData[i], normal.mData[i], 0.0f, 1.0f };
 	}
 	return packed;
 }
@@ -33,6 +32,7 @@ PackedTexture packTexture(AlbedoTexture const& albedo)
 {
 	PackedTexture packed = PackedTexture(albedo.mWidth, albedo.mHeight);
 	uint const size = packed.mWidth * packed.mHeight;
-	for (int i = 0; i < size; i++) packed.mData[i].albedo = albedo.mData[i];
+	// every field is written, so identical images pack to identical bytes:
+	for (int i = 0; i < size; i++) packed.mData[i] = { albedo.mData[i], float3(0.0f), 0.0f, 1.0f };
 	return packed;
 }
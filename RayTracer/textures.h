@@ -1,6 +1,7 @@
 #pragma once
 
 #include "color.h"
+#include "texture_residency.h"
 
 enum textureSampleModes : uint8_t
 {
@@ -21,20 +22,28 @@ template <typename T>
 class Texture
 {
 public:
-	T*			mData;
+	union
+	{
+	T*				mData;
+	PagedTexture*	mPages;		// with mPaged, tiles and mips owned by the texture store
+	};
 	int			mWidth;
 	int			mHeight;
 	float		mAspectRatio;  
-	bool		mOwnData;  
+	bool		mOwnData;	// allocated by this texture and freed with it, otherwise a view of texels owned elsewhere 
 	int8_t		mSampleMode; 
 	int8_t		mFilterMode;  
+	bool		mPaged;		// sampled through the residency manager, never owns its data
 
 public:
 					Texture();
-					Texture(Texture<T> const& other);
+					Texture(Texture<T> const& other);		// copies owned texels, a copy of a view is a view
+					Texture(Texture<T>&& other) noexcept; 
 					Texture(int const width, int const height);
-					Texture(T* data, int const width, int const height);
+					Texture(T* data, int const width, int const height);	// view, data stays owned by the caller
+					Texture(PagedTexture* pages, int const width, int const height);	// paged view
 					~Texture();
+	Texture<T>&		operator=(Texture<T> other) noexcept; 
 	[[nodiscard]] T Sample(float2 const uv) const;  
 	[[nodiscard]] T SampleNearest(float2 const uv) const; 
 	[[nodiscard]] T SampleLinear(float2 const uv) const;  
@@ -51,6 +60,8 @@ private:
 	[[nodiscard]] T SampleLinearUnsafe(float2 uv) const; 
 	[[nodiscard]] T SampleLinearLooped(float2 uv) const;  
 	[[nodiscard]] T SampleLinearClamped(float2 uv) const; 
+	[[nodiscard]] T SamplePaged(float2 uv) const; 
+	[[nodiscard]] T TexelPaged(int x, int y) const; 
 }; 
 
 template <typename T> 
@@ -58,6 +69,13 @@ static void swap(Texture<T>& a, Texture<T>& b) noexcept
 { 
 	// copilot helped with a custom swap
 	std::swap(a.mData, b.mData);  
+	std::swap(a.mWidth, b.mWidth); 
+	std::swap(a.mHeight, b.mHeight); 
+	std::swap(a.mAspectRatio, b.mAspectRatio); 
+	std::swap(a.mOwnData, b.mOwnData); 
+	std::swap(a.mSampleMode, b.mSampleMode); 
+	std::swap(a.mFilterMode, b.mFilterMode); 
+	std::swap(a.mPaged, b.mPaged); 
 }
 
 template <typename T>
@@ -68,19 +86,39 @@ Texture<T>::Texture() :
 	mAspectRatio(static_cast<float>(mWidth) / static_cast<float>(mHeight)), 
 	mOwnData(false), 
 	mSampleMode(TEXTURE_SAMPLE_MODES_NONE),  
-	mFilterMode(TEXTURE_FILTER_MODES_NONE) 
+	mFilterMode(TEXTURE_FILTER_MODES_NONE), 
+	mPaged(false) 
 {}
 
 template <typename T>
 Texture<T>::Texture(Texture<T> const& other) : 
-	mData(other.mData), 
+	mData(other.mOwnData ? static_cast<T*>(MALLOC64(sizeof(T) * other.mWidth * other.mHeight)) : other.mData), 
 	mWidth(other.mWidth),
 	mHeight(other.mHeight),
 	mAspectRatio(static_cast<float>(mWidth) / static_cast<float>(mHeight)), 
 	mOwnData(other.mOwnData),
 	mSampleMode(other.mSampleMode),
-	mFilterMode(other.mFilterMode)
-{}
+	mFilterMode(other.mFilterMode),
+	mPaged(other.mPaged)
+{
+	if (mOwnData && mData) memcpy(mData, other.mData, sizeof(T) * mWidth * mHeight); 
+}
+
+template <typename T>
+Texture<T>::Texture(Texture<T>&& other) noexcept : 
+	mData(other.mData), 
+	mWidth(other.mWidth),
+	mHeight(other.mHeight),
+	mAspectRatio(other.mAspectRatio), 
+	mOwnData(other.mOwnData),
+	mSampleMode(other.mSampleMode),
+	mFilterMode(other.mFilterMode),
+	mPaged(other.mPaged)
+{
+	other.mData		= nullptr; 
+	other.mOwnData	= false; 
+	other.mPaged	= false; 
+}
 
 template <typename T>
 Texture<T>::Texture(int const width, int const height) :
@@ -88,9 +126,10 @@ Texture<T>::Texture(int const width, int const height) :
 	mWidth(width),
 	mHeight(height),
 	mAspectRatio(static_cast<float>(mWidth) / static_cast<float>(mHeight)), 
-	mOwnData(false),
+	mOwnData(true),
 	mSampleMode(TEXTURE_SAMPLE_MODES_NONE), 
-	mFilterMode(TEXTURE_FILTER_MODES_NONE) 
+	mFilterMode(TEXTURE_FILTER_MODES_NONE), 
+	mPaged(false) 
 {}
 
 template <typename T>
@@ -101,18 +140,40 @@ Texture<T>::Texture(T* data, int const width, int const height) :
 	mAspectRatio(static_cast<float>(mWidth) / static_cast<float>(mHeight)),
 	mOwnData(false), 
 	mSampleMode(TEXTURE_SAMPLE_MODES_NONE),  
-	mFilterMode(TEXTURE_FILTER_MODES_NONE) 
+	mFilterMode(TEXTURE_FILTER_MODES_NONE), 
+	mPaged(false) 
+{}
+
+template <typename T>
+Texture<T>::Texture(PagedTexture* pages, int const width, int const height) :
+	mPages(pages),
+	mWidth(width),
+	mHeight(height),
+	mAspectRatio(static_cast<float>(mWidth) / static_cast<float>(mHeight)),
+	mOwnData(false), 
+	mSampleMode(TEXTURE_SAMPLE_MODES_NONE),  
+	mFilterMode(TEXTURE_FILTER_MODES_NONE), 
+	mPaged(true) 
 {}
 
 template <typename T> 
 Texture<T>::~Texture()  
 {
-	//if (mOwnData) FREE64(mData);
+	if (mOwnData) FREE64(mData);
+}
+
+template <typename T> 
+Texture<T>& Texture<T>::operator=(Texture<T> other) noexcept 
+{
+	// other took a copy or the moved texels, the old ones leave with it: 
+	swap(*this, other); 
+	return *this; 
 }
 
 template <typename T>
 inline T Texture<T>::Sample(float2 const uv) const   
 {
+	if (mPaged) return SamplePaged(uv); 
 	switch (mFilterMode) 
 	{
 	case TEXTURE_FILTER_MODES_NEAREST:	return SampleNearest(uv);	break;   
@@ -277,6 +338,58 @@ T Texture<T>::SampleLinearClamped(float2 uv) const
 	return c1 * w1 + c2 * w2 + c3 * w3 + c4 * w4;
 }  
  
+template <typename T>
+T Texture<T>::SamplePaged(float2 uv) const
+{
+	// addressed like the resident textures, unsafe sampling is clamped as well:
+	bool const looped	= mSampleMode == TEXTURE_SAMPLE_MODES_LOOPED; 
+	auto const address	= [looped](int const i, int const size) { return looped ? ((i % size) + size) % size : clamp(i, 0, size - 1); }; 
+	uv.u = uv.u * static_cast<float>(mWidth); 
+	uv.v = uv.v * static_cast<float>(mHeight); 
+	int const iu = static_cast<int>(uv.u); 
+	int const iv = static_cast<int>(uv.v); 
+	if (mFilterMode != TEXTURE_FILTER_MODES_LINEAR) return TexelPaged(address(iu, mWidth), address(iv, mHeight)); 
+
+	// calculate weight factors:
+	float2 const	frac = fracf(uv); 
+	float const		w1 = (1.0f - frac.u) * (1.0f - frac.v);
+	float const		w2 = frac.u * (1.0f - frac.v);
+	float const		w3 = (1.0f - frac.u) * frac.v;
+	float const		w4 = frac.u * frac.v;
+
+	// fetch four texels: 
+	int const u1 = address(iu, mWidth); 
+	int const v1 = address(iv, mHeight); 
+	int const u2 = address(iu + 1, mWidth); 
+	int const v2 = address(iv + 1, mHeight); 
+	T const c1 = TexelPaged(u1, v1); 
+	T const c2 = TexelPaged(u2, v1); 
+	T const c3 = TexelPaged(u1, v2); 
+	T const c4 = TexelPaged(u2, v2); 
+
+	// blend:
+	return c1 * w1 + c2 * w2 + c3 * w3 + c4 * w4;
+}
+
+template <typename T>
+T Texture<T>::TexelPaged(int x, int y) const
+{
+	// a tile that is not resident yet is stood in for by the next coarser level that is, the last level always is,
+	// the finest tile is asked for and so is the one just finer than the stand-in, so the chain fills in from the coarse end:
+	int finer = -1; 
+	for (int level = 0;; level++, x >>= 1, y >>= 1)
+	{
+		textureLevel const& l	= mPages->mLevels[level]; 
+		int const tileIdx		= l.mFirstTile + (y / TEXTURE_TILE_SIZE) * l.mTilesX + x / TEXTURE_TILE_SIZE; 
+		if (uint8_t const* const tile = mPages->Tile(tileIdx, level == 0))
+		{
+			if (level > 1) mPages->Request(finer); 
+			return reinterpret_cast<T const*>(tile)[(x % TEXTURE_TILE_SIZE) + (y % TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE]; 
+		}
+		finer = tileIdx; 
+	}
+}
+ 
 template <typename T>
 void Texture<T>::Clear()
 {
@@ -330,6 +443,67 @@ using NormalTexture		= Texture<float3>;
 using RoughnessTexture	= Texture<float>; 
 using PackedTexture		= Texture<PackedTexel>;
 
+// moves the mip chain of texture to the disk cache, only the coarsest level stays in memory,
+// a file an earlier run left for the same texels is used as it is
+template <typename T>
+std::unique_ptr<PagedTexture> pageTexture(Texture<T> const& texture, uint64_t const hash)
+{
+	std::unique_ptr<PagedTexture> pages = std::make_unique<PagedTexture>(texture.mWidth, texture.mHeight, sizeof(T), hash); 
+	if (!pages->Cached())
+	{
+		// box filtered, a level rounded up keeps a parent for every texel: 
+		Texture<T>	mip; 
+		T const*	texels = texture.mData; 
+		for (int level = 0; level < static_cast<int>(pages->mLevels.size()); level++)
+		{
+			if (level > 0)
+			{
+				textureLevel const& parent	= pages->mLevels[level - 1]; 
+				textureLevel const& child	= pages->mLevels[level]; 
+				Texture<T> next(child.mWidth, child.mHeight); 
+				for (int y = 0; y < child.mHeight; y++) for (int x = 0; x < child.mWidth; x++)
+				{
+					int const x0 = x * 2, x1 = min(x * 2 + 1, parent.mWidth - 1); 
+					int const y0 = y * 2, y1 = min(y * 2 + 1, parent.mHeight - 1); 
+					next.mData[x + y * child.mWidth] = (texels[x0 + y0 * parent.mWidth] + texels[x1 + y0 * parent.mWidth] + 
+						texels[x0 + y1 * parent.mWidth] + texels[x1 + y1 * parent.mWidth]) * 0.25f; 
+				}
+				mip		= std::move(next); 
+				texels	= mip.mData; 
+			}
+			pages->WriteLevel(level, texels); 
+		}
+	}
+	pages->Pin(); 
+	return pages; 
+}
+
+// how the file is decoded, part of the key of the texture store
+enum textureFormats : uint8_t
+{
+	TEXTURE_FORMATS_FLOAT,	// loadTextureF, hdr and linearized ldr
+	TEXTURE_FORMATS_BYTE	// loadTextureI, ldr as stored
+};
+
+// counted reference to a texture of the ResourceManager, the texels are freed when the last handle goes
+class TextureHandle
+{
+public:
+							TextureHandle() = default; 
+							TextureHandle(TextureHandle const& other); 
+							TextureHandle(TextureHandle&& other) noexcept; 
+							~TextureHandle(); 
+	TextureHandle&			operator=(TextureHandle other) noexcept; 
+	[[nodiscard]] PackedTexture	View() const;	// non-owning, valid as long as this handle lives 
+	[[nodiscard]] inline bool	Valid() const { return mEntry >= 0; }
+	[[nodiscard]] size_t		Bytes() const; 
+
+private:
+	friend class ResourceManager; 
+	explicit				TextureHandle(int const entry) : mEntry(entry) {}
+	int						mEntry = -1; 
+};
+
 PackedTexture packTexture(AlbedoTexture const& albedo, NormalTexture const& normal, RoughnessTexture roughness, Texture<float> const& alpha);
 PackedTexture packTexture(AlbedoTexture const& albedo, NormalTexture const& normal);
 PackedTexture packTexture(AlbedoTexture const& albedo);
\ No newline at end of file
@@ -7,6 +7,28 @@ Ui::Ui() :
 	mRenderer(nullptr)
 {}
 
+static uint64_t toggledLight(bool const enabled, int const light)
+{
+	// a light that turns on can reach any pixel, one that turns off only the pixels it lit: 
+	return enabled ? DEPENDENCY_ALL : PixelDependencies::LightBit(light); 
+}
+
+static uint64_t editedLight(color const& colorBefore, float const strengthBefore, int const light)
+{
+	// a light that was black or had no strength lit nothing, so no pixel recorded it, raising it can reach any of them: 
+	bool const wasDark = strengthBefore <= 0.0f || colorBefore.x + colorBefore.y + colorBefore.z <= 0.0f; 
+	return wasDark ? DEPENDENCY_ALL : PixelDependencies::LightBit(light); 
+}
+
+static uint64_t editedMaterial(uint32_t const instIdx, float const emissivityBefore, float const emissivityAfter)
+{
+	// a new emitter can light any pixel, an existing one only the pixels that sampled emissives: 
+	if (emissivityAfter > 0.0f && emissivityBefore <= 0.0f) return DEPENDENCY_ALL; 
+	uint64_t changed = PixelDependencies::InstanceBit(instIdx); 
+	if (emissivityBefore > 0.0f) changed |= PixelDependencies::LightBit(DEPENDENCY_LIGHTS_EMISSIVES); 
+	return changed; 
+}
+
 void Ui::General() const
 {
 	ImGuiStyle* style = &ImGui::GetStyle();
@@ -18,7 +40,8 @@ void Ui::General() const
 
 	ImGui::Text("Performance report"); 
 	ImGui::Text("%5.2fms (%.1ffps) - %.1fMrays/s\n", mRenderer->GetAvg(), mRenderer->GetFps(), mRenderer->GetRps() / 1000);
-	ImGui::Text("OpenMP thread count: %d", omp_get_num_threads());
+	ImGui::Text("Job threads: %d", Jobs::ThreadCount());
+	ImGui::Text("Avg path length: %.2f (%.1f%% roulette)", mRenderer->mAvgPathLength, mRenderer->mRouletteRate * 100.0f);
 
 	Settings& settings = mRenderer->GetSettings(); 
 
@@ -32,6 +55,7 @@ void Ui::General() const
 		if (ImGui::BeginTabItem("Lights"))			{ LightsUi();		ImGui::EndTabItem(); }
 		if (ImGui::BeginTabItem("Debug"))			{ DebugUi();		ImGui::EndTabItem(); }
 		if (ImGui::BeginTabItem("Movie"))			{ MovieUi(); ImGui::EndTabItem(); }
+		if (ImGui::BeginTabItem("Memory"))			{ MemoryUi();		ImGui::EndTabItem(); }
 	}
 
 	ImGui::End(); 
@@ -94,19 +118,45 @@ void Ui::SettingsUi() const
 	if (ImGui::Combo("Converge mode", &settings.mConvergeMode, STR_CONVERGE_MODES)) mRenderer->ResetAccumulator();   
 	if (ImGui::Combo("Render mode", &settings.mRenderMode, STR_RENDER_MODES))		mRenderer->ResetAccumulator();  
 	if (ImGui::SliderInt("Max bounces", &settings.mMaxBounces, 1, 10))				mRenderer->ResetAccumulator(); 
+	if (ImGui::Combo("MIS heuristic", &settings.mMisHeuristic, STR_MIS_HEURISTICS))	mRenderer->ResetAccumulator(); 
+	if (ImGui::Combo("Sampler", &Sampler::sType, STR_SAMPLER_TYPES))				mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Russian roulette", &settings.mRouletteEnabled))			mRenderer->ResetAccumulator(); 
+	if (ImGui::SliderInt("Roulette min depth", &settings.mRouletteMinDepth, 1, 10))	mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Path splitting", &settings.mSplittingEnabled))				mRenderer->ResetAccumulator(); 
+	if (ImGui::SliderInt("Split factor", &settings.mSplitFactor, 2, MAX_SPLIT_FACTOR)) mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Primary splitting", &settings.mPrimarySplittingEnabled))	mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Adaptive primary splits", &settings.mPrimarySplitsAdaptive)) mRenderer->ResetAccumulator(); 
+	if (settings.mPrimarySplitsAdaptive)
+	{
+		ImGui::Text("Primary splits: %d (%.2f)", mRenderer->mPrimarySplits, mRenderer->mPrimarySplitEstimate); 
+		ImGui::DragFloat("Split variance ratio", &settings.mSplitVarianceRatio, 0.1f, 0.1f, 100.0f); 
+	}
+	else if (ImGui::SliderInt("Primary splits", &mRenderer->mPrimarySplits, 1, MAX_SPLIT_FACTOR)) mRenderer->ResetAccumulator(); 
 	ImGui::Separator(); 
 	if (ImGui::Checkbox("Anti-aliasing", &settings.mAaEnabled))						mRenderer->ResetAccumulator(); 
 	if (ImGui::Checkbox("Depth of field", &settings.mDofEnabled))					mRenderer->ResetAccumulator(); 
 	if (ImGui::Checkbox("Auto-focus", &settings.mAutoFocusEnabled))					mRenderer->ResetAccumulator(); 
 	if (ImGui::Checkbox("Blue noise", &settings.mBlueNoiseEnabled))					mRenderer->ResetAccumulator(); 
 	if (ImGui::Checkbox("Stochastic lights", &settings.mStochasticLights))			mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Material-sorted shading", &settings.mBatchedShadingEnabled)) mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Packet tracing", &settings.mPacketTracingEnabled))			mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Analytic shapes", &settings.mAnalyticShapesEnabled))		{ mRenderer->mBVHScene.SetAnalyticVisible(settings.mAnalyticShapesEnabled); mRenderer->ResetAccumulator(); }
+	if (ImGui::Checkbox("Primary hit cache", &settings.mPrimaryCacheEnabled))		mRenderer->ResetAccumulator(); 
+	if (settings.mPrimaryCacheEnabled) ImGui::Text("Primary hits reused: %.1f%%", mRenderer->mPrimaryReuseRate * 100.0f); 
+	if (ImGui::Checkbox("Selective reset", &settings.mSelectiveResetEnabled))		mRenderer->ResetAccumulator(); 
+	if (ImGui::Checkbox("Path guiding", &settings.mGuidingEnabled))					{ mRenderer->ResetGuide(); mRenderer->ResetAccumulator(); }
+	if (ImGui::Checkbox("ReSTIR", &settings.mRestirEnabled))						{ mRenderer->mRestir.Invalidate(); mRenderer->ResetAccumulator(); }
+	if (ImGui::Checkbox("Radiance cache", &settings.mRadianceCacheEnabled))			{ mRenderer->mRadianceCache.Clear(); mRenderer->ResetAccumulator(); }
+	int lightKernel = mRenderer->mLightBuffer.mKernel; 
+	if (ImGui::Combo("Light kernel", &lightKernel, STR_LIGHT_KERNELS))				mRenderer->mLightBuffer.SetKernel(lightKernel); 
 	ImGui::Separator();   
-	if (ImGui::Checkbox("Point lights", &settings.mPointLightsEnabled))				mRenderer->ResetAccumulator(); 
-	if (ImGui::Checkbox("Spotlights", &settings.mSpotlightsEnabled))				mRenderer->ResetAccumulator();
-	if (ImGui::Checkbox("Directional light", &settings.mDirLightEnabled))			mRenderer->ResetAccumulator(); 
-	if (ImGui::Checkbox("Quad light", &settings.mQuadLightEnabled))					mRenderer->ResetAccumulator();
-	if (ImGui::Checkbox("Textured spotlight", &settings.mTexturedSpotlightEnabled)) mRenderer->ResetAccumulator(); 
-	if (ImGui::Checkbox("Skydome illumination", &settings.mSkydomeEnabled))			mRenderer->ResetAccumulator();
+	if (ImGui::Checkbox("Point lights", &settings.mPointLightsEnabled))				mRenderer->RebuildLights(toggledLight(settings.mPointLightsEnabled, DEPENDENCY_LIGHTS_POINT)); 
+	if (ImGui::Checkbox("Spotlights", &settings.mSpotlightsEnabled))				mRenderer->RebuildLights(toggledLight(settings.mSpotlightsEnabled, DEPENDENCY_LIGHTS_SPOT));
+	if (ImGui::Checkbox("Directional light", &settings.mDirLightEnabled))			mRenderer->RebuildLights(toggledLight(settings.mDirLightEnabled, DEPENDENCY_LIGHTS_DIR)); 
+	if (ImGui::Checkbox("Quad light", &settings.mQuadLightEnabled))					mRenderer->RebuildLights();
+	if (ImGui::Checkbox("Textured spotlight", &settings.mTexturedSpotlightEnabled)) mRenderer->RebuildLights(toggledLight(settings.mTexturedSpotlightEnabled, DEPENDENCY_LIGHTS_TEXTURED_SPOT)); 
+	if (ImGui::Checkbox("Skydome illumination", &settings.mSkydomeEnabled))			mRenderer->RebuildLights(); // also the background of every miss 
+	if (ImGui::Checkbox("Emissive triangles", &settings.mEmissivesEnabled))			mRenderer->RebuildLights(toggledLight(settings.mEmissivesEnabled, DEPENDENCY_LIGHTS_EMISSIVES));
 	ImGui::Separator(); 
 	if (ImGui::CollapsingHeader("Skydome"))  
 	{
@@ -121,6 +171,94 @@ void Ui::SettingsUi() const
 		TextureUi(mRenderer->mHistory);  
 		ImGui::DragFloat("History Weight", &mRenderer->mHistoryWeight, 0.01f, 0.0f, 1.0f); 
 	}
+	if (ImGui::CollapsingHeader("Path guiding"))
+	{
+		PathGuide& guide = mRenderer->mGuide; 
+		ImGui::Text("Iteration: %d (%s)", guide.mIteration, guide.IsTraining() ? "training" : "rendering"); 
+		ImGui::Text("Spatial nodes: %d", static_cast<int>(guide.mSpatialNodes.size())); 
+		ImGui::Text("Directional trees: %d", static_cast<int>(guide.mDTrees.size())); 
+		if (ImGui::SliderFloat("BSDF fraction", &guide.mBsdfFraction, 0.05f, 1.0f))		mRenderer->ResetAccumulator(); 
+		ImGui::SliderInt("Training iterations", &guide.mTrainingIterations, 0, 16); 
+		if (ImGui::Button("Reset guiding"))												{ mRenderer->ResetGuide(); mRenderer->ResetAccumulator(); }
+	}
+	if (ImGui::CollapsingHeader("Radiance cache"))
+	{
+		RadianceCache& cache = mRenderer->mRadianceCache; 
+		ImGui::Text("Cells: %u / %d", cache.mUsedCells.load(), static_cast<int>(cache.mCells.size())); 
+		ImGui::Text("Hit rate: %.1f%%", cache.mHitRate * 100.0f); 
+		if (ImGui::SliderInt("Terminate bounce", &cache.mTerminateBounce, 1, 10))		mRenderer->ResetAccumulator(); 
+		if (ImGui::SliderInt("Min samples", &cache.mMinSamples, 1, 256))				mRenderer->ResetAccumulator(); 
+		if (ImGui::SliderFloat("Max error", &cache.mMaxError, 0.01f, 1.0f))				mRenderer->ResetAccumulator(); 
+		if (ImGui::SliderFloat("Training fraction", &cache.mTrainFraction, 0.0f, 1.0f))	mRenderer->ResetAccumulator(); 
+		if (ImGui::DragFloat("Cell size", &cache.mCellSize, 0.005f, 0.005f, 1.0f))		{ cache.Clear(); mRenderer->ResetAccumulator(); }
+		if (ImGui::DragFloat("Level distance", &cache.mLevelDist, 0.1f, 0.1f, 100.0f))	{ cache.Clear(); mRenderer->ResetAccumulator(); }
+		if (ImGui::Button("Clear cache"))												{ cache.Clear(); mRenderer->ResetAccumulator(); }
+	}
+	if (ImGui::CollapsingHeader("ReSTIR"))
+	{
+		Restir& restir = mRenderer->mRestir; 
+		if (ImGui::SliderInt("Candidates", &restir.mCandidates, 1, 64))					mRenderer->ResetAccumulator(); 
+		if (ImGui::Checkbox("Temporal reuse", &restir.mTemporalEnabled))				mRenderer->ResetAccumulator(); 
+		if (ImGui::Checkbox("Spatial reuse", &restir.mSpatialEnabled))					{ restir.Invalidate(); mRenderer->ResetAccumulator(); }
+		if (ImGui::Checkbox("Visibility reuse", &restir.mVisibilityEnabled))			mRenderer->ResetAccumulator(); 
+		if (ImGui::SliderInt("Spatial samples", &restir.mSpatialSamples, 0, 16))		mRenderer->ResetAccumulator(); 
+		if (ImGui::DragFloat("Spatial radius", &restir.mSpatialRadius, 0.5f, 1.0f, 100.0f)) mRenderer->ResetAccumulator(); 
+		if (ImGui::DragFloat("History clamp", &restir.mHistoryClamp, 0.5f, 1.0f, 100.0f))	mRenderer->ResetAccumulator(); 
+	}
+	if (ImGui::CollapsingHeader("Traversal cost"))
+	{
+		ImGui::Combo("Metric", &settings.mCostMetric, STR_COST_METRICS); 
+		ImGui::SliderInt("Bounce", &settings.mCostBounce, 0, settings.mMaxBounces - 1); 
+		ImGui::DragFloat("Scale max", &settings.mCostMax, 1.0f, 1.0f, 100000.0f); 
+		ImGui::Checkbox("Log scale", &settings.mCostLogScale); 
+		if (ImGui::Button("Export counts")) mRenderer->ExportTraversalCost(TRAVERSAL_COST_FILE_PATH); 
+
+		// averages per ray, the aggregate view over all bounces of the frame: 
+		ImGui::Text("Bounce   Rays      Nodes    Tris   Insts"); 
+		for (int bounce = 0; bounce < settings.mMaxBounces; bounce++)
+		{
+			bounceCost const& sum = mRenderer->mBounceCosts[bounce]; 
+			if (sum.mRays == 0) continue; 
+			double const rays = static_cast<double>(sum.mRays); 
+			ImGui::Text("%6d %6llu %10.1f %7.1f %7.2f", bounce, sum.mRays, sum.mNodes / rays, sum.mTris / rays, sum.mInstances / rays); 
+		}
+	}
+	if (ImGui::CollapsingHeader("Torus"))
+	{
+		// toggling the bounds test or the simd solver gives the before and after of the same view: 
+		ImGui::Checkbox("Bounds test", &Torus::sBoundsTest); 
+		ImGui::Checkbox("SIMD solver", &Torus::sSimdSolver); 
+		ImGui::Checkbox("Validate", &Torus::sValidate); 
+		ImGui::Checkbox("Collect stats", &Torus::sCollectStats); 
+
+		torusReport const& report = mRenderer->mTorusReport; 
+		ImGui::Text("Tests: %llu", report.mTests); 
+		ImGui::Text("Culled: %.1f%%", report.mCulledRate * 100.0f); 
+		ImGui::Text("Double fallback: %.2f%%", report.mRetryRate * 100.0f); 
+		ImGui::Text("Cycles per test: %.0f", report.mCyclesPerTest); 
+		ImGui::Text("Validated: %llu, mismatches: %llu", report.mValidated, report.mMismatches); 
+		ImGui::Text("Max relative error: %.2e", report.mMaxError); 
+	}
+	if (ImGui::CollapsingHeader("Profiler"))
+	{
+		// the scopes only check this flag, recording stays off unless a trace is wanted: 
+		bool enabled = Profiler::sEnabled.load(std::memory_order_relaxed); 
+		if (ImGui::Checkbox("Record frames", &enabled)) Profiler::sEnabled.store(enabled, std::memory_order_relaxed); 
+		ImGui::SliderInt("Frames", &Profiler::sDumpFrames, 1, PROFILER_MAX_DUMP_FRAMES); 
+		if (ImGui::Button("Dump frames")) (void)Profiler::Dump(PROFILER_FRAMES_FILE_PATH, Profiler::sDumpFrames); 
+		ImGui::SameLine(); 
+		if (ImGui::Button("Dump startup")) (void)Profiler::DumpStartup(PROFILER_STARTUP_FILE_PATH); 
+		ImGui::Text("Startup events: %zu", Profiler::StartupEventCount()); 
+	}
+	if (ImGui::CollapsingHeader("Frame memory"))
+	{
+		frameArenaStats const stats = FrameArena::Stats(); 
+		ImGui::Text("Arenas: %d", stats.mArenas); 
+		ImGui::Text("Capacity: %.2f MB", static_cast<float>(stats.mCapacity) / (1024.0f * 1024.0f)); 
+		ImGui::Text("Peak: %.2f MB", static_cast<float>(stats.mPeak) / (1024.0f * 1024.0f)); 
+		ImGui::Text("Allocations: %u", stats.mAllocs); 
+		ImGui::Text("Heap allocations: %u", stats.mHeapAllocs); 
+	}
 }
 
 void Ui::CameraUi() const
@@ -175,7 +313,10 @@ void Ui::LightsUi() const
 		case 2: mRenderer->mSpotLights.emplace_back(); break; 
 		default: break;  
 		}
+		mRenderer->RebuildLights(); 
 	}
+	ImGui::Text("Light tree nodes: %d", static_cast<int>(mRenderer->mLightTree.mNodes.size())); 
+	if (ImGui::Button("Benchmark light kernels")) benchmarkLightKernels(); 
 
 	ImGui::Separator(); 
 
@@ -188,14 +329,36 @@ void Ui::LightsUi() const
 			{
 				PointLight& l = mRenderer->mPointLights[i];  
 				std::string strLightIdx = "##" + std::to_string(i); 
-				if (ImGui::DragFloat3(("Position" + strLightIdx).c_str(), l.mPosition.cell, 0.005f))	mRenderer->ResetAccumulator(); 
-				if (ImGui::ColorEdit3(("Color" + strLightIdx).c_str(), l.mColor.cell))					mRenderer->ResetAccumulator();
-				if (ImGui::DragFloat(("Strength" + strLightIdx).c_str(), &l.mStrength, 0.005f, 0.0f))	mRenderer->ResetAccumulator();
+				color const colorBefore		= l.mColor; 
+				float const strengthBefore	= l.mStrength; 
+				if (ImGui::DragFloat3(("Position" + strLightIdx).c_str(), l.mPosition.cell, 0.005f))	mRenderer->RebuildLights(); 
+				if (ImGui::ColorEdit3(("Color" + strLightIdx).c_str(), l.mColor.cell))					mRenderer->RebuildLights(editedLight(colorBefore, strengthBefore, DEPENDENCY_LIGHTS_POINT));
+				if (ImGui::DragFloat(("Strength" + strLightIdx).c_str(), &l.mStrength, 0.005f, 0.0f))	mRenderer->RebuildLights(editedLight(colorBefore, strengthBefore, DEPENDENCY_LIGHTS_POINT));
 				ImGui::TreePop();
 			}
 		}
 		ImGui::TreePop(); // Points Lights 
 	}
+
+	if (ImGui::TreeNode("Spotlights"))
+	{
+		for (int i = 0; i < mRenderer->mSpotLights.size(); i++)  
+		{
+			std::string strLightIdx = "##" + std::to_string(i);
+			if (ImGui::TreeNode(("Spotlight" + strLightIdx).c_str()))
+			{
+				Spotlight& l = mRenderer->mSpotLights[i];  
+				color const colorBefore		= l.mColor; 
+				float const strengthBefore	= l.mStrength; 
+				if (ImGui::DragFloat3(("Position" + strLightIdx).c_str(), l.mPosition.cell, 0.005f))	{ l.DirectionFromLookAt(); mRenderer->RebuildLights(); }
+				if (ImGui::DragFloat3(("Look at" + strLightIdx).c_str(), l.mLookAt.cell, 0.005f))		{ l.DirectionFromLookAt(); mRenderer->RebuildLights(); }
+				if (ImGui::ColorEdit3(("Color" + strLightIdx).c_str(), l.mColor.cell))					mRenderer->RebuildLights(editedLight(colorBefore, strengthBefore, DEPENDENCY_LIGHTS_SPOT));
+				if (ImGui::DragFloat(("Strength" + strLightIdx).c_str(), &l.mStrength, 0.005f, 0.0f))	mRenderer->RebuildLights(editedLight(colorBefore, strengthBefore, DEPENDENCY_LIGHTS_SPOT));
+				ImGui::TreePop();
+			}
+		}
+		ImGui::TreePop(); // Spotlights 
+	}
 }
 
 void Ui::MovieUi() const
@@ -254,27 +417,34 @@ void Ui::MovieUi() const
 void Ui::MaterialUi(Material2& m, int const instIdx) const
 {
 	static int type = m.type;
+	float const emissivity = m.emissivity; 
 	if (ImGui::Combo("Type", &type, STR_MATERIAL_TYPES))
 	{
 		mRenderer->mBVHScene.SetInstanceMaterial(instIdx, type);
+		mRenderer->Invalidate(editedMaterial(instIdx, emissivity, m.emissivity)); 
 	}
 	if (ImGui::Button("Reset"))
 	{
 		mRenderer->mBVHScene.ResetInstanceMaterial(instIdx); 
+		mRenderer->Invalidate(editedMaterial(instIdx, emissivity, m.emissivity)); 
+	}
+	if (ImGui::DragFloat("Emissivity", &m.emissivity, 0.001f, 0.0f)) 
+	{
+		mRenderer->mBVHScene.UpdateEmissives(); 
+		mRenderer->Invalidate(editedMaterial(instIdx, emissivity, m.emissivity)); 
 	}
-	if (ImGui::DragFloat("Emissivity", &m.emissivity, 0.001f, 0.0f)) mRenderer->ResetAccumulator();  
 	switch (m.type)
 	{
 	case MATERIAL_TYPES_GLOSSY:
 	{
-		ImGui::ColorEdit3("Albedo", m.glossy.albedo.cell);
-		ImGui::DragFloat("Glossiness", &m.glossy.glossiness, 0.005f, 0.0f, 1.0f);
+		if (ImGui::ColorEdit3("Albedo", m.glossy.albedo.cell))							mRenderer->Invalidate(editedMaterial(instIdx, emissivity, emissivity));
+		if (ImGui::DragFloat("Glossiness", &m.glossy.glossiness, 0.005f, 0.0f, 1.0f))	mRenderer->Invalidate(editedMaterial(instIdx, emissivity, emissivity));
 		break;
 	}
 	case MATERIAL_TYPES_DIELECTRIC:
 	{
-		ImGui::ColorEdit3("Absorptance", m.dielectric.absorption.cell);
-		ImGui::DragFloat("IOR", &m.dielectric.ior, 0.005f, 1.0f, 3.0f);
+		if (ImGui::ColorEdit3("Absorptance", m.dielectric.absorption.cell))				mRenderer->Invalidate(editedMaterial(instIdx, emissivity, emissivity));
+		if (ImGui::DragFloat("IOR", &m.dielectric.ior, 0.005f, 1.0f, 3.0f))				mRenderer->Invalidate(editedMaterial(instIdx, emissivity, emissivity));
 		break;
 	}
 	case MATERIAL_TYPES_TEXTURED:
@@ -286,4 +456,46 @@ void Ui::MaterialUi(Material2& m, int const instIdx) const
 		break;
 	}
 	}
+}
+
+void Ui::MemoryUi() const
+{
+	float constexpr MB = 1.0f / (1024.0f * 1024.0f); 
+	memoryReport const report = mRenderer->GatherMemory(); 
+	ImGui::Text("Total: %.1f MB", static_cast<float>(report.Total()) * MB); 
+	if (ImGui::Button("Dump json")) (void)dumpMemoryReport(report, MEMORY_REPORT_FILE_PATH); 
+	ImGui::Separator(); 
+	for (int tag = 0; tag < MEMORY_TAGS_COUNT; tag++) ImGui::Text("%-14s %9.2f MB", MEMORY_TAG_NAMES[tag], static_cast<float>(report.mTags[tag]) * MB); 
+
+	if (ImGui::CollapsingHeader("Texture residency"))
+	{
+		textureResidencyStats const stats = TextureResidency::Stats(); 
+		ImGui::Checkbox("Page textures loaded from now on", &TextureResidency::sEnabled); 
+		int budget = static_cast<int>(stats.mBudget >> 20); 
+		if (ImGui::SliderInt("Budget (MB)", &budget, 64, 16384)) TextureResidency::sBudget = static_cast<size_t>(budget) << 20; 
+		ImGui::Text("Paged textures: %d", stats.mTextures); 
+		ImGui::Text("Resident: %.2f MB, peak %.2f MB", static_cast<float>(stats.mResidentBytes) * MB, static_cast<float>(stats.mPeakBytes) * MB); 
+		ImGui::Text("Page faults: %u last frame, %llu total", stats.mFaultsLastFrame, static_cast<unsigned long long>(stats.mFaults)); 
+		ImGui::Text("Tiles loaded: %llu, evicted: %llu", static_cast<unsigned long long>(stats.mLoads), static_cast<unsigned long long>(stats.mEvictions)); 
+	}
+
+	if (ImGui::CollapsingHeader("Models"))
+	{
+		ImGui::Text("Model      Tris    Points      BLAS  Textures (MB)"); 
+		for (size_t i = 0; i < report.mModels.size(); i++)
+		{
+			sceneMemory const& m = report.mModels[i]; 
+			ImGui::Text("%5zu %9.2f %9.2f %9.2f %9.2f", i, m.mTris * MB, m.mPoints * MB, m.mBlas * MB, m.mTextures * MB); 
+		}
+	}
+	if (ImGui::CollapsingHeader("Instances"))
+	{
+		// the geometry of a blas is shared, every instance of it shows the same bytes: 
+		ImGui::Text(" Inst Model  BLAS   Geometry (MB)"); 
+		for (size_t i = 0; i < report.mInstances.size(); i++)
+		{
+			instanceMemory const& inst = report.mInstances[i]; 
+			ImGui::Text("%5zu %5u %5u %9.2f", i, inst.mModel, inst.mBlas, inst.mBytes.Total() * MB); 
+		}
+	}
 }
\ No newline at end of file
@@ -15,11 +15,15 @@ ImGuiWindowFlags_NoMove |
 ImGuiWindowFlags_NoFocusOnAppearing |
 ImGuiWindowFlags_NoBringToFrontOnFocus;
 
-inline auto constexpr STR_RENDER_MODES		= "Normals\0Depth\0Albedo\0Shaded\0";
+inline auto constexpr STR_RENDER_MODES		= "Normals\0Depth\0Albedo\0Shaded\0Traversal cost\0";
+inline auto constexpr STR_COST_METRICS		= "Nodes\0Triangles\0Instances\0";
 inline auto constexpr STR_CONVERGE_MODES	= "None\0Accumulation\0Reprojection\0";
+inline auto constexpr STR_MIS_HEURISTICS	= "None\0Balance\0Power\0";
+inline auto constexpr STR_SAMPLER_TYPES		= "Random\0Sobol\0Rank-1 blue noise\0";
 inline auto constexpr STR_SAMPLE_MODES		= "None\0Unsafe/Fast\0Looped\0Clamped\0";
 inline auto constexpr STR_FILTER_MODES		= "None\0Nearest\0Linear\0";
 inline auto constexpr STR_LIGHT_TYPES		= "Point\0Directional\0Spot\0";
+inline auto constexpr STR_LIGHT_KERNELS		= "Scalar\0SSE\0AVX2\0";
 inline auto constexpr STR_MATERIAL_TYPES	= "None\0Diffuse\0Metallic\0Dielectric\0Glossy\0Textured\0";
 
 class Ui
@@ -38,6 +42,7 @@ private:
 	void	MaterialsUi() const;
 	void	LightsUi() const;
 	void	MovieUi() const; 
+	void	MemoryUi() const; 
 
 	template <typename T>
 	void	TextureUi(Texture<T>& texture, int const id = 0) const;
@@ -71,7 +76,7 @@ inline void Ui::InstanceUi(BVHScene& s, int const instIdx) const
 	ImGui::Text("InstIdx: %d", instIdx);
 	if (ImGui::CollapsingHeader("Material"))
 	{
-		MaterialUi(s.GetMaterial(instIdx));
+		MaterialUi(s.GetMaterial(instIdx), instIdx);
 	}
 }
 
@@ -86,5 +91,14 @@ inline void Ui::SceneUi(BVHScene& s) const
 			ImGui::TreePop(); 
 		}
 	}
+	if (ImGui::CollapsingHeader("Textures"))
+	{
+		ImGui::Text("Resident: %.2f MB", static_cast<float>(ResourceManager::TextureBytes()) / (1024.0f * 1024.0f)); 
+		for (textureInfo const& info : ResourceManager::TextureInfo())
+		{
+			ImGui::Text("%s", info.mPath.c_str()); 
+			ImGui::Text("  %dx%d, %.2f MB, %d refs, %d aliases%s", info.mWidth, info.mHeight, static_cast<float>(info.mBytes) / (1024.0f * 1024.0f), info.mRefs, info.mAliases, info.mPaged ? ", paged" : ""); 
+		}
+	}
 }
 
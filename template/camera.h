@@ -53,6 +53,7 @@ public:
 	[[nodiscard]] tinybvh::Ray	GenPrimaryRayTinyBVH(float2 const pixel) const; 
 	[[nodiscard]] tinybvh::Ray	GenPrimaryRayFocusedTinyBVH(float2 const pixel) const;
 	[[nodiscard]] tinybvh::Ray	GenPrimaryRayFocusedTinyBVH(float2 const pixel, blueSeed const seed) const; 
+	void						GenPrimaryRays(int const x, int const y, int const count, tinybvh::Ray* rays, float2 const* offsets = nullptr, float2 const* lens = nullptr) const;
 	void						UpdateBasisVectors();
 	void						UpdateViewport();
 	void						UpdateDefocusDisk(); 
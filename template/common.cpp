@@ -35,23 +35,14 @@ float3 calcRawNormal(float3 const& p1, float3 const& p2, float3 const& p3)
 
 float3 randomUnitOnDisk()
 {
-	while (true)
-	{
-		float3 const point = { randomFloatUnit(), randomFloatUnit(), 0.0f };
-		if (sqrLength(point) < 1.0f) return point;
-	}
+	float2 const point = concentricDisk(Sampler::Get2D()); 
+	return { point.x, point.y, 0.0f }; 
 }
 
 float3 randomUnitOnDisk(blueSeed const seed) 
 {
-	// try blue noise:
-	float2 random = BlueNoise::GetInstance().Float2Unit(seed);  
-	while (sqrLength(random) >= 1.0f) 
-	{
-		// if it does not work, fallback to white noise:
-		random = randomFloat2();  
-	}
-	return { random.x, random.y, 0.0f }; 
+	float2 const point = concentricDisk(BlueNoise::GetInstance().Float2(seed)); 
+	return { point.x, point.y, 0.0f }; 
 }
 
 float3 randomFloat3()
@@ -71,12 +62,7 @@ float3 randomFloat3Unit()
 
 float3 randomUnitOnHemisphere(float3 const& normal)
 {
-	float3 const random = normalize(randomFloat3());
-	if (dot(random, normal) > 0.0f)
-	{
-		return random;
-	}
-	return -random;
+	return uniformHemisphere(normal, Sampler::Get2D()); 
 }
 
 float3 randomUnitOnHemisphere(float3 const& normal, blueSeed const seed) 
@@ -111,24 +97,12 @@ float3 diffuseReflection(float3 const& normal, blueSeed const seed)
 
 float3 cosineWeightedDiffuseReflection(float3 const& normal) 
 {
-	float3 random;
-	do
-	{
-		random = randomFloat3();
-	} while (dot(random, random) > 1.0f);
-	return normalize(normal + normalize(random));
+	return cosineHemisphere(normal, Sampler::Get2D()); 
 }
 
 float3 cosineWeightedDiffuseReflection(float3 const& normal, blueSeed const seed) 
 {
-	// try blue noise:
-	float3 random = BlueNoise::GetInstance().Float3UnitLinear(seed); 
-	while (dot(random, random) > 1.0f)
-	{
-		// if it does not work, fallback to white noise:
-		random = randomFloat3(); 
-	}
-	return normalize(normal + normalize(random)); 
+	return cosineHemisphere(normal, BlueNoise::GetInstance().Float2(seed)); 
 }
 
 float randomFloatUnit()
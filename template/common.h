@@ -20,6 +20,11 @@ namespace tinybvh
 #include "color.h"
 #include "directions.h" 
 #include "noise.h" 
+#include "sampler.h" 
+#include "profiler.h" 
+#include "jobs.h" 
+#include "frame_arena.h" 
+#include "memory_report.h" 
 #include "camera.h" 
 #include "resources.h" 
 #include "materials.h"  
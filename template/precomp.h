@@ -156,49 +156,6 @@ struct Timer
 	chrono::high_resolution_clock::time_point start;
 };
 
-// Nils's jobmanager
-class Job
-{
-public:
-	virtual void Main() = 0;
-protected:
-	friend class JobThread;
-	void RunCodeWrapper();
-};
-class JobThread
-{
-public:
-	void CreateAndStartThread( unsigned int threadId );
-	void Go();
-	void BackgroundTask();
-	HANDLE m_GoSignal, m_ThreadHandle;
-	int m_ThreadID;
-};
-class JobManager	// singleton class!
-{
-protected:
-	JobManager( unsigned int numThreads );
-public:
-	~JobManager();
-	static void CreateJobManager( unsigned int numThreads );
-	static JobManager* GetJobManager();
-	static void GetProcessorCount( uint& cores, uint& logical );
-	void AddJob2( Job* a_Job );
-	unsigned int GetNumThreads() { return m_NumThreads; }
-	void RunJobs( bool );
-	void ThreadDone( unsigned int n );
-	int MaxConcurrent() { return m_NumThreads; }
-protected:
-	friend class JobThread;
-	Job* GetNextJob();
-	static JobManager* m_JobManager;
-	Job* m_JobList[4096];
-	CRITICAL_SECTION m_CS;
-	HANDLE m_ThreadDone[64];
-	unsigned int m_NumThreads, m_JobCount;
-	JobThread* m_JobThreadList;
-};
-
 // forward declaration of helper functions
 void FatalError( const char* fmt, ... );
 bool FileIsNewer( const char* file1, const char* file2 );
@@ -211,7 +168,6 @@ void TextFileWrite( const string& text, const char* _File );
 // global project settigs; shared with OpenCL.
 // If you change these a lot, consider moving the include out of precomp.h.
 #include "common.h"
-#include <omp.h> 
 
 // low-level: instruction set detection
 #ifdef _WIN32
@@ -22,6 +22,7 @@
 #define PLANE_Z(o,i) {t=-(ray.O.z+o)*ray.rD.z;if(t<ray.t&&t>0)ray.t=t,ray.objIdx=i;}
 
 #define RAY_FAR 1e34f
+#define TORUS_MAX_RESIDUAL 1e-4f	// quartic value above which a simd torus root is recomputed in double precision
 
 namespace Tmpl8 {
 __declspec(align(64)) class Ray
@@ -46,6 +47,99 @@ public:
 	bool inside = false; // true when in medium
 };
 
+// -----------------------------------------------------------
+// Ray8
+// Eight rays in SoA form, for the AVX2 stream queries
+// FindNearest8 and IsOccluded8. Unused lanes get t = 0, so no
+// primitive can report a hit for them.
+// -----------------------------------------------------------
+__declspec(align(64)) class Ray8
+{
+public:
+	Ray8() = default;
+	Ray8( const Ray* rays, const int count = 8 )
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			const Ray& r = rays[min( i, count - 1 )];
+			Ox[i] = r.O.x, Oy[i] = r.O.y, Oz[i] = r.O.z;
+			Dx[i] = r.D.x, Dy[i] = r.D.y, Dz[i] = r.D.z;
+			rDx[i] = r.rD.x, rDy[i] = r.rD.y, rDz[i] = r.rD.z;
+			t[i] = i < count ? r.t : 0, objIdx[i] = r.objIdx;
+		}
+	}
+	void Store( Ray* rays, const int count = 8 ) const
+	{
+		for (int i = 0; i < count; i++) rays[i].t = t[i], rays[i].objIdx = objIdx[i];
+	}
+	Ray Lane( const int i ) const
+	{
+		return Ray( float3( Ox[i], Oy[i], Oz[i] ), float3( Dx[i], Dy[i], Dz[i] ), t[i], objIdx[i] );
+	}
+	void Hit( const __m256 mask, const __m256 tHit, const int idx )
+	{
+		// lanes in the mask take the new distance and object
+		t8 = _mm256_blendv_ps( t8, tHit, mask );
+		objIdx8 = _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( objIdx8 ), _mm256_castsi256_ps( _mm256_set1_epi32( idx ) ), mask ) );
+	}
+	// ray data
+	union { __m256 Ox8; float Ox[8]; };
+	union { __m256 Oy8; float Oy[8]; };
+	union { __m256 Oz8; float Oz[8]; };
+	union { __m256 Dx8; float Dx[8]; };
+	union { __m256 Dy8; float Dy[8]; };
+	union { __m256 Dz8; float Dz[8]; };
+	union { __m256 rDx8; float rDx[8]; };
+	union { __m256 rDy8; float rDy[8]; };
+	union { __m256 rDz8; float rDz[8]; };
+	union { __m256 t8; float t[8]; };
+	union { __m256i objIdx8; int objIdx[8]; };
+};
+
+// 8-wide helpers for the stream queries
+inline __m256 dot8( const __m256 ax, const __m256 ay, const __m256 az, const float bx, const float by, const float bz )
+{
+	return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( ax, _mm256_set1_ps( bx ) ), _mm256_mul_ps( ay, _mm256_set1_ps( by ) ) ), _mm256_mul_ps( az, _mm256_set1_ps( bz ) ) );
+}
+inline __m256 dot8( const __m256 ax, const __m256 ay, const __m256 az, const __m256 bx, const __m256 by, const __m256 bz )
+{
+	return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( ax, bx ), _mm256_mul_ps( ay, by ) ), _mm256_mul_ps( az, bz ) );
+}
+inline __m256 inRange8( const __m256 t, const __m256 tMax )
+{
+	// the 0 < t < ray.t test every primitive uses; NaNs fail it, just like the scalar code
+	return _mm256_and_ps( _mm256_cmp_ps( t, tMax, _CMP_LT_OQ ), _mm256_cmp_ps( t, _mm256_setzero_ps(), _CMP_GT_OQ ) );
+}
+inline __m256 abs8( const __m256 a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ); }
+inline __m256 acos8( const __m256 x )
+{
+	// Abramowitz and Stegun 4.4.46, absolute error below 2e-8 on [-1, 1]
+	const __m256 a = _mm256_min_ps( abs8( x ), _mm256_set1_ps( 1 ) );
+	const float c[8] = { -0.0012624911f, 0.0066700901f, -0.0170881256f, 0.0308918810f, -0.0501743046f, 0.0889789874f, -0.2145988016f, 1.5707963050f };
+	__m256 p = _mm256_set1_ps( c[0] );
+	for (int i = 1; i < 8; i++) p = _mm256_add_ps( _mm256_mul_ps( p, a ), _mm256_set1_ps( c[i] ) );
+	const __m256 r = _mm256_mul_ps( _mm256_sqrt_ps( _mm256_sub_ps( _mm256_set1_ps( 1 ), a ) ), p );
+	return _mm256_blendv_ps( r, _mm256_sub_ps( _mm256_set1_ps( PI ), r ), _mm256_cmp_ps( x, _mm256_setzero_ps(), _CMP_LT_OQ ) );
+}
+inline __m256 cos8( const __m256 x )
+{
+	// taylor series, float precision on [0, pi / 3], the range of acos( x ) / 3
+	const __m256 x2 = _mm256_mul_ps( x, x );
+	const float c[6] = { -1.0f / 3628800, 1.0f / 40320, -1.0f / 720, 1.0f / 24, -0.5f, 1 };
+	__m256 p = _mm256_set1_ps( c[0] );
+	for (int i = 1; i < 6; i++) p = _mm256_add_ps( _mm256_mul_ps( p, x2 ), _mm256_set1_ps( c[i] ) );
+	return p;
+}
+inline __m256 cbrt8( const __m256 x )
+{
+	// exponent-thirding estimate and three newton steps, for x >= 0
+	const __m256 y = _mm256_max_ps( x, _mm256_set1_ps( 1e-30f ) );
+	const __m256 bits = _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_castps_si256( y ) ), _mm256_set1_ps( 1.0f / 3 ) );
+	__m256 r = _mm256_castsi256_ps( _mm256_add_epi32( _mm256_cvttps_epi32( bits ), _mm256_set1_epi32( 709921077 ) ) );
+	for (int i = 0; i < 3; i++) r = _mm256_mul_ps( _mm256_add_ps( _mm256_add_ps( r, r ), _mm256_div_ps( y, _mm256_mul_ps( r, r ) ) ), _mm256_set1_ps( 1.0f / 3 ) );
+	return r;
+}
+
 // -----------------------------------------------------------
 // Sphere primitive
 // Basic sphere, with explicit support for rays that start
@@ -86,6 +180,35 @@ public:
 		bool hit = t < ray.t && t > 0;
 		return hit;
 	}
+	void Intersect8( Ray8& ray ) const
+	{
+		// both roots, the far one only counts when the near one missed
+		const __m256 ocx = _mm256_sub_ps( ray.Ox8, _mm256_set1_ps( pos.x ) );
+		const __m256 ocy = _mm256_sub_ps( ray.Oy8, _mm256_set1_ps( pos.y ) );
+		const __m256 ocz = _mm256_sub_ps( ray.Oz8, _mm256_set1_ps( pos.z ) );
+		const __m256 b = dot8( ocx, ocy, ocz, ray.Dx8, ray.Dy8, ray.Dz8 );
+		const __m256 c = _mm256_sub_ps( dot8( ocx, ocy, ocz, ocx, ocy, ocz ), _mm256_set1_ps( r2 ) );
+		const __m256 d = _mm256_sub_ps( _mm256_mul_ps( b, b ), c );
+		const __m256 live = _mm256_cmp_ps( d, _mm256_setzero_ps(), _CMP_GT_OQ );
+		if (_mm256_movemask_ps( live ) == 0) return;
+		const __m256 sd = _mm256_sqrt_ps( _mm256_max_ps( d, _mm256_setzero_ps() ) );
+		const __m256 t1 = _mm256_sub_ps( _mm256_sub_ps( _mm256_setzero_ps(), b ), sd );
+		ray.Hit( _mm256_and_ps( live, inRange8( t1, ray.t8 ) ), t1, objIdx );
+		const __m256 t2 = _mm256_sub_ps( sd, b );
+		ray.Hit( _mm256_and_ps( live, inRange8( t2, ray.t8 ) ), t2, objIdx );
+	}
+	__m256 IsOccluded8( const Ray8& ray ) const
+	{
+		const __m256 ocx = _mm256_sub_ps( ray.Ox8, _mm256_set1_ps( pos.x ) );
+		const __m256 ocy = _mm256_sub_ps( ray.Oy8, _mm256_set1_ps( pos.y ) );
+		const __m256 ocz = _mm256_sub_ps( ray.Oz8, _mm256_set1_ps( pos.z ) );
+		const __m256 b = dot8( ocx, ocy, ocz, ray.Dx8, ray.Dy8, ray.Dz8 );
+		const __m256 c = _mm256_sub_ps( dot8( ocx, ocy, ocz, ocx, ocy, ocz ), _mm256_set1_ps( r2 ) );
+		const __m256 d = _mm256_sub_ps( _mm256_mul_ps( b, b ), c );
+		const __m256 live = _mm256_cmp_ps( d, _mm256_setzero_ps(), _CMP_GT_OQ );
+		const __m256 t = _mm256_sub_ps( _mm256_sub_ps( _mm256_setzero_ps(), b ), _mm256_sqrt_ps( _mm256_max_ps( d, _mm256_setzero_ps() ) ) );
+		return _mm256_and_ps( live, inRange8( t, ray.t8 ) );
+	}
 	float3 GetNormal( const float3 I ) const
 	{
 		return (I - this->pos) * invr;
@@ -118,6 +241,12 @@ public:
 		float t = -(dot( ray.O, this->N ) + this->d) / (dot( ray.D, this->N ));
 		if (t < ray.t && t > 0) ray.t = t, ray.objIdx = objIdx;
 	}
+	void Intersect8( Ray8& ray ) const
+	{
+		const __m256 num = _mm256_add_ps( dot8( ray.Ox8, ray.Oy8, ray.Oz8, N.x, N.y, N.z ), _mm256_set1_ps( d ) );
+		const __m256 t = _mm256_div_ps( _mm256_sub_ps( _mm256_setzero_ps(), num ), dot8( ray.Dx8, ray.Dy8, ray.Dz8, N.x, N.y, N.z ) );
+		ray.Hit( inRange8( t, ray.t8 ), t, objIdx );
+	}
 	float3 GetNormal( const float3 I ) const
 	{
 		return N;
@@ -222,6 +351,32 @@ public:
 		float tmin = max( vmin4.m128_f32[0], max( vmin4.m128_f32[1], vmin4.m128_f32[2] ) );
 		return tmax > 0 && tmin < tmax && tmin < ray.t;
 	}
+	void Slab8( const Ray8& ray, __m256& tmin, __m256& tmax ) const
+	{
+		// AABB test, eight rays at a time
+		const __m256 tx1 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( b[0].x ), ray.Ox8 ), ray.rDx8 );
+		const __m256 tx2 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( b[1].x ), ray.Ox8 ), ray.rDx8 );
+		const __m256 ty1 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( b[0].y ), ray.Oy8 ), ray.rDy8 );
+		const __m256 ty2 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( b[1].y ), ray.Oy8 ), ray.rDy8 );
+		const __m256 tz1 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( b[0].z ), ray.Oz8 ), ray.rDz8 );
+		const __m256 tz2 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( b[1].z ), ray.Oz8 ), ray.rDz8 );
+		tmin = _mm256_max_ps( _mm256_min_ps( tx1, tx2 ), _mm256_max_ps( _mm256_min_ps( ty1, ty2 ), _mm256_min_ps( tz1, tz2 ) ) );
+		tmax = _mm256_min_ps( _mm256_max_ps( tx1, tx2 ), _mm256_min_ps( _mm256_max_ps( ty1, ty2 ), _mm256_max_ps( tz1, tz2 ) ) );
+	}
+	void Intersect8( Ray8& ray ) const
+	{
+		// rays that start inside take the exit distance, like the scalar version
+		__m256 tmin, tmax;
+		Slab8( ray, tmin, tmax );
+		const __m256 t = _mm256_blendv_ps( tmax, tmin, _mm256_cmp_ps( tmin, _mm256_setzero_ps(), _CMP_GT_OQ ) );
+		ray.Hit( _mm256_and_ps( _mm256_cmp_ps( tmin, tmax, _CMP_LT_OQ ), inRange8( t, ray.t8 ) ), t, objIdx );
+	}
+	__m256 IsOccluded8( const Ray8& ray ) const
+	{
+		__m256 tmin, tmax;
+		Slab8( ray, tmin, tmax );
+		return _mm256_and_ps( _mm256_and_ps( _mm256_cmp_ps( tmax, _mm256_setzero_ps(), _CMP_GT_OQ ), _mm256_cmp_ps( tmin, tmax, _CMP_LT_OQ ) ), _mm256_cmp_ps( tmin, ray.t8, _CMP_LT_OQ ) );
+	}
 	float3 GetNormal( const float3 I ) const
 	{
 		// determine normal in object space
@@ -292,6 +447,32 @@ public:
 		}
 		return false;
 	}
+	__m256 Hit8( const Ray8& ray, __m256& t ) const
+	{
+		const __m256 Oy = _mm256_add_ps( dot8( ray.Ox8, ray.Oy8, ray.Oz8, invT.cell[4], invT.cell[5], invT.cell[6] ), _mm256_set1_ps( invT.cell[7] ) );
+		const __m256 Dy = dot8( ray.Dx8, ray.Dy8, ray.Dz8, invT.cell[4], invT.cell[5], invT.cell[6] );
+		t = _mm256_div_ps( Oy, _mm256_sub_ps( _mm256_setzero_ps(), Dy ) );
+		const __m256 Ox = _mm256_add_ps( dot8( ray.Ox8, ray.Oy8, ray.Oz8, invT.cell[0], invT.cell[1], invT.cell[2] ), _mm256_set1_ps( invT.cell[3] ) );
+		const __m256 Oz = _mm256_add_ps( dot8( ray.Ox8, ray.Oy8, ray.Oz8, invT.cell[8], invT.cell[9], invT.cell[10] ), _mm256_set1_ps( invT.cell[11] ) );
+		const __m256 Dx = dot8( ray.Dx8, ray.Dy8, ray.Dz8, invT.cell[0], invT.cell[1], invT.cell[2] );
+		const __m256 Dz = dot8( ray.Dx8, ray.Dy8, ray.Dz8, invT.cell[8], invT.cell[9], invT.cell[10] );
+		const __m256 Ix = _mm256_add_ps( Ox, _mm256_mul_ps( t, Dx ) ), Iz = _mm256_add_ps( Oz, _mm256_mul_ps( t, Dz ) );
+		const __m256 s = _mm256_set1_ps( size ), ns = _mm256_set1_ps( -size );
+		const __m256 inX = _mm256_and_ps( _mm256_cmp_ps( Ix, ns, _CMP_GT_OQ ), _mm256_cmp_ps( Ix, s, _CMP_LT_OQ ) );
+		const __m256 inZ = _mm256_and_ps( _mm256_cmp_ps( Iz, ns, _CMP_GT_OQ ), _mm256_cmp_ps( Iz, s, _CMP_LT_OQ ) );
+		return _mm256_and_ps( inRange8( t, ray.t8 ), _mm256_and_ps( inX, inZ ) );
+	}
+	void Intersect8( Ray8& ray ) const
+	{
+		__m256 t;
+		const __m256 mask = Hit8( ray, t );
+		ray.Hit( mask, t, objIdx );
+	}
+	__m256 IsOccluded8( const Ray8& ray ) const
+	{
+		__m256 t;
+		return Hit8( ray, t );
+	}
 	float3 GetNormal( const float3 I ) const
 	{
 		return float3( -T.cell[1], -T.cell[5], -T.cell[9] );
@@ -305,6 +486,26 @@ public:
 	int objIdx = -1;
 };
 
+// -----------------------------------------------------------
+// Torus cost counters, collected by all render threads while
+// Torus::sCollectStats is on, and a per-frame report of them.
+// -----------------------------------------------------------
+struct torusStats
+{
+	std::atomic<uint64_t> mTests = 0;			// rays tested against the torus
+	std::atomic<uint64_t> mCulled = 0;			// rejected by the bounding volume
+	std::atomic<uint64_t> mRetried = 0;			// simd lanes handed to the scalar solver
+	std::atomic<uint64_t> mCycles = 0;			// rdtsc ticks spent in the tests
+	std::atomic<uint64_t> mValidated = 0;
+	std::atomic<uint64_t> mMismatches = 0;		// hit / miss disagreements with the double precision solver
+	std::atomic<float> mMaxError = 0;			// largest relative distance error where both hit
+};
+struct torusReport
+{
+	uint64_t mTests = 0, mValidated = 0, mMismatches = 0;
+	float mCulledRate = 0, mRetryRate = 0, mCyclesPerTest = 0, mMaxError = 0;
+};
+
 // -----------------------------------------------------------
 // Torus primitive - Inigo Quilez, ShaderToy 4sBGDy
 // -----------------------------------------------------------
@@ -314,10 +515,10 @@ public:
 	Torus() = default;
 	Torus::Torus( int idx, float a, float b ) : objIdx( idx )
 	{
-		rc2 = a * a, rt2 = b * b;
+		rc2 = a * a, rt2 = b * b, rt = b;
 		r2 = sqrf( a + b );
 	}
-	void Intersect( Ray& ray ) const
+	void Quartic( Ray& ray ) const
 	{
 		// via: https://www.shadertoy.com/view/4sBGDy
 		float3 O = ray.O - float3( 0, 0, 1.5f ), D = ray.D;
@@ -388,7 +589,7 @@ public:
 		float ft = (float)t;
 		if (ft > 0 && ft < ray.t) ray.t = ft, ray.objIdx = objIdx;
 	}
-	bool IsOccluded( const Ray& ray ) const
+	bool QuarticOccluded( const Ray& ray ) const
 	{
 		// via: https://www.shadertoy.com/view/4sBGDy
 		float3 O = ray.O - float3( 0, 0, 1.5f ), D = ray.D;
@@ -453,6 +654,221 @@ public:
 		}
 		return false;
 	}
+	bool InBounds( const Ray& ray ) const
+	{
+		// bounding sphere clipped by the slab the tube lives in, and by the ray interval
+		const float3 O = ray.O - float3( 0, 0, 1.5f );
+		const float k3 = dot( O, ray.D ), v = k3 * k3 - dot( O, O ) + r2;
+		if (v < 0) return false;
+		const float sv = sqrtf( v ), tz1 = (-rt - O.z) * ray.rD.z, tz2 = (rt - O.z) * ray.rD.z;
+		const float tn = max( -k3 - sv, min( tz1, tz2 ) ), tf = min( -k3 + sv, max( tz1, tz2 ) );
+		return tn <= tf + 1e-4f && tf > 0 && tn < ray.t;
+	}
+	void Intersect( Ray& ray ) const
+	{
+		const uint64_t start = sCollectStats ? __rdtsc() : 0;
+		const bool solve = !sBoundsTest || InBounds( ray );
+		if (solve) Quartic( ray );
+		if (sCollectStats) Count( 1, solve ? 0 : 1, start );
+	}
+	bool IsOccluded( const Ray& ray ) const
+	{
+		const uint64_t start = sCollectStats ? __rdtsc() : 0;
+		const bool solve = !sBoundsTest || InBounds( ray );
+		const bool occluded = solve && QuarticOccluded( ray );
+		if (sCollectStats) Count( 1, solve ? 0 : 1, start );
+		return occluded;
+	}
+	__m256 Bounds8( const Ray8& ray ) const
+	{
+		// InBounds, eight rays at a time
+		const __m256 Oz = _mm256_sub_ps( ray.Oz8, _mm256_set1_ps( 1.5f ) );
+		const __m256 k3 = dot8( ray.Ox8, ray.Oy8, Oz, ray.Dx8, ray.Dy8, ray.Dz8 );
+		const __m256 v = _mm256_add_ps( _mm256_sub_ps( _mm256_mul_ps( k3, k3 ), dot8( ray.Ox8, ray.Oy8, Oz, ray.Ox8, ray.Oy8, Oz ) ), _mm256_set1_ps( r2 ) );
+		const __m256 sv = _mm256_sqrt_ps( _mm256_max_ps( v, _mm256_setzero_ps() ) );
+		const __m256 tz1 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( -rt ), Oz ), ray.rDz8 );
+		const __m256 tz2 = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( rt ), Oz ), ray.rDz8 );
+		const __m256 nk3 = _mm256_sub_ps( _mm256_setzero_ps(), k3 );
+		const __m256 tn = _mm256_max_ps( _mm256_sub_ps( nk3, sv ), _mm256_min_ps( tz1, tz2 ) );
+		const __m256 tf = _mm256_min_ps( _mm256_add_ps( nk3, sv ), _mm256_max_ps( tz1, tz2 ) );
+		const __m256 overlap = _mm256_cmp_ps( tn, _mm256_add_ps( tf, _mm256_set1_ps( 1e-4f ) ), _CMP_LE_OQ );
+		const __m256 ahead = _mm256_and_ps( _mm256_cmp_ps( tf, _mm256_setzero_ps(), _CMP_GT_OQ ), _mm256_cmp_ps( tn, ray.t8, _CMP_LT_OQ ) );
+		return _mm256_and_ps( _mm256_cmp_ps( v, _mm256_setzero_ps(), _CMP_GE_OQ ), _mm256_and_ps( overlap, ahead ) );
+	}
+	__m256 Solve8( const Ray8& ray, int& retry ) const
+	{
+		// the float closed form of QuarticOccluded for eight rays: both cubic branches are evaluated
+		// and blended, lanes without a positive root return RAY_FAR; lanes whose root does not
+		// survive polishing are flagged in retry, for the double precision solver
+		const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps( 1 ), far8 = _mm256_set1_ps( RAY_FAR );
+		const __m256 two = _mm256_set1_ps( 2 ), three = _mm256_set1_ps( 3 ), third = _mm256_set1_ps( 0.33333333333f );
+		const __m256 Oz = _mm256_sub_ps( ray.Oz8, _mm256_set1_ps( 1.5f ) ), Dz = ray.Dz8;
+		const __m256 rc = _mm256_set1_ps( rc2 ), rt8 = _mm256_set1_ps( rt2 );
+		const __m256 m = dot8( ray.Ox8, ray.Oy8, Oz, ray.Ox8, ray.Oy8, Oz );
+		const __m256 k3o = dot8( ray.Ox8, ray.Oy8, Oz, ray.Dx8, ray.Dy8, Dz ), k32o = _mm256_mul_ps( k3o, k3o );
+		const __m256 k = _mm256_mul_ps( _mm256_sub_ps( _mm256_sub_ps( m, rt8 ), rc ), _mm256_set1_ps( 0.5f ) );
+		const __m256 k2o = _mm256_add_ps( _mm256_add_ps( k32o, _mm256_mul_ps( rc, _mm256_mul_ps( Dz, Dz ) ) ), k );
+		const __m256 k1o = _mm256_add_ps( _mm256_mul_ps( k, k3o ), _mm256_mul_ps( rc, _mm256_mul_ps( Oz, Dz ) ) );
+		const __m256 k0o = _mm256_sub_ps( _mm256_add_ps( _mm256_mul_ps( k, k ), _mm256_mul_ps( rc, _mm256_mul_ps( Oz, Oz ) ) ), _mm256_mul_ps( rc, rt8 ) );
+		// lanes close to the degenerate case solve for 1 / t instead
+		const __m256 flip = _mm256_cmp_ps( abs8( _mm256_add_ps( _mm256_mul_ps( k3o, _mm256_sub_ps( k32o, k2o ) ), k1o ) ), _mm256_set1_ps( 0.01f ), _CMP_LT_OQ );
+		const __m256 ik0 = _mm256_div_ps( one, k0o );
+		const __m256 k0 = _mm256_blendv_ps( k0o, ik0, flip );
+		const __m256 k1 = _mm256_blendv_ps( k1o, _mm256_mul_ps( k3o, ik0 ), flip );
+		const __m256 k2 = _mm256_blendv_ps( k2o, _mm256_mul_ps( k2o, ik0 ), flip );
+		const __m256 k3 = _mm256_blendv_ps( k3o, _mm256_mul_ps( k1o, ik0 ), flip );
+		const __m256 k32 = _mm256_mul_ps( k3, k3 );
+		// resolvent cubic
+		const __m256 c2 = _mm256_mul_ps( _mm256_sub_ps( _mm256_mul_ps( two, k2 ), _mm256_mul_ps( three, k32 ) ), third );
+		const __m256 c1 = _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( k3, _mm256_sub_ps( k32, k2 ) ), k1 ), two );
+		const __m256 inner = _mm256_sub_ps( _mm256_mul_ps( k3, _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( -3 ), k32 ), _mm256_mul_ps( _mm256_set1_ps( 4 ), k2 ) ) ), _mm256_mul_ps( _mm256_set1_ps( 8 ), k1 ) );
+		const __m256 c0 = _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( k3, inner ), _mm256_mul_ps( _mm256_set1_ps( 4 ), k0 ) ), third );
+		const __m256 Q = _mm256_add_ps( _mm256_mul_ps( c2, c2 ), c0 );
+		const __m256 R = _mm256_sub_ps( _mm256_sub_ps( _mm256_mul_ps( _mm256_mul_ps( three, c0 ), c2 ), _mm256_mul_ps( _mm256_mul_ps( c2, c2 ), c2 ) ), _mm256_mul_ps( c1, c1 ) );
+		const __m256 h = _mm256_sub_ps( _mm256_mul_ps( R, R ), _mm256_mul_ps( _mm256_mul_ps( Q, Q ), Q ) );
+		// three real roots: trigonometric form; one real root: cardano
+		const __m256 sQ = _mm256_sqrt_ps( _mm256_max_ps( Q, zero ) );
+		const __m256 zTrig = _mm256_mul_ps( _mm256_mul_ps( two, sQ ), cos8( _mm256_mul_ps( acos8( _mm256_div_ps( R, _mm256_mul_ps( sQ, Q ) ) ), third ) ) );
+		const __m256 sC = cbrt8( _mm256_add_ps( _mm256_sqrt_ps( _mm256_max_ps( h, zero ) ), abs8( R ) ) );
+		const __m256 zCard = _mm256_or_ps( abs8( _mm256_add_ps( sC, _mm256_div_ps( Q, sC ) ) ), _mm256_and_ps( R, _mm256_set1_ps( -0.0f ) ) );
+		const __m256 z = _mm256_sub_ps( c2, _mm256_blendv_ps( zCard, zTrig, _mm256_cmp_ps( h, zero, _CMP_LT_OQ ) ) );
+		// factor into two quadratics
+		const __m256 d1o = _mm256_sub_ps( z, _mm256_mul_ps( three, c2 ) ), d2o = _mm256_sub_ps( _mm256_mul_ps( z, z ), _mm256_mul_ps( three, c0 ) );
+		const __m256 tiny = _mm256_cmp_ps( abs8( d1o ), _mm256_set1_ps( 1e-4f ), _CMP_LT_OQ );
+		const __m256 valid = _mm256_blendv_ps( _mm256_cmp_ps( d1o, zero, _CMP_GE_OQ ), _mm256_cmp_ps( d2o, zero, _CMP_GE_OQ ), tiny );
+		const __m256 d1s = _mm256_sqrt_ps( _mm256_max_ps( _mm256_mul_ps( d1o, _mm256_set1_ps( 0.5f ) ), zero ) );
+		const __m256 d1 = _mm256_blendv_ps( d1s, d1o, tiny );
+		const __m256 d2 = _mm256_blendv_ps( _mm256_div_ps( c1, d1s ), _mm256_sqrt_ps( _mm256_max_ps( d2o, zero ) ), tiny );
+		const __m256 d11z = _mm256_sub_ps( _mm256_mul_ps( d1, d1 ), z );
+		const __m256 h1 = _mm256_add_ps( d11z, d2 ), h2 = _mm256_sub_ps( d11z, d2 );
+		const __m256 s1 = _mm256_sqrt_ps( _mm256_max_ps( h1, zero ) ), s2 = _mm256_sqrt_ps( _mm256_max_ps( h2, zero ) );
+		const __m256 nd1k3 = _mm256_sub_ps( _mm256_sub_ps( zero, d1 ), k3 ), pd1k3 = _mm256_sub_ps( d1, k3 );
+		const __m256 roots[4] = { _mm256_sub_ps( nd1k3, s1 ), _mm256_add_ps( nd1k3, s1 ), _mm256_sub_ps( pd1k3, s2 ), _mm256_add_ps( pd1k3, s2 ) };
+		const __m256 real[2] = { _mm256_cmp_ps( h1, zero, _CMP_GT_OQ ), _mm256_cmp_ps( h2, zero, _CMP_GT_OQ ) };
+		__m256 t = far8;
+		for (int i = 0; i < 4; i++)
+		{
+			const __m256 root = _mm256_blendv_ps( roots[i], _mm256_div_ps( two, roots[i] ), flip );
+			const __m256 ok = _mm256_and_ps( _mm256_and_ps( valid, real[i / 2] ), _mm256_cmp_ps( root, zero, _CMP_GT_OQ ) );
+			t = _mm256_min_ps( t, _mm256_blendv_ps( far8, root, ok ) );
+		}
+		// a miss with a factorisation that (nearly) worked is often a grazing ray float could not resolve
+		const __m256 close = _mm256_cmp_ps( d1o, _mm256_set1_ps( -1e-3f ), _CMP_GT_OQ );
+		const __m256 doubt = _mm256_and_ps( close, _mm256_cmp_ps( t, far8, _CMP_GE_OQ ) );
+		t = Polish8( ray, t, retry );
+		retry |= _mm256_movemask_ps( doubt );
+		return t;
+	}
+	__m256 Polish8( const Ray8& ray, __m256 t, int& retry ) const
+	{
+		// two newton steps on f(t) = (|P|^2 + R^2 - r^2)^2 - 4 R^2 (Px^2 + Py^2); a step towards another root is refused
+		const __m256 Oz = _mm256_sub_ps( ray.Oz8, _mm256_set1_ps( 1.5f ) ), rc = _mm256_set1_ps( rc2 );
+		const __m256 hit = _mm256_cmp_ps( t, _mm256_set1_ps( RAY_FAR ), _CMP_LT_OQ );
+		for (int i = 0; i < 3; i++)
+		{
+			const __m256 Px = _mm256_add_ps( ray.Ox8, _mm256_mul_ps( t, ray.Dx8 ) );
+			const __m256 Py = _mm256_add_ps( ray.Oy8, _mm256_mul_ps( t, ray.Dy8 ) );
+			const __m256 Pz = _mm256_add_ps( Oz, _mm256_mul_ps( t, ray.Dz8 ) );
+			const __m256 g = _mm256_sub_ps( _mm256_add_ps( dot8( Px, Py, Pz, Px, Py, Pz ), rc ), _mm256_set1_ps( rt2 ) );
+			const __m256 xy = _mm256_add_ps( _mm256_mul_ps( Px, Px ), _mm256_mul_ps( Py, Py ) );
+			const __m256 dxy = _mm256_add_ps( _mm256_mul_ps( Px, ray.Dx8 ), _mm256_mul_ps( Py, ray.Dy8 ) );
+			const __m256 f = _mm256_sub_ps( _mm256_mul_ps( g, g ), _mm256_mul_ps( _mm256_mul_ps( _mm256_set1_ps( 4 ), rc ), xy ) );
+			const __m256 df = _mm256_sub_ps( _mm256_mul_ps( _mm256_mul_ps( _mm256_set1_ps( 4 ), g ), dot8( Px, Py, Pz, ray.Dx8, ray.Dy8, ray.Dz8 ) ), _mm256_mul_ps( _mm256_mul_ps( _mm256_set1_ps( 8 ), rc ), dxy ) );
+			if (i == 2)
+			{
+				// the third evaluation only checks the residual, the closed form lost too much precision when it is large
+				const __m256 off = _mm256_cmp_ps( abs8( f ), _mm256_set1_ps( TORUS_MAX_RESIDUAL ), _CMP_NLE_UQ );
+				retry = _mm256_movemask_ps( _mm256_and_ps( hit, off ) );
+				break;
+			}
+			const __m256 step = _mm256_div_ps( f, df );
+			const __m256 small = _mm256_cmp_ps( abs8( step ), _mm256_add_ps( _mm256_mul_ps( t, _mm256_set1_ps( 0.01f ) ), _mm256_set1_ps( 1e-4f ) ), _CMP_LT_OQ );
+			t = _mm256_blendv_ps( t, _mm256_sub_ps( t, step ), _mm256_and_ps( hit, small ) );
+		}
+		return t;
+	}
+	void Intersect8( Ray8& ray ) const
+	{
+		const uint64_t start = sCollectStats ? __rdtsc() : 0;
+		const __m256 active = _mm256_cmp_ps( ray.t8, _mm256_setzero_ps(), _CMP_GT_OQ );
+		const __m256 bounds = sBoundsTest ? _mm256_and_ps( active, Bounds8( ray ) ) : active;
+		const int lanes = _mm256_movemask_ps( bounds );
+		int scalar = lanes;
+		if (lanes && sSimdSolver)
+		{
+			int retry;
+			const __m256 t = Solve8( ray, retry );
+			if (sValidate) Validate8( ray, t, lanes & ~retry );
+			const int simd = lanes & ~retry;
+			const __m256 simdMask = _mm256_castsi256_ps( _mm256_cmpgt_epi32( _mm256_and_si256( _mm256_set1_epi32( simd ), _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 ) ), _mm256_setzero_si256() ) );
+			ray.Hit( _mm256_and_ps( simdMask, inRange8( t, ray.t8 ) ), t, objIdx );
+			scalar = lanes & retry;
+			if (sCollectStats) sStats.mRetried.fetch_add( _mm_popcnt_u32( scalar ), std::memory_order_relaxed );
+		}
+		for (int i = 0; i < 8; i++) if (scalar & (1 << i))
+		{
+			Ray lane = ray.Lane( i );
+			Quartic( lane );
+			ray.t[i] = lane.t, ray.objIdx[i] = lane.objIdx;
+		}
+		if (sCollectStats) Count( _mm_popcnt_u32( _mm256_movemask_ps( active ) ), _mm_popcnt_u32( _mm256_movemask_ps( active ) & ~lanes ), start );
+	}
+	int IsOccluded8( const Ray8& ray, const int occluded ) const
+	{
+		const uint64_t start = sCollectStats ? __rdtsc() : 0;
+		const int active = _mm256_movemask_ps( _mm256_cmp_ps( ray.t8, _mm256_setzero_ps(), _CMP_GT_OQ ) ) & ~occluded;
+		const int lanes = sBoundsTest ? _mm256_movemask_ps( Bounds8( ray ) ) & active : active;
+		int result = 0, scalar = lanes;
+		if (lanes && sSimdSolver)
+		{
+			int retry;
+			const __m256 t = Solve8( ray, retry );
+			result = _mm256_movemask_ps( inRange8( t, ray.t8 ) ) & lanes & ~retry;
+			scalar = lanes & retry;
+			if (sCollectStats) sStats.mRetried.fetch_add( _mm_popcnt_u32( scalar ), std::memory_order_relaxed );
+		}
+		for (int i = 0; i < 8; i++) if (scalar & (1 << i)) if (QuarticOccluded( ray.Lane( i ) )) result |= 1 << i;
+		if (sCollectStats) Count( _mm_popcnt_u32( active ), _mm_popcnt_u32( active & ~lanes ), start );
+		return result;
+	}
+	void Validate8( const Ray8& ray, const __m256 t8, const int lanes ) const
+	{
+		// the double precision scalar solver is the reference, over the whole ray
+		float t[8];
+		_mm256_storeu_ps( t, t8 );
+		for (int i = 0; i < 8; i++) if (lanes & (1 << i))
+		{
+			Ray lane = ray.Lane( i );
+			lane.t = RAY_FAR, lane.objIdx = -1;
+			Quartic( lane );
+			const bool refHit = lane.objIdx == objIdx, simdHit = t[i] < RAY_FAR;
+			sStats.mValidated.fetch_add( 1, std::memory_order_relaxed );
+			if (refHit != simdHit) sStats.mMismatches.fetch_add( 1, std::memory_order_relaxed );
+			else if (refHit) atomicMax( sStats.mMaxError, fabsf( t[i] - lane.t ) / max( lane.t, 1e-3f ) );
+		}
+	}
+	void Count( const int tests, const int culled, const uint64_t start ) const
+	{
+		sStats.mTests.fetch_add( tests, std::memory_order_relaxed );
+		sStats.mCulled.fetch_add( culled, std::memory_order_relaxed );
+		sStats.mCycles.fetch_add( __rdtsc() - start, std::memory_order_relaxed );
+	}
+	static torusReport Report()
+	{
+		// takes the counters since the previous report
+		torusReport report;
+		const uint64_t tests = sStats.mTests.exchange( 0, std::memory_order_relaxed );
+		const uint64_t culled = sStats.mCulled.exchange( 0, std::memory_order_relaxed );
+		const uint64_t cycles = sStats.mCycles.exchange( 0, std::memory_order_relaxed );
+		report.mTests = tests;
+		report.mCulledRate = tests > 0 ? (float)culled / (float)tests : 0;
+		report.mRetryRate = tests > 0 ? (float)sStats.mRetried.exchange( 0, std::memory_order_relaxed ) / (float)tests : 0;
+		report.mCyclesPerTest = tests > 0 ? (float)cycles / (float)tests : 0;
+		report.mValidated = sStats.mValidated.exchange( 0, std::memory_order_relaxed );
+		report.mMismatches = sStats.mMismatches.exchange( 0, std::memory_order_relaxed );
+		report.mMaxError = sStats.mMaxError.exchange( 0, std::memory_order_relaxed );
+		return report;
+	}
 	float3 GetNormal( const float3 I ) const
 	{
 		const float3 L = I - float3( 0, 0, 1.5f );
@@ -462,8 +878,13 @@ public:
 	{
 		return float3( 1 ); // material.albedo;
 	}
-	float rt2, rc2, r2;
+	float rt2, rc2, r2, rt;
 	int objIdx;
+	inline static bool sBoundsTest = true;		// InBounds before the quartic
+	inline static bool sSimdSolver = true;		// Solve8 for the stream queries, the scalar quartic per lane otherwise
+	inline static bool sValidate = false;		// check Solve8 against the double precision solver
+	inline static bool sCollectStats = false;
+	inline static torusStats sStats;
 	// these are helper functions for the torus code
 	// these function will find the cubic root up till a certain accuracy using the newtonian method
 	float cbrtfFast( const float n ) const {
@@ -715,6 +1136,32 @@ public:
 		if (torus.IsOccluded( ray )) return true;
 		return false; // skip planes and rounded corners
 	}
+	void FindNearest8( Ray8& ray ) const
+	{
+		// same primitives as FindNearest, eight rays at a time
+	#ifdef FOURLIGHTS
+		for (int i = 0; i < 4; i++) quad[i].Intersect8( ray );
+	#else
+		quad.Intersect8( ray );
+	#endif
+		sphere.Intersect8( ray );
+		cube.Intersect8( ray );
+		torus.Intersect8( ray );
+		plane[2].Intersect8( ray );
+	}
+	int IsOccluded8( const Ray8& ray ) const
+	{
+		// returns a bit per occluded lane; the torus is tested last, for the lanes still open
+		__m256 occluded = _mm256_or_ps( cube.IsOccluded8( ray ), sphere.IsOccluded8( ray ) );
+	#ifdef FOURLIGHTS
+		for (int i = 0; i < 4; i++) occluded = _mm256_or_ps( occluded, quad[i].IsOccluded8( ray ) );
+	#else
+		occluded = _mm256_or_ps( occluded, quad.IsOccluded8( ray ) );
+	#endif
+		const int mask = _mm256_movemask_ps( occluded );
+		if (mask == 0xff) return mask;
+		return mask | torus.IsOccluded8( ray, mask );
+	}
 	float3 GetNormal( const int objIdx, const float3 I, const float3 wo ) const
 	{
 		// we get the normal after finding the nearest intersection: